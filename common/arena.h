@@ -0,0 +1,25 @@
+/* arena.h, Prototypes for the target specific startup memory arena.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// ============================================
+// Platform specific arena implementations
+// ============================================
+
+// Sinclair QL 16bit m68008
+#ifdef TARGET_QL
+#include "../src/arena_ql.h"
+#endif
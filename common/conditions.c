@@ -30,111 +30,134 @@
 #include "../common/data.h"
 #define _DATA_H
 #endif
+#ifndef _ENGINE_H
+#include "../common/engine.h"
+#endif
+
+// Condition check functions, indexed by the type held in the first byte of each condition
+check_func_t check_table[COND_TYPES] = {
+	check_NoCond,			// SIMPLE_COND_TYPE
+	check_Player,			// COND_PC_ATR_TYPE
+	check_PartyAttribute,	// COND_PARTY_ATR_TYPE
+	check_PartyState,		// COND_PARTY_MEMBER_TYPE
+	check_Map,				// COND_MAP_VISIT_TYPE
+	check_Monster,			// COND_MONSTER_DEFEAT_TYPE
+	check_NPC,				// COND_NPC_TYPE
+	check_Item,				// COND_ITEM_TYPE
+	check_Weapon			// COND_WEAPON_TYPE
+};
+
+CondCache_t check_cache[COND_CACHE_SIZE];		// Recent requirement list results, valid while their version matches
+unsigned char check_cache_next;					// Cache entry to replace next
 
 unsigned char check_Cond(GameState_t *gamestate, LevelState_t *levelstate, unsigned char *requires, unsigned char number, unsigned char eval_type){
+	// Evaluate a list of conditions, reusing the last result for this list
+	// if nothing it could depend on has changed since.
+	// The same lists are checked several times a turn; exits when the
+	// location is drawn and again on move, NPCs when drawn and again on talk.
+	
+	unsigned char i;
+	CondCache_t *entry;
+	
+	// Empty condition lists always evaluate to true
+	if (number == 0){
+		return 1;	
+	}
+	
+	for (i = 0; i < COND_CACHE_SIZE; i++){
+		entry = &check_cache[i];
+		if ((entry->requires == requires) && (entry->version == gamestate->version)){
+			return entry->result;
+		}
+	}
+	
+	// Not seen since the last change, evaluate it and replace the oldest entry
+	entry = &check_cache[check_cache_next];
+	entry->requires = requires;
+	entry->version = gamestate->version;
+	entry->result = check_Eval(gamestate, levelstate, requires, number, eval_type);
+	check_cache_next++;
+	if (check_cache_next >= COND_CACHE_SIZE){
+		check_cache_next = 0;
+	}
+	return entry->result;
+}
 
-	unsigned char result = 0;
-	unsigned char total_false = 0;
-	unsigned char total_true = 0;
+void check_Changed(GameState_t *gamestate){
+	// Record that something condition checks read has been altered;
+	// locations visited/looted/defeated, NPCs met/talked to/killed,
+	// inventory or party members, or a new location being loaded.
+	// Any cached requirement list results are then stale.
+	
 	unsigned char i;
-	unsigned char cond[COND_LENGTH];
-	unsigned char retval = 0;
 	
+	gamestate->version++;
+	if (gamestate->version == 0){
+		// Wrapped around, so old entries could match again
+		for (i = 0; i < COND_CACHE_SIZE; i++){
+			check_cache[i].requires = NULL;
+		}
+	}
+}
+
+unsigned char check_Eval(GameState_t *gamestate, LevelState_t *levelstate, unsigned char *requires, unsigned char number, unsigned char eval_type){
+	// Evaluate a list of conditions according to the rule (AND, OR, NOR, NAND)
+	// that the set is subject to.
+	// Conditions are tested in place, in order, and we stop as soon as one
+	// result decides the outcome: the first false for AND, the first true for
+	// OR and NOR, or the second true for NAND.
+
+	unsigned char total_true = 0;
+	unsigned char i;
+	unsigned char *cond;
 	
 	// Empty condition lists always evaluate to true
 	if (number == 0){
 		return 1;	
 	}
 	
-	// Test each group of COND_LENGTH bytes in turn, incrementing
-	// the total_false or total_true variable based on the whether they
-	// return 1 or 0.
+	// Unknown evaluation rules never pass
+	if ((eval_type != COND_EVAL_AND) && (eval_type != COND_EVAL_OR) && (eval_type != COND_EVAL_NOR) && (eval_type != COND_EVAL_NAND)){
+		return 0;
+	}
+	
+	cond = requires;
 	for(i = 0; i < number; i++){
 		
-		// Get next condition 
-		memcpy(cond, requires + (i * COND_LENGTH), COND_LENGTH);
-		//printf("Checking condition: [%d] of [%d] eval [%d]\n", cond[0], number, eval_type);
-		// Call correct condition check function
-		switch(cond[0]){
-			case SIMPLE_COND_TYPE:
-				result = check_NoCond(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_PC_ATR_TYPE:
-				result = check_PlayerAttribute(gamestate, levelstate, (char *) cond, 1);
-				break;
-			case COND_PARTY_ATR_TYPE:
-				result = check_PartyAttribute(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_PARTY_MEMBER_TYPE:
-				result = check_PartyState(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_MAP_VISIT_TYPE:
-				result = check_Map(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_MONSTER_DEFEAT_TYPE:
-				result = check_Monster(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_NPC_TYPE:
-				result = check_NPC(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_ITEM_TYPE:
-				result = check_Item(gamestate, levelstate, (char *) cond);
-				break;
-			case COND_WEAPON_TYPE:
-				result = check_Weapon(gamestate, levelstate, (char *) cond);
-				break;
-			default:
-				return 0;
+		// Unknown condition types never pass
+		if (cond[0] >= COND_TYPES){
+			return 0;
 		}
 		
-		// Increment result counters
-		if (result){
-			total_true++;	
-		} else {
-			total_false++;
-		}
-	}
-	
-	// Now work out what we return based on the evaluation rule
-	// that these set of conditions are subject to (OR, AND, NOR, NAND)
-	switch(eval_type){
-		case COND_EVAL_AND:
-			// All conditions must be true
-			if (total_true == number){
-				retval = 1;
-			} else {
-				retval = 0;
+		if (check_table[cond[0]](gamestate, levelstate, (char *) cond)){
+			total_true++;
+			if (eval_type == COND_EVAL_OR){
+				// At least one condition is true
+				return 1;
 			}
-			break;
-		case COND_EVAL_OR:
-			// At least one condition must be true
-			if (total_true > 0){
-				retval = 1;
-			} else {
-				retval = 0;	
+			if (eval_type == COND_EVAL_NOR){
+				// Not all conditions are false
+				return 0;
 			}
-			break;
-		case COND_EVAL_NOR:
-			// All conditions must be false
-			if (total_false == number){
-				retval = 1;	
-			} else {
-				retval = 0;	
+			if ((eval_type == COND_EVAL_NAND) && (total_true > 1)){
+				// More than one condition is true
+				return 0;
 			}
-			break;
-		case COND_EVAL_NAND:
-			// 0 or 1 conditions must be true, but no more than 1.
-			if ((total_true == 1) || (total_true == 0)){
-				retval = 1;
-			} else {
-				retval = 0;	
+		} else {
+			if (eval_type == COND_EVAL_AND){
+				// Not all conditions are true
+				return 0;
 			}
-			break;
-		default:
-			break;
+		}
+		cond += COND_LENGTH;
 	}
-	//printf("condition check returns [%d] [true:%d false:%d number:%d]\n", retval, total_true, total_false, number);
-	return retval;
+	
+	// Nothing decided the outcome early, so all of an AND were true,
+	// none of an OR or NOR were true, and no more than one of a NAND
+	if (eval_type == COND_EVAL_OR){
+		return 0;
+	}
+	return 1;
 }
 
 unsigned char check_NoCond(GameState_t *gamestate, LevelState_t *levelstate, char *cond){
@@ -243,6 +266,12 @@ unsigned char check_PlayerAttribute(GameState_t *gamestate, LevelState_t *levels
 	return 0;
 }
 
+unsigned char check_Player(GameState_t *gamestate, LevelState_t *levelstate, char *cond){
+	// Check one aspect of the first player character
+	
+	return check_PlayerAttribute(gamestate, levelstate, cond, 1);
+}
+
 unsigned char check_PartyAttribute(GameState_t *gamestate, LevelState_t *levelstate, char *cond){
 	// Check that at least one party member meets a condition
 	
@@ -274,28 +303,28 @@ unsigned char check_Map(GameState_t *gamestate, LevelState_t *levelstate, char *
 	
 	// Check a location has been visited a minimum number of times
 	if (check_type == COND_MAP_VISIT_MIN){
-		if (gamestate->level_visits[check_attribute] >= check_value){
+		if (progress_Visits(gamestate, check_attribute) >= check_value){
 			return 1;
 		}
 	}
 	
 	// Check a location has been visited no more than a maximum number of times
 	if (check_type == COND_MAP_VISIT_MAX){
-		if (gamestate->level_visits[check_attribute] <= check_value){
+		if (progress_Visits(gamestate, check_attribute) <= check_value){
 			return 1;
 		}
 	}
 	
 	// Check a location has been looted a manimum number of times
 	if (check_type == COND_MAP_LOOTED_MIN){
-		if (gamestate->level_looted[check_attribute] >= check_value){
+		if (progress_Looted(gamestate, check_attribute) >= check_value){
 			return 1;
 		}
 	}
 	
 	// Check a location has been looted no more than a maximum number of times
 	if (check_type == COND_MAP_LOOTED_MAX){
-		if (gamestate->level_looted[check_attribute] <= check_value){
+		if (progress_Looted(gamestate, check_attribute) <= check_value){
 			return 1;
 		}
 	}
@@ -322,12 +351,12 @@ unsigned char check_Monster(GameState_t *gamestate, LevelState_t *levelstate, ch
 		
 	//printf("checking [type:%d location:%d count:%d]\n", defeat_type, defeat_location_id, defeat_count);
 	
-	if (gamestate->level_visits[defeat_location_id] > 0){
+	if (progress_Visits(gamestate, defeat_location_id) > 0){
 		// We visited here at least once
 		
 		if (defeat_type == COND_MONSTER_PRI_DEFEATED){
 			// Primary spawned monster beaten at least N times
-			if (gamestate->level_defeated_primary[defeat_location_id] >= defeat_count){
+			if (progress_Defeated(gamestate, defeat_location_id, PROGRESS_PRIMARY) >= defeat_count){
 				retval = 1;
 			} else {
 				retval = 0;	
@@ -335,7 +364,7 @@ unsigned char check_Monster(GameState_t *gamestate, LevelState_t *levelstate, ch
 		}
 		if (defeat_type == COND_MONSTER_SEC_DEFEATED){
 			// Secondary spawned monster beaten at least N times
-			if (gamestate->level_defeated_secondary[defeat_location_id] >= defeat_count){
+			if (progress_Defeated(gamestate, defeat_location_id, PROGRESS_SECONDARY) >= defeat_count){
 				retval = 1;
 			} else {
 				retval = 0;	
@@ -357,7 +386,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 	unsigned char check_type = 0;
 	unsigned char check_npc_id = 0;
 	unsigned short check_value = 0;
-	struct NPCList *npc;
+	NPCState_t *npcs;
 	
 	// 1 byte
 	check_type = cond[1];
@@ -367,9 +396,8 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 	
 	// 2 bytes
 	check_value = (cond[3] << 2) + cond[4];
-	//printf("Finding npc [%d]\n", check_npc_id);	
-	npc = data_FindNPC(gamestate->npcs, check_npc_id);
-	if (npc){
+	npcs = &gamestate->npcs;
+	if (NPC_MET(npcs, check_npc_id)){
 		
 		// Met this NPC
 		if (check_type == COND_NPC_TALK){
@@ -378,7 +406,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 		
 		// Are they alive?
 		if (check_type == COND_NPC_ALIVE){
-			if (npc->death_time == 0){
+			if (npcs->death_time[check_npc_id] == 0){
 				return 1;
 			} else {
 				return 0;
@@ -387,7 +415,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 		
 		// Are they dead?
 		if (check_type == COND_NPC_DEAD){
-			if (npc->death_time != 0){
+			if (npcs->death_time[check_npc_id] != 0){
 				return 1;
 			} else {
 				return 0;
@@ -396,7 +424,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 		
 		// Did we meet them less than 'x' turns ago?
 		if (check_type == COND_NPC_TIMER_LESS){
-			if ((gamestate->counter - npc->talked_time) <= check_value){
+			if ((gamestate->counter - npcs->talked_time[check_npc_id]) <= check_value){
 				return 1;
 			} else {
 				return 0;
@@ -405,7 +433,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 		
 		// Did we meet them more than 'x' turns ago?
 		if (check_type == COND_NPC_TIMER_MORE){
-			if ((gamestate->counter - npc->talked_time) >= check_value){
+			if ((gamestate->counter - npcs->talked_time[check_npc_id]) >= check_value){
 				return 1;
 			} else {
 				return 0;
@@ -418,7 +446,7 @@ unsigned char check_NPC(GameState_t *gamestate, LevelState_t *levelstate, char *
 			return 1;	
 		}
 	}
-	// NPC not found
+	// NPC not met
 	
 	// COND_NPC_TIMER_LESS and COND_NPC_TIMER_MORE
 	// both fall through here if we haven't yet met the NPC
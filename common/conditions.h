@@ -151,13 +151,33 @@
 #define COND_WEAPON_OWN		0x01 // Must posess the weapon 'id'
 #define COND_WEAPON_NOTOWN	0x02 // Must NOT possess the weapon 'id'
 
+// Number of condition types above, which check_Cond() looks up in check_table[]
+#define COND_TYPES			0x09
+
+// Every condition type is tested by a function of this form, given the 5 bytes of the condition
+typedef unsigned char (*check_func_t)(GameState_t *gamestate, LevelState_t *levelstate, char *cond);
+
+// Results of recently evaluated requirement lists. A location has at most
+// 10 lists (4 exits, spawn, respawn, items, 3 NPCs), so each can keep its
+// result while the game state is unchanged.
+#define COND_CACHE_SIZE		12
+
+typedef struct {
+	unsigned char *requires;	// Requirement list which was evaluated, or NULL if unused
+	unsigned short version;		// gamestate->version at the time
+	unsigned char result;		// What check_Cond() returned
+} CondCache_t;
+
 // ===========================================
 // Common functions which all targets must
 // implement.
 // ===========================================
 
 unsigned char check_Cond(GameState_t *gamestate, LevelState_t *levelstate, unsigned char *requires, unsigned char number, unsigned char eval_type);
+unsigned char check_Eval(GameState_t *gamestate, LevelState_t *levelstate, unsigned char *requires, unsigned char number, unsigned char eval_type);
+void check_Changed(GameState_t *gamestate);
 unsigned char check_NoCond(GameState_t *gamestate, LevelState_t *levelstate, char *cond);
+unsigned char check_Player(GameState_t *gamestate, LevelState_t *levelstate, char *cond);
 unsigned char check_PlayerAttribute(GameState_t *gamestate, LevelState_t *levelstate, char *cond, unsigned char player);
 unsigned char check_PartyAttribute(GameState_t *gamestate, LevelState_t *levelstate, char *cond);
 unsigned char check_PartyState(GameState_t *gamestate, LevelState_t *levelstate, char *cond);
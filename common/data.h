@@ -34,6 +34,14 @@
 #define WEAPON_DAT_SIZE				45
 #define ITEM_DAT_SIZE				34
 
+// Story text compression
+// Bytes of STORY_DICT_FIRST and above in a story record are dictionary codes,
+// each expanding to a pair of bytes (which may themselves be codes) read from
+// the story dictionary file.
+#define STORY_DICT_FIRST			0x80
+#define STORY_DICT_SIZE				128
+#define STORY_DICT_DEPTH			8
+
 // Not defined here, but on a target level
 // SPRITE_DAT_SIZE
 // PORTRAIT_DAT_SIZE
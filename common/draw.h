@@ -38,6 +38,13 @@
 #define TEXT_TAG_BLUE			0x62	// b
 #define TEXT_TAG_COLOUR_CLEAR	0x43	// C
 
+// Story text which has been word-wrapped by the data compiler is
+// bracketed by these, and the start marker is followed by a single
+// byte giving the line width it was wrapped to.
+#define TEXT_PREWRAP_START		0x0E
+#define TEXT_PREWRAP_END		0x0F
+#define TEXT_PAGE_BREAK			0x0C	// Form feed, end of a page of pre-wrapped text
+
 #define SPRITE_CLASS_NONE			0	// A player/enemy without an on-screen sprite
 #define SPRITE_CLASS_NORMAL			1	// Players, normal enemies
 #define SPRITE_CLASS_LARGE			2	// Boss enemies
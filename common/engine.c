@@ -27,6 +27,15 @@
 #include "../common/monsters.h"
 #endif
 
+#ifndef _DATA_H
+#include "../common/data.h"
+#endif
+
+#ifndef _CONDITIONS_H
+#define _CONDITIONS_H
+#include "../common/conditions.h"
+#endif
+
 extern const char *player_races[MAX_PLAYER_RACES] = {
 	"Unknown",			// #0
 	"Human",			// #1
@@ -201,8 +210,9 @@ extern const char *status_effects[32] = {
 //
 // ==================================================
 
-void pc_GiveItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
+void pc_GiveItem(GameState_t *gamestate, PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
 	// Send an item to a player
+	// Item conditions read the inventory, so any cached results are now stale
 	char slot;
 	
 	// Check character is present
@@ -227,13 +237,15 @@ void pc_GiveItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
 					pc->items[slot].item_id = item->item_id;
 				}
 			}
+			check_Changed(gamestate);
 		}
 	}
 	
 }
 
-void pc_TakeItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
+void pc_TakeItem(GameState_t *gamestate, PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
 	// Remove one copy of an item from a player
+	// Item conditions read the inventory, so any cached results are now stale
 	unsigned char i;
 	
 	// Find the item slot
@@ -262,6 +274,7 @@ void pc_TakeItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
 			pc->items[i].item_type = ITEM_TYPE_NONE;
 		}
 	}
+	check_Changed(gamestate);
 }
 
 char pc_HasSlots(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
@@ -424,44 +437,74 @@ char pc_IsLastItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item){
 	return 0;
 }
 
-void pc_Equip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, unsigned char hand){
+#ifndef DATA_SHARED_DEFS
+unsigned char pc_SlotItem(ItemState_t **slot, ItemState_t *item){
+	// Copy an item definition into a character's own slot, or clear it
+	
+	if (item == NULL){
+		(*slot)->item_id = 0;
+	} else {
+		memcpy(*slot, item, sizeof(ItemState_t));
+	}
+	return 1;
+}
+
+unsigned char pc_SlotWeapon(WeaponState_t **slot, WeaponState_t *weapon){
+	// Copy a weapon definition into a character's own slot, or clear it
+	
+	if (weapon == NULL){
+		(*slot)->item_id = 0;
+	} else {
+		memcpy(*slot, weapon, sizeof(WeaponState_t));
+	}
+	return 1;
+}
+#endif
+
+unsigned char pc_Equip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, unsigned char hand){
 	// Equip an item on a player character.
 	// Automatically unequips any existing item on the same slot.
 	// 2 handed weapons automatically unequip any weapon held in the left hand.
+	// Returns 0 if there was no room for the definition, and the slot is
+	// left as it was.
+	
+	unsigned char equipped = 1;
 	 
 	if (item->item_id != 0){
 		// Assign item to head slot
 		if (item->slot == ITEM_SLOT_HEAD){
-			memcpy(pc->head, item, sizeof(ItemState_t));
+			equipped = pc_SlotItem(&pc->head, item);
 		}
 		// Assign item to body slot
 		if (item->slot == ITEM_SLOT_BODY){
-			memcpy(pc->body, item, sizeof(ItemState_t));
+			equipped = pc_SlotItem(&pc->body, item);
 		}
 		// Assign item to option slot
 		if (item->slot == ITEM_SLOT_OPTION){
-			memcpy(pc->option, item, sizeof(ItemState_t));
+			equipped = pc_SlotItem(&pc->option, item);
 		}
 	}
 	
 	if (weapon->item_id != 0){
-		
 		if (weapon->weapon_type == WEAPON_2HANDED){
-			// Un-equip any other item held in the left hand
-			pc->weapon_l->item_id = 0;
 			// Equip the 2-handed weapon
-			memcpy(pc->weapon_r, weapon, sizeof(WeaponState_t));
+			equipped = pc_SlotWeapon(&pc->weapon_r, weapon);
+			if (equipped){
+				// Un-equip any other item held in the left hand
+				pc_SlotWeapon(&pc->weapon_l, NULL);
+			}
 		} else {
 			if (hand == RIGHT_HAND){
 				// Equip to right hand
-				memcpy(pc->weapon_r, weapon, sizeof(WeaponState_t));
+				equipped = pc_SlotWeapon(&pc->weapon_r, weapon);
 			}
 			if (hand == LEFT_HAND){
 				// Equip to left hand
-				memcpy(pc->weapon_l, weapon, sizeof(WeaponState_t));
+				equipped = pc_SlotWeapon(&pc->weapon_l, weapon);
 			}
 		}
-	}	
+	}
+	return equipped;
 }
 
 void pc_Unequip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, unsigned char hand){
@@ -470,26 +513,26 @@ void pc_Unequip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, uns
 	if (item->item_id != 0){
 		// Clear item from head slot
 		if (item->slot == ITEM_SLOT_HEAD){
-			pc->head->item_id = 0;
+			pc_SlotItem(&pc->head, NULL);
 		}
 		// Clear item from body slot
 		if (item->slot == ITEM_SLOT_BODY){
-			pc->body->item_id = 0;
+			pc_SlotItem(&pc->body, NULL);
 		}
 		// Clear item from option slot
 		if (item->slot == ITEM_SLOT_OPTION){
-			pc->option->item_id = 0;
+			pc_SlotItem(&pc->option, NULL);
 		}
 	}
 	
 	if (weapon->item_id != 0){
 		// Clear weapon from right hand
 		if ((hand == RIGHT_HAND) && (pc->weapon_r->item_id == weapon->item_id)){
-			pc->weapon_r->item_id = 0;
+			pc_SlotWeapon(&pc->weapon_r, NULL);
 		}
 		// Clear weapon from left hand
 		if ((hand == LEFT_HAND) && (pc->weapon_l->item_id == weapon->item_id)){
-			pc->weapon_l->item_id = 0;
+			pc_SlotWeapon(&pc->weapon_l, NULL);
 		}
 	}
 }
@@ -521,6 +564,89 @@ unsigned char party_Count(GameState_t *gamestate, unsigned char include_dead){
 	return total;
 }
 
+// ==================================================
+//
+// Functions associated with recording our progress
+// through each location of the game world
+//
+// ==================================================
+
+unsigned char progress_Visits(GameState_t *gamestate, unsigned short id){
+	// Returns the number of times a location has been visited
+	
+	if (id >= MAX_LOCATIONS){
+		return 0;
+	}
+	return gamestate->progress.counts[id] >> 4;
+}
+
+unsigned char progress_Looted(GameState_t *gamestate, unsigned short id){
+	// Returns the number of times a location has been looted
+	
+	if (id >= MAX_LOCATIONS){
+		return 0;
+	}
+	return gamestate->progress.counts[id] & 0x0F;
+}
+
+void progress_Visit(GameState_t *gamestate, unsigned short id){
+	// Record another visit to a location
+	
+	if ((id >= MAX_LOCATIONS) || (progress_Visits(gamestate, id) == PROGRESS_COUNT_MAX)){
+		return;
+	}
+	if (progress_Visits(gamestate, id) == 0){
+		gamestate->progress.visited++;
+	}
+	gamestate->progress.counts[id] += 0x10;
+	check_Changed(gamestate);
+}
+
+void progress_Loot(GameState_t *gamestate, unsigned short id){
+	// Record another looting of a location
+	
+	if ((id >= MAX_LOCATIONS) || (progress_Looted(gamestate, id) == PROGRESS_COUNT_MAX)){
+		return;
+	}
+	gamestate->progress.counts[id]++;
+	check_Changed(gamestate);
+}
+
+unsigned char progress_Defeated(GameState_t *gamestate, unsigned short id, unsigned char spawn){
+	// Returns 1 if the primary or secondary monsters of a location have been defeated
+	
+	unsigned char *defeated;
+	
+	if (id >= MAX_LOCATIONS){
+		return 0;
+	}
+	if (spawn == PROGRESS_PRIMARY){
+		defeated = gamestate->progress.defeated_primary;
+	} else {
+		defeated = gamestate->progress.defeated_secondary;
+	}
+	if (defeated[id >> 3] & (1 << (id & 0x07))){
+		return 1;
+	}
+	return 0;
+}
+
+void progress_Defeat(GameState_t *gamestate, unsigned short id, unsigned char spawn){
+	// Record the defeat of the primary or secondary monsters of a location
+	
+	if ((id >= MAX_LOCATIONS) || progress_Defeated(gamestate, id, spawn)){
+		return;
+	}
+	if (spawn == PROGRESS_PRIMARY){
+		gamestate->progress.defeated_primary[id >> 3] |= (1 << (id & 0x07));
+		gamestate->progress.defeated_primary_total++;
+	} else {
+		gamestate->progress.defeated_secondary[id >> 3] |= (1 << (id & 0x07));
+		gamestate->progress.defeated_secondary_total++;
+	}
+	check_Changed(gamestate);
+}
+
 // ==================================================
 //
 // Functions associated with determining modifiers to 
@@ -235,10 +235,10 @@ unsigned char is_proficient(PlayerState_t *pc, unsigned char proficiency_type);
 void hit_Dice(PlayerState_t *pc, unsigned char *dice_quantity, unsigned char *dice_type, char *constitution_modifier);
 
 // Give x1 of an item to a player character
-void pc_GiveItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
+void pc_GiveItem(GameState_t *gamestate, PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
 
 // Take x1 of an item from a player character
-void pc_TakeItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
+void pc_TakeItem(GameState_t *gamestate, PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
 
 // Check if a player character has any free slots
 char pc_HasSlots(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
@@ -246,8 +246,16 @@ char pc_HasSlots(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
 // Check if a player character can equip a given item/weapon
 char pc_CanEquip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
 
-// Equip an item/weapon
-void pc_Equip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, unsigned char hand);
+// Equip an item/weapon, returns 0 if there was no room for it
+unsigned char pc_Equip(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item, unsigned char hand);
+
+// Point an equipment slot at an item/weapon definition, or empty it if NULL.
+// Returns 0, leaving the slot as it was, if there is no room for the definition.
+// engine.c copies the definition into the character's own slot, unless the
+// target shares definitions between characters and provides these itself
+// (it then defines DATA_SHARED_DEFS, see data_ql.h).
+unsigned char pc_SlotItem(ItemState_t **slot, ItemState_t *item);
+unsigned char pc_SlotWeapon(WeaponState_t **slot, WeaponState_t *weapon);
 
 // Is an item equipped
 char pc_IsEquipped(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
@@ -258,6 +266,20 @@ char pc_IsLastItem(PlayerState_t *pc, WeaponState_t *weapon, ItemState_t *item);
 // How many characters are in the party at present
 unsigned char party_Count(GameState_t *gamestate, unsigned char include_dead);
 
+// Number of times a location has been visited or looted, up to PROGRESS_COUNT_MAX
+unsigned char progress_Visits(GameState_t *gamestate, unsigned short id);
+unsigned char progress_Looted(GameState_t *gamestate, unsigned short id);
+
+// Record a visit to, or looting of, a location
+void progress_Visit(GameState_t *gamestate, unsigned short id);
+void progress_Loot(GameState_t *gamestate, unsigned short id);
+
+// Have the primary or secondary monsters of a location been defeated
+unsigned char progress_Defeated(GameState_t *gamestate, unsigned short id, unsigned char spawn);
+
+// Record the defeat of the primary or secondary monsters of a location
+void progress_Defeat(GameState_t *gamestate, unsigned short id, unsigned char spawn);
+
 // Generate a random number
 unsigned char random_GenerateRandom(GameState_t *gamestate);
 
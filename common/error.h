@@ -20,6 +20,8 @@
 #define OK								0
 #define MAIN_SCREEN_FAILURE				-1		// Screen initialisation failed
 #define MAIN_DATAFILES_MISSING			-2		// One or more essential datafiles are missing
+#define MAIN_ARENA_FAILURE				-3		// Unable to reserve the startup memory arena
+#define MAIN_PARTY_FAILURE				-4		// Unable to load the starting party
 
 #define BMP_OK							0 		// BMP loaded and decode okay
 #define BMP_ERR_NOFILE					-10 	// Cannot find file
@@ -60,7 +62,21 @@
 #define DATA_LOAD_MONSTER_MISMATCH		-46		// The found monster id does not match the search id
 #define DATA_LOAD_NO_NPC				-47		// NPC not found in list
 #define DATA_LOAD_WEAPONFILE			-48		// Unable to open weapons datafile
-#define DRAW_OPEN_BMPFILE				-50		// Unable to open bitmap file for async display
+#define DATA_LOAD_HANDLE				-49		// Unable to open one or more datafile handles at startup
+#define DRAW_OPEN_BMPFILE				-50		// Unable to open image file for display
+#define DRAW_IMAGE_HEADER				-51		// Image file does not have a valid header, or cannot be drawn at that position
+#define DATA_INDEX_MEMORY				-60		// Unable to malloc memory for an in-memory index table
+#define DATA_INDEX_READ					-61		// Unable to read a complete index file into memory
+#define DATA_INDEX_RANGE				-62		// Requested record is beyond the end of the index
+#define DATA_LOAD_MAP_SIZE				-63		// Map record is larger than the record buffer, or shorter than its contents
+#define DATA_LOAD_STORY_DICT			-64		// Story text dictionary is present, but is invalid or incomplete
+#define DATA_LOAD_SCRATCH				-65		// No room in the arena scratch region for the record buffer
+#define DATA_LOAD_MAP_REQUIRES			-66		// Map record has more requirements than a location can hold
+#define DATA_LOAD_DEF_FULL				-67		// Every shared item/weapon definition entry is in use
+#define DATA_LOAD_BATCH_SIZE			-68		// More characters in a group than can be loaded as one batch
+#define DATA_LOAD_MAP_LISTS				-69		// Map record has more monsters or items than a location can hold
+#define ARENA_INIT_OK					0
+#define ARENA_INIT_MEMORY				-70		// Unable to malloc the single block that the arena is carved from
 
 
 // Generic file error messages
@@ -70,9 +86,15 @@
 #define DATA_LOAD_ERROR_MSG				"Datafile Error!"															// Used as a title
 #define DATA_LOAD_MAP_INDEX_MSG			"Unable to open MAP .idx file."
 #define DATA_LOAD_MAP_DAT_MSG			"Unable to open MAP .dat file."
+#define DATA_LOAD_MAP_DAT_READ			"Unable to read sufficient bytes from MAP .dat file."
+#define DATA_LOAD_MAP_SIZE_MSG			"MAP record is too large for the record buffer, or is incomplete."
+#define DATA_LOAD_MAP_REQUIRES_MSG		"MAP location has too many condition requirements."
+#define DATA_LOAD_MAP_LISTS_MSG			"MAP location has too many monsters or items."
+#define DATA_LOAD_BATCH_SIZE_MSG		"Too many monsters or party members to load at once."
 #define DATA_LOAD_MAP_MISMATCH_MSG		"The loaded MAP location does not match. Datafile consistency error!"
 #define DATA_LOAD_STORY_INDEX_MSG		"Unable to open STORY .idx file."
 #define DATA_LOAD_STORY_DAT_MSG			"Unable to open STORY .dat file."
+#define DATA_LOAD_STORY_DAT_READ		"Unable to read sufficient bytes from STORY .dat file."
 #define DATA_LOAD_MONSTER_DAT_MSG		"Unable to open MONSTER .dat file."
 #define DATA_LOAD_NPC_DAT_MSG			"Unable to open NPC .dat file."
 #define DATA_LOAD_SPRITE_DAT_MSG		"Unable to open SPRITE .dat file."
@@ -89,19 +111,24 @@
 #define DATA_LOAD_NPC_MISSING_TALK		"Unable to find NPC in linked list to set dialogue state."
 #define DATA_LOAD_WEAPON_DAT_MSG		"Unable to open WEAPON .dat file."
 #define DATA_LOAD_WEAPON_DAT_SEEK		"Unable to seek to correct location in WEAPON .dat file."
+#define DATA_LOAD_WEAPON_DAT_READ		"Unable to read sufficient bytes from WEAPON .dat file."
 #define DATA_LOAD_ITEM_DAT_MSG			"Unable to open ITEM .dat file."
 #define DATA_LOAD_ITEM_DAT_SEEK			"Unable to seek to correct location in ITEM .dat file."
+#define DATA_LOAD_ITEM_DAT_READ			"Unable to read sufficient bytes from ITEM .dat file."
+#define DATA_INDEX_READ_MSG				"Unable to read MAP or STORY .idx file into memory."
+#define DATA_LOAD_STORY_DICT_MSG		"Unable to read STORY .dic file, or it is invalid."
 
 // Out of memory error messages
 #define GENERIC_MEMORY_MSG 				"Memory Error!"																// Used as a title
 #define DATA_LOAD_NPCMEMORY_MSG			"Error while adding new NPC. Unable to continue."
+#define DATA_INDEX_MEMORY_MSG			"Error while allocating MAP and STORY index tables. Unable to continue."
+#define DATA_LOAD_SCRATCH_MSG			"No room in the scratch region for the record buffer."
+#define DATA_LOAD_DEF_FULL_MSG			"Too many different items or weapons equipped at once."
 #define SCREEN_INIT_MEMORY_MSG			"Error while initialising screen and character image data. Unable to continue."
 
 // Bitmap/sprite error messages
-#define SCREEN_ASYNCBMP_MSG				"Async Bitmap Error!"
-#define SCREEN_ASYNCBMP_FILE			"Unable to open BMP file for async display."
-#define SCREEN_ASYNCBMP_DISPLAY			"Error during call for async bitmap display."
-#define SCREEN_ASYNCBMP_HEADER			"Error extracting BMP header for async bitmap display."
+#define SCREEN_IMAGE_MSG				"Image Error!"
+#define SCREEN_IMAGE_READ				"Unable to read background image, or it is invalid."
 
 #define _ERROR_H
 #endif
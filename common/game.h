@@ -45,6 +45,7 @@
 #define MAX_EFFECTS			5		// maximum number of effects a spell or item can have
 #define MAX_DAMAGE_TYPES	3
 #define REQUIREMENT_BYTES 	5		// 5 bytes per requirement
+#define MAX_LOCATION_REQUIREMENTS	16	// Requirements a location can hold in total, across all of its requirement lists
 #define MAX_PLAYER_CLASSES 16
 #define MAX_PROFICIENCIES	10
 #define MAX_PLAYER_RACES	5
@@ -200,15 +201,41 @@ typedef struct {
 	PlayerState_t *enemy[MAX_MONSTER_TYPES];	// array of enemy characters
 } EnemyState_t;
 
-// A list of NPCs we encounter, the 
-struct NPCList {
-	unsigned char id;					// ID of NPC
-	unsigned char talked_count;			// Number of times talked
-	unsigned short talked_time;			// Last turn number we talked to them
-	unsigned short death_time;			// Time of death / turn number
-	long double discussions;			// 64bit bitfield of up to 64 unique dialogues that have occurred.
-	struct NPCList *next;				// Pointer to next NPC record
-};
+// Everything we know about the NPCs we encounter,
+// held for every possible NPC ID so that looking one up is
+// a single index rather than a search, and meeting one
+// never needs to allocate memory.
+#define NPC_DIALOGUE_BYTES	8		// 64bit bitfield of up to 64 unique dialogues, as per MAX_NPC_DIALOGUES in datasettings.py
+
+typedef struct {
+	unsigned char met[MAX_CHARACTERS / 8];							// One bit per NPC ID, set once we have met them
+	unsigned short count;											// Number of NPCs met
+	unsigned char talked_count[MAX_CHARACTERS];						// Number of times talked
+	unsigned short talked_time[MAX_CHARACTERS];						// Last turn number we talked to them
+	unsigned short death_time[MAX_CHARACTERS];						// Time of death / turn number
+	unsigned char discussions[MAX_CHARACTERS][NPC_DIALOGUE_BYTES];	// Which unique dialogues (1 - 64) have occurred
+} NPCState_t;
+
+// Have we met NPC 'id' yet?
+#define NPC_MET(npcs, id)	((npcs)->met[(id) >> 3] & (1 << ((id) & 0x07)))
+
+// Our progress through each location, packed small:
+// visit and loot counts share a byte, a nibble each, and stop
+// counting at PROGRESS_COUNT_MAX, while monster defeats are one
+// bit per location. Read and update it through the progress_*
+// functions in engine.c, which also keep the running totals.
+#define PROGRESS_COUNT_MAX	15
+#define PROGRESS_PRIMARY	1		// Primary monster spawn, as per COND_MONSTER_PRI_DEFEATED
+#define PROGRESS_SECONDARY	2		// Secondary monster spawn, as per COND_MONSTER_SEC_DEFEATED
+
+typedef struct {
+	unsigned char counts[MAX_LOCATIONS];					// Times visited in the high nibble, times looted in the low nibble
+	unsigned char defeated_primary[MAX_LOCATIONS / 8];		// One bit per location, set once the primary monster(s) have been defeated
+	unsigned char defeated_secondary[MAX_LOCATIONS / 8];	// One bit per location, set once the secondary monster(s) have been defeated
+	unsigned short visited;									// Number of locations visited at least once
+	unsigned short defeated_primary_total;					// Number of locations with the primary monster(s) defeated
+	unsigned short defeated_secondary_total;				// Number of locations with the secondary monster(s) defeated
+} Progress_t;
 
 // Basic game data
 typedef struct {
@@ -218,15 +245,13 @@ typedef struct {
 	unsigned char name[MAX_LEVEL_NAME_SIZE];					// Name of the current adventure
 	unsigned char level;										// ID of the current location
 	unsigned char level_previous;								// ID of the immediately previous location
-	unsigned char level_looted[MAX_LOCATIONS];					// Each level has a count of how many times it has been looted
-	unsigned char level_visits[MAX_LOCATIONS];					// Each level has a count of how many times it has been visited
-	unsigned char level_defeated_primary[MAX_LOCATIONS];		// Each level has a flag to indicate whether the primary monster(s) has been defeated
-	unsigned char level_defeated_secondary[MAX_LOCATIONS];		// Each level has a flag to indicate whether the secondary monster(s) has been defeated
+	Progress_t progress;										// Visits, loots and monster defeats at each location
 	unsigned short counter;										// Game turn/timer/counter
+	unsigned short version;										// Bumped by check_Changed() whenever anything a condition check reads is altered
 	unsigned short gold;										// Record of currency
 	PartyState_t *players;								// partystate, which holds the list of players in party
 	EnemyState_t *enemies;								// enemystate, which holds the list of enemies in combat
-	struct NPCList *npcs;										// Pointer to a linked-list of NPC's we have met
+	NPCState_t npcs;											// The NPCs we have met
 	unsigned char	seed1;										// Seeds used to initialise the random number generator
 	unsigned char	seed2;
 	unsigned short	seed;	
@@ -236,7 +261,10 @@ typedef struct {
 // This way we can have (effectively) unlimited number of 'rooms' in 
 // our adventure and only need to load one at a time.
 //
-// This takes up approximately 500 bytes.
+// The requirement lists are packed one after another into requires[],
+// as most of them are empty, and each list is found by its offset.
+//
+// This takes up approximately 220 bytes.
 typedef struct {
 	unsigned short id;								// Unique ID of the location
 	unsigned char name[MAX_LEVEL_NAME_SIZE + 1];	// Name of the location
@@ -255,10 +283,10 @@ typedef struct {
 	unsigned short west_text;					// ID of the text label shown for the west exit
 	
 	// Conditions to enable navigation options
-	unsigned char north_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// Requirements to exit north
-	unsigned char south_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// Requirements to exit south
-	unsigned char east_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];		// Requirements to exit east
-	unsigned char west_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];		// Requirements to exit west
+	unsigned char north_require;					// Requirements to exit north, as an offset into requires[]
+	unsigned char south_require;					// Requirements to exit south, as an offset into requires[]
+	unsigned char east_require;					// Requirements to exit east, as an offset into requires[]
+	unsigned char west_require;					// Requirements to exit west, as an offset into requires[]
 	
 	// Condition evaluation types
 	unsigned char north_eval_type;					// EMPTY, AND, OR, etc
@@ -276,7 +304,7 @@ typedef struct {
 	unsigned char spawn_chance;						// 0-100 Chance of monsters spawning on initial location load
 	unsigned char spawn_number;						// NUmber of monster IDs in the spawn list
 	unsigned char spawn_list[MAX_MONSTER_TYPES];	// A list of the possible monster ID's for this location
-	unsigned char spawn_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// Things which need to be true to spawn monsters
+	unsigned char spawn_require;					// Things which need to be true to spawn monsters, as an offset into requires[]
 	unsigned char spawn_require_number;				// The number of requirements listed
 	unsigned char spawn_eval_type;					// EMPTY, AND, OR, etc
 	
@@ -287,7 +315,7 @@ typedef struct {
 	unsigned char respawn_chance;					// 0-100 Chance of monsters respawning on subsequent location load
 	unsigned char respawn_number;					// Number of monsters IDs in the respawn list
 	unsigned char respawn_list[MAX_MONSTER_TYPES];	// A list of the possible monster ID's for this location
-	unsigned char respawn_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];// Things which need to be true to respawn monsters
+	unsigned char respawn_require;					// Things which need to be true to respawn monsters, as an offset into requires[]
 	unsigned char respawn_require_number;			// The number of requirements listed for respawning
 	unsigned char respawn_eval_type;				// EMPTY, AND, OR, etc
 	
@@ -295,7 +323,7 @@ typedef struct {
 	unsigned short text_after_respawn;				// ID of text label shown after respawned monsters are killed
 
 	// Monsters-have-spawned indicator
-	unsigned char spawned;							// Flag set once either type of monster spawn
+	unsigned char spawned;							// Runtime only - flag set once either type of monster spawn
 	
 	
 	// Items may appear after defeating monsters
@@ -304,39 +332,47 @@ typedef struct {
 	unsigned char items_chance;							// Each item has a chance of being present
 	unsigned char weapons_number;
 	unsigned char items_number;
-	unsigned char items_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// To receive the items, these requirements must be met
+	unsigned char items_require;					// To receive the items, these requirements must be met, as an offset into requires[]
 	unsigned char items_require_number;
 	unsigned char items_eval_type;
 	
 	// Which NPCs may appear
-	unsigned char has_npc1;
+	unsigned char has_npc1;								// Runtime only - set once the NPC conditions have been evaluated
 	unsigned char npc1;									// ID of NPC
-	unsigned char npc1_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// To see this NPC, these requirements must be met
+	unsigned char npc1_require;					// To see this NPC, these requirements must be met, as an offset into requires[]
 	unsigned char npc1_require_number;
 	unsigned char npc1_eval_type;						// EMPTY, AND, OR, etc.
 	unsigned short npc1_text;							// ID of text shown when talking to this NPC
 	unsigned char npc1_text_unique_id;					// Unique id of this conversation
 	
-	unsigned char has_npc2;
+	unsigned char has_npc2;								// Runtime only
 	unsigned char npc2;									// ID of NPC
-	unsigned char npc2_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// To see this NPC, these requirements must be met
+	unsigned char npc2_require;					// To see this NPC, these requirements must be met, as an offset into requires[]
 	unsigned char npc2_require_number;
 	unsigned char npc2_eval_type;						// EMPTY, AND, OR, etc.
 	unsigned short npc2_text;							// ID of text shown when talking to this NPC
 	unsigned char npc2_text_unique_id;					// Unique id of this conversation
 	
-	unsigned char has_npc3;
+	unsigned char has_npc3;								// Runtime only
 	unsigned char npc3;									// ID of NPC
-	unsigned char npc3_require[MAX_REQUIREMENTS * REQUIREMENT_BYTES];	// To see this NPC, these requirements must be met
+	unsigned char npc3_require;					// To see this NPC, these requirements must be met, as an offset into requires[]
 	unsigned char npc3_require_number;
 	unsigned char npc3_eval_type;						// EMPTY, AND, OR, etc.
 	unsigned short npc3_text;							// ID of text shown when talking to this NPC
 	unsigned char npc3_text_unique_id;					// Unique id of this conversation
 	
-	unsigned char selected_npc;
+	unsigned char selected_npc;							// Runtime only - NPC chosen in the talk dialogue
+	
+	unsigned char background;							// Set if the location has a background image
+	
+	// Every requirement list above, each one MAX_REQUIREMENTS or fewer
+	unsigned char requires[MAX_LOCATION_REQUIREMENTS * REQUIREMENT_BYTES];
 	
 } LevelState_t;
 
+// Start of one of the requirement lists of a location, e.g. LEVEL_REQUIRE(levelstate, north)
+#define LEVEL_REQUIRE(levelstate, list)	((levelstate)->requires + (levelstate)->list##_require)
+
 // =====================================================
 // *ALL* platforms must implement the following methods
 // =====================================================
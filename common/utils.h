@@ -27,6 +27,10 @@
 // Clear bit 'x' of a value
 #define clearbit(x,bit) ((x) &= ~(1<<(bit)))
 
+// Fail the build if a constant expression is false; C68 has no _Static_assert,
+// so this declares an array type of negative size instead
+#define BUILD_ASSERT(name, cond) typedef char name[(cond) ? 1 : -1]
+
 // ============================================
 // Platform specific drawing implementations
 // ============================================
@@ -111,7 +111,56 @@ class bmp_to_target:
 		
 	def to_ql(self):
 		""" Convert a bitmap from the master folder into 4bpp fixed palette for QL """
-		pass
+		
+		# Every pixel becomes the nearest of the four QL colours, and the
+		# image is padded with black to a whole number of 8 pixel screen words
+		rgb = self.bmp.convert("RGB")
+		width = ((rgb.width + 7) // 8) * 8
+		
+		pixels = []
+		for y in range(0, rgb.height):
+			for x in range(0, width):
+				if x < rgb.width:
+					r, g, b = rgb.getpixel((x, y))
+					nearest = 0
+					distance = None
+					for i in range(0, len(QL_PALETTE)):
+						d = ((r - QL_PALETTE[i][0]) ** 2) + ((g - QL_PALETTE[i][1]) ** 2) + ((b - QL_PALETTE[i][2]) ** 2)
+						if (distance is None) or (d < distance):
+							nearest = i
+							distance = d
+					pixels.append(nearest)
+				else:
+					pixels.append(0)
+		
+		self.bmp = Image.new("P", (width, rgb.height))
+		self.bmp.putdata(pixels)
+		
+		if self.debug:
+			print("INFO - to_ql() Converted to %sx%s QL colours" % (width, rgb.height))
+		return True
+		
+	def out_ql_scr(self, compress = False):
+		""" Return the image as a native QL screen format file: a header, then
+			each row as the 16bit screen words of out_ql(), LZ compressed if
+			asked for and if that makes it any smaller """
+		
+		signature = SCR_SIGNATURE
+		pixels = self.bytes
+		if compress:
+			packed = lz_compress(self.bytes)
+			if lz_decompress(packed, len(self.bytes)) != list(self.bytes):
+				print("ERROR - out_ql_scr() Compressed image does not unpack correctly!")
+				return False
+			if len(packed) < len(self.bytes):
+				signature = SCR_SIGNATURE_LZ
+				pixels = packed
+		
+		header = []
+		header += signature.to_bytes(2, byteorder='big')
+		header += self.bmp.width.to_bytes(2, byteorder='big')
+		header += self.bmp.height.to_bytes(2, byteorder='big')
+		return bytes(header) + bytes(pixels)
 		
 	def out_ql(self):
 		""" Turn a 4bpp QL bitmap into a string of 16bit, 8pixel words we store in a dat file """
@@ -1127,12 +1176,56 @@ def generate_story(import_dir = None, target = None):
 	print("#")
 	print("# Step 3.")
 	print("#")
+	print("# Pre-wrap the text shown in the main window")
+	print("#")
+	print("###################################################################################")
+	print("")
+	
+	# Only the splash screen and location text is ever shown in the main window,
+	# everything else is drawn into windows of other sizes and wrapped by the engine.
+	wrap_ids = []
+	if STORY_PREWRAP:
+		wrap_ids.append(1)
+		try:
+			game_world = __import__(import_dir + ".world", globals(), locals(), ["MAP"])
+			for location_id in game_world.MAP.keys():
+				if game_world.MAP[location_id]['text'] not in wrap_ids:
+					wrap_ids.append(game_world.MAP[location_id]['text'])
+		except Exception as e:
+			print("WARNING: Unable to read world.py, only the splash screen text will be pre-wrapped")
+			print("WARNING: %s" % e)
+	else:
+		print("Pre-wrapping is disabled")
+		
+	texts = []
+	for i in text_ids:
+		text = game_story.STORY[i]
+		if i in wrap_ids:
+			wrapped = story_wrap(text, target['text_cols'], target['text_rows'])
+			if len(wrapped) < MAX_STORY_TEXT_SIZE:
+				print("- ID: %3d wrapped to %d columns" % (i, target['text_cols']))
+				text = wrapped
+			else:
+				print("- ID: %3d WARNING: too long once wrapped, left for the engine to wrap" % i)
+		texts.append(list(text.encode('ascii')))
+	print("...done!")
+	
+	print("")
+	print("###################################################################################")
+	print("#")
+	print("# Step 4.")
+	print("#")
 	print("# Write game data files")
 	print("#")
 	print("###################################################################################")
 	print("")
 	print("Pass 1: Writing data...")
-		
+	
+	dictionary = []
+	if STORY_COMPRESSION:
+		print("Compressing story text...")
+		dictionary, texts = story_compress(texts)
+	
 	offset = 0
 	records = []
 	for i in text_ids:
@@ -1142,7 +1235,7 @@ def generate_story(import_dir = None, target = None):
 			'size' : 0,
 			'offset' : 0,
 		}
-		new_record['data'] = bytes(game_story.STORY[i].encode('ascii'))			
+		new_record['data'] = bytes(texts[text_ids.index(i)])
 		new_record['size'] = len(new_record['data'])
 		new_record['offset'] = offset
 		records.append(new_record)
@@ -1177,8 +1270,106 @@ def generate_story(import_dir = None, target = None):
 		print("ERROR! %s" % e)
 		return False
 	print("...done!")
+	
+	print("")
+	print("Pass 3: Writing Dictionary")
+	try:
+		f = open(import_dir + OUT_DIR + target['suffix'] + "/story.dic", "wb")
+		f.write(bytes([len(dictionary)]))
+		for pair in dictionary:
+			f.write(bytes(pair))
+		f.close()
+	except Exception as e:
+		print("ERROR! Unable to write dictionary file")
+		print("ERROR! %s" % e)
+		return False
+	plain_size = 0
+	for i in text_ids:
+		plain_size += len(game_story.STORY[i])
+	packed_size = 1 + (len(dictionary) * 2)
+	for record in records:
+		packed_size += record['size']
+	print("- %d dictionary entries" % len(dictionary))
+	print("- %d bytes of text stored in %d bytes (%d%%), including dictionary" % (plain_size, packed_size, (packed_size * 100) / max(plain_size, 1)))
+	print("...done!")
 		
 
+def generate_backgrounds(import_dir = None, target = None):
+	""" Converts any location background images to the native screen format of the target """
+	
+	print("")
+	print("*** Parsing Location Backgrounds ***")
+	
+	try:
+		game_world = module = __import__(import_dir + ".world", globals(), locals(), ["MAP"])
+	except Exception as e:
+		print("Error: %s" % e)
+		traceback.print_exc(file=sys.stdout)
+		return False
+	
+	location_ids = list(game_world.MAP.keys())
+	location_ids.sort()
+	
+	valid = True
+	converted = 0
+	for location_id in location_ids:
+		location = game_world.MAP[location_id]
+		if ('background' not in location.keys()) or (location['background'] == ""):
+			continue
+		
+		bg_file = location['background']
+		d1 = import_dir + BMP_SOURCES + target['suffix'] + "/" + bg_file
+		d2 = import_dir + BMP_SOURCES + "master/" + bg_file
+		if os.path.exists(d1):
+			d = d1
+		elif os.path.exists(d2):
+			d = d2
+		else:
+			valid = False
+			print("Location ID: %3d" % location_id)
+			print("- ERROR: This location has a background which was not found [%s]" % bg_file)
+			print("- ERROR: Background files for this adventure should be found in: [%s OR %s]" % ((import_dir + BMP_SOURCES + "master/"), (import_dir + BMP_SOURCES +  target['suffix'] + "/")))
+			continue
+		
+		b = bmp_to_target(target = target)
+		if b.load(d) is False:
+			valid = False
+			continue
+		if (b.bmp.width > target['bg_width']) or (b.bmp.height > target['bg_height']):
+			valid = False
+			print("Location ID: %3d" % location_id)
+			print("- ERROR: Background [%s] is %sx%s, larger than the allowed %sx%s" % (bg_file, b.bmp.width, b.bmp.height, target['bg_width'], target['bg_height']))
+			continue
+		
+		if (b.convert() is False) or (b.out() is False):
+			valid = False
+			print("Location ID: %3d" % location_id)
+			print("- ERROR: Conversion of [%s] to native [%s] binary data failed" % (bg_file, target['target']))
+			continue
+		
+		scr = b.out_ql_scr(compress = BACKGROUND_COMPRESSION)
+		if scr is False:
+			valid = False
+			print("Location ID: %3d" % location_id)
+			print("- ERROR: Compression of [%s] failed" % bg_file)
+			continue
+		
+		out_file = BACKGROUND_FILE % location_id
+		try:
+			f = open(import_dir + OUT_DIR + target['suffix'] + "/" + out_file, "wb")
+			f.write(scr)
+			f.close()
+		except Exception as e:
+			print("ERROR! Unable to write background file")
+			print("ERROR! %s" % e)
+			return False
+		converted += 1
+		print("- Location ID: %3d, [%s] %sx%s written to %s (%d bytes, %d uncompressed)" % (location_id, bg_file, b.bmp.width, b.bmp.height, out_file, len(scr), len(b.bytes) + 6))
+	
+	print("- %d background images converted" % converted)
+	print("...done!")
+	return valid
+
 def generate_world(import_dir = None, target = None):
 	""" Generates a story/game world location datafile from a map.py file """
 	
@@ -1606,6 +1797,9 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 	""" Turn a location into a list of bytes that can be written to disk """
 	
 	total_conditions = 0
+	condition_cost = 0			# Worst case cost of all requirement lists, as compiled
+	condition_cost_before = 0	# ... and as written in the world file
+	condition_bytes_saved = 0
 	
 	record = []
 	
@@ -1672,26 +1866,14 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 			compass_text_id = (0).to_bytes(2, byteorder='big')
 		
 		# 3c. (2 bytes or variable) requirement for exit
-		if len(location[compass_require]) == 0:
-			# 1 byte - Empty
-			compass_requires.append(CONDITION_RULES["COND_EVAL_EMPTY"].to_bytes(1, byteorder='big'))
-			# 1 byte - 0 conditions are to follow
-			compass_requires.append((0).to_bytes(1, byteorder='big'))
-		else:
-			# 1 byte - Evaluation rule
-			compass_requires.append(CONDITION_RULES[location[compass_require][0]].to_bytes(1, byteorder='big'))
-			# 1 byte - Number of conditions to follow
-			compass_requires.append(location[compass_require][1].to_bytes(1, byteorder='big'))
-			# 5 bytes - Per condition
-			for cond in location[compass_require][2:]:
-				total_conditions += 1
-				cond_record = evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, cond)
-				if len(cond_record) != 5:
-					print("ERROR! Condition record for %s did not convert to 5 bytes!!!" % compass_require)
-					print("ERROR! %s" % cond_record)
-					return False
-				for c in cond_record:
-					compass_requires.append(c.to_bytes(1, byteorder='big'))
+		compiled = compile_requirement(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, location[compass_require], compass_require)
+		if compiled is False:
+			return False
+		compass_requires = compiled['bytes']
+		total_conditions += compiled['number']
+		condition_cost += compiled['cost']
+		condition_cost_before += compiled['cost_before']
+		condition_bytes_saved += compiled['saved']
 					
 		# Add the id of the exit
 		for b in compass_id:
@@ -1745,26 +1927,14 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 				spawn_list_bytes.append(m.to_bytes(1, byteorder='big'))
 			
 		# 4c. Monster spawn requirement
-		if len(location[spawn_require]) == 0:
-			# 1 byte - Empty
-			spawn_require_bytes.append(CONDITION_RULES["COND_EVAL_EMPTY"].to_bytes(1, byteorder='big'))
-			# 1 byte - 0 conditions are to follow
-			spawn_require_bytes.append((0).to_bytes(1, byteorder='big'))
-		else:
-			# 1 byte - Evaluation rule
-			spawn_require_bytes.append(CONDITION_RULES[location[spawn_require][0]].to_bytes(1, byteorder='big'))
-			# 1 byte - Number of conditions to follow
-			spawn_require_bytes.append(location[spawn_require][1].to_bytes(1, byteorder='big'))
-			# 5 bytes - Per condition
-			for cond in location[spawn_require][2:]:
-				total_conditions += 1
-				cond_record = evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, cond)
-				if len(cond_record) != 5:
-					print("ERROR! Condition record for '%s' did not convert to 5 bytes!!!" % spawn_require)
-					print("ERROR! %s" % cond_record)
-					return False
-				for c in cond_record:
-					spawn_require_bytes.append(c.to_bytes(1, byteorder='big'))
+		compiled = compile_requirement(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, location[spawn_require], spawn_require)
+		if compiled is False:
+			return False
+		spawn_require_bytes = compiled['bytes']
+		total_conditions += compiled['number']
+		condition_cost += compiled['cost']
+		condition_cost_before += compiled['cost_before']
+		condition_bytes_saved += compiled['saved']
 					
 		# Add the id of the exit
 		record.append(spawn_chance_byte)
@@ -1822,27 +1992,14 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 	######################################################
 	# 5c. Item spawn requirements
 	######################################################
-	item_spawn_require_bytes = []
-	if len(location['items_require']) == 0:
-		# 1 byte - Empty
-		item_spawn_require_bytes.append(CONDITION_RULES["COND_EVAL_EMPTY"].to_bytes(1, byteorder='big'))
-		# 1 byte - 0 conditions are to follow
-		item_spawn_require_bytes.append((0).to_bytes(1, byteorder='big'))
-	else:
-		# 1 byte - Evaluation rule
-		item_spawn_require_bytes.append(CONDITION_RULES[location['items_require'][0]].to_bytes(1, byteorder='big'))
-		# 1 byte - Number of conditions to follow
-		item_spawn_require_bytes.append(location['items_require'][1].to_bytes(1, byteorder='big'))
-		# 5 bytes - Per condition
-		for cond in location['items_require'][2:]:
-			total_conditions += 1
-			cond_record = evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, cond)
-			if len(cond_record) != 5:
-				print("ERROR! Condition record for '%s' did not convert to 5 bytes!!!" % spawn_require)
-				print("ERROR! %s" % cond_record)
-				return False
-			for c in cond_record:
-				item_spawn_require_bytes.append(c.to_bytes(1, byteorder='big'))
+	compiled = compile_requirement(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, location['items_require'], 'items_require')
+	if compiled is False:
+		return False
+	item_spawn_require_bytes = compiled['bytes']
+	total_conditions += compiled['number']
+	condition_cost += compiled['cost']
+	condition_cost_before += compiled['cost_before']
+	condition_bytes_saved += compiled['saved']
 				
 	for b in item_spawn_require_bytes:
 		record.append(b)
@@ -1923,28 +2080,14 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 		print("-- + 1 byte, %s ID" % npc)
 		
 		# 11. (2 bytes to variable) Evaluation rule and requirements for NPC 1
-		npc_require_bytes = []
-		if len(npc_require) == 0:
-			# 1 byte - Empty
-			npc_require_bytes.append(CONDITION_RULES["COND_EVAL_EMPTY"].to_bytes(1, byteorder='big'))
-			# 1 byte - 0 conditions are to follow
-			npc_require_bytes.append((0).to_bytes(1, byteorder='big'))
-		else:
-			# 1 byte - Evaluation rule
-			npc_require_bytes.append(CONDITION_RULES[npc_require[0]].to_bytes(1, byteorder='big'))
-			# 1 byte - Number of conditions to follow
-			npc_require_bytes.append(npc_require[1].to_bytes(1, byteorder='big'))
-			# 5 bytes - Per condition
-			for cond in npc_require[2:]:
-				print(cond)
-				total_conditions += 1
-				cond_record = evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, cond)
-				if len(cond_record) != 5:
-					print("ERROR! Condition record for %s require did not convert to 5 bytes!!!" % npc)
-					print("ERROR! %s" % cond_record)
-					return False
-				for c in cond_record:
-					npc_require_bytes.append(c.to_bytes(1, byteorder='big'))
+		compiled = compile_requirement(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, npc_require, npc + "_require")
+		if compiled is False:
+			return False
+		npc_require_bytes = compiled['bytes']
+		total_conditions += compiled['number']
+		condition_cost += compiled['cost']
+		condition_cost_before += compiled['cost_before']
+		condition_bytes_saved += compiled['saved']
 		for b in npc_require_bytes:
 			record.append(b)
 		print("-- +%2s bytes, %s condition requirements" % (len(npc_require_bytes), npc))
@@ -1966,9 +2109,25 @@ def location_to_record(location_ids, text_ids, monster_ids, npc_ids, item_ids, w
 		for b in byte_list:
 			record.append(b.to_bytes(1, byteorder='big'))
 		print("-- +%2s bytes, %s string id" % (len(byte_list), npc))
+	
+	#####################################################
+	# 14. (1 byte) Background image flag
+	#####################################################
+	# Set if generate_backgrounds() writes a background image for this
+	# location, so that the engine does not look for one otherwise
+	if ('background' in location.keys()) and (location['background'] != ""):
+		record.append((1).to_bytes(1, byteorder='big'))
+	else:
+		record.append((0).to_bytes(1, byteorder='big'))
+	print("-- + 1 byte, background image flag")
 		
 	if total_conditions > 0:
 		print("-- Location record contained %s conditional requirements" % total_conditions)
+	if total_conditions > MAX_LOCATION_REQUIREMENTS:
+		print("ERROR! Location %s has %s conditional requirements, the engine can only hold %s per location" % (location_id, total_conditions, MAX_LOCATION_REQUIREMENTS))
+		return False
+	if condition_cost_before > 0:
+		print("-- Location condition cost %s (was %s), %s bytes saved" % (condition_cost, condition_cost_before, condition_bytes_saved))
 		
 	return record
 	
@@ -2693,6 +2852,287 @@ def weapon_to_record(weapon_id, weapon, game_story):
 	return record	
 	
 
+def story_wrap(text, cols, rows):
+	""" Word-wrap a story text to a window of cols x rows characters, the same
+	way the game engine would at runtime. Returns the text with explicit line
+	and page breaks, bracketed by the pre-wrapped text markers. """
+	
+	lines = []
+	for paragraph in text.split("\n"):
+		line = ""
+		width = 0
+		for word in paragraph.split(" "):
+			# Colour and font tags take up no space on screen
+			word_width = len(word)
+			for j in range(0, len(word) - 2):
+				if (word[j] == "<") and (word[j + 2] == ">"):
+					word_width -= 3
+			if width == 0:
+				# Leading spaces are dropped at the start of a line
+				if word_width == 0:
+					line += word
+					continue
+			elif (width + 1 + word_width) <= cols:
+				line += " "
+				width += 1
+			else:
+				lines.append(line)
+				line = ""
+				width = 0
+			# A single word wider than the window has to be split
+			while word_width > cols:
+				lines.append(word[:cols])
+				word = word[cols:]
+				word_width -= cols
+			line += word
+			width += word_width
+		lines.append(line)
+	
+	wrapped = ""
+	for j in range(0, len(lines)):
+		if j > 0:
+			if (j % rows) == 0:
+				wrapped += chr(TEXT_PAGE_BREAK)
+			else:
+				wrapped += "\n"
+		wrapped += lines[j]
+	
+	return chr(TEXT_PREWRAP_START) + chr(cols) + wrapped + chr(TEXT_PREWRAP_END)
+
+def story_compress(texts):
+	""" Byte-pair encode a list of story texts, returning the dictionary
+	and the compressed texts. Each pass replaces the most common pair of
+	adjacent bytes, across all of the texts, with a new code. """
+	
+	dictionary = []
+	depth = {}
+	code = STORY_DICT_FIRST
+	while len(dictionary) < STORY_DICT_SIZE:
+		
+		# Count every pair of adjacent bytes
+		counts = {}
+		for text in texts:
+			for i in range(0, len(text) - 1):
+				pair = (text[i], text[i + 1])
+				counts[pair] = counts.get(pair, 0) + 1
+		
+		# Pick the most common pair, as long as expanding it stays
+		# within the nesting depth the game engine can cope with
+		best = None
+		for pair in counts.keys():
+			if max(depth.get(pair[0], 0), depth.get(pair[1], 0)) >= STORY_DICT_DEPTH:
+				continue
+			if (best is None) or (counts[pair] > counts[best]):
+				best = pair
+				
+		# Each replacement saves a byte, but the dictionary entry costs two
+		if (best is None) or (counts[best] < 3):
+			break
+		
+		# Replace the pair with the new code everywhere it appears
+		new_texts = []
+		for text in texts:
+			new_text = []
+			i = 0
+			while i < len(text):
+				if (i < len(text) - 1) and (text[i] == best[0]) and (text[i + 1] == best[1]):
+					new_text.append(code)
+					i += 2
+				else:
+					new_text.append(text[i])
+					i += 1
+			new_texts.append(new_text)
+		texts = new_texts
+		
+		dictionary.append(best)
+		depth[code] = max(depth.get(best[0], 0), depth.get(best[1], 0)) + 1
+		code += 1
+	
+	return dictionary, texts
+
+def lz_compress(data):
+	""" LZ compress a list of bytes into the token format unpacked by the
+	game engine, greedily taking the longest match at each position. """
+	
+	packed = []
+	literals = []
+	chains = {}
+	
+	def flush_literals():
+		while len(literals) > 0:
+			run = literals[:LZ_MAX_LITERALS]
+			del literals[:LZ_MAX_LITERALS]
+			packed.append(len(run) - 1)
+			packed.extend(run)
+	
+	def remember(pos):
+		if pos + LZ_MIN_MATCH <= len(data):
+			key = tuple(data[pos:pos + LZ_MIN_MATCH])
+			chains.setdefault(key, []).append(pos)
+	
+	i = 0
+	while i < len(data):
+		best_len = 0
+		best_offset = 0
+		if i + LZ_MIN_MATCH <= len(data):
+			candidates = chains.get(tuple(data[i:i + LZ_MIN_MATCH]), [])
+			for j in reversed(candidates[-LZ_SEARCH:]):
+				if i - j > LZ_MAX_OFFSET:
+					break
+				length = LZ_MIN_MATCH
+				while (length < LZ_MAX_MATCH) and (i + length < len(data)) and (data[j + length] == data[i + length]):
+					length += 1
+				if length > best_len:
+					best_len = length
+					best_offset = i - j
+					if length == LZ_MAX_MATCH:
+						break
+		
+		if best_len >= LZ_MIN_MATCH:
+			flush_literals()
+			packed.append(0x80 + best_len - LZ_MIN_MATCH)
+			packed.extend(best_offset.to_bytes(2, byteorder='big'))
+			for pos in range(i, i + best_len):
+				remember(pos)
+			i += best_len
+		else:
+			literals.append(data[i])
+			remember(i)
+			i += 1
+	
+	flush_literals()
+	return packed
+
+def lz_decompress(packed, size):
+	""" Unpack lz_compress() output again, to check it """
+	
+	data = []
+	i = 0
+	while len(data) < size:
+		token = packed[i]
+		if token < 0x80:
+			data.extend(packed[i + 1:i + 2 + token])
+			i += 2 + token
+		else:
+			offset = (packed[i + 1] << 8) + packed[i + 2]
+			for n in range(0, token - 0x80 + LZ_MIN_MATCH):
+				data.append(data[len(data) - offset])
+			i += 3
+	return data
+
+def condition_always_true(cond):
+	""" Is a compiled 5 byte condition true whatever the state of the game? """
+	
+	# No condition
+	if cond == CONDITIONS["NO_COND"]['bitfield']:
+		return True
+	
+	# A PC or party attribute of 0 or more
+	if (cond[0] in [CONDITIONS["COND_PC_ATR_TYPE"]['bitfield'][0], CONDITIONS["COND_PARTY_ATR_TYPE"]['bitfield'][0]]) and (cond[3] == 0):
+		return True
+	
+	# A location visited or looted 0 or more times
+	if (cond[0] == CONDITIONS["COND_MAP_VISIT_TYPE"]['bitfield'][0]) and (cond[1] in [VISIT_TYPE["COND_MAP_VISIT_TYPE_MIN"], VISIT_TYPE["COND_MAP_LOOTED_TYPE_MIN"]]) and (cond[4] == 0):
+		return True
+	
+	return False
+
+def condition_cost(cond):
+	""" Relative runtime cost of testing a compiled condition """
+	
+	return CONDITION_COST[cond[0]]
+
+def optimise_requirement(eval_type, conds):
+	""" Simplify a list of compiled conditions without changing what it
+	evaluates to at runtime. Returns the new evaluation rule and conditions. """
+	
+	# A repeated condition cannot change the outcome of AND, OR or NOR
+	if eval_type in ["COND_EVAL_AND", "COND_EVAL_OR", "COND_EVAL_NOR"]:
+		unique = []
+		for cond in conds:
+			if cond not in unique:
+				unique.append(cond)
+		conds = unique
+	
+	# Fold conditions which are always true
+	constant = [cond for cond in conds if condition_always_true(cond)]
+	conds = [cond for cond in conds if not condition_always_true(cond)]
+	if len(constant) > 0:
+		if eval_type == "COND_EVAL_OR":
+			# Always true
+			conds = []
+		elif eval_type == "COND_EVAL_NOR":
+			# Always false, which needs one condition to say so
+			return ("COND_EVAL_NOR", [CONDITIONS["NO_COND"]['bitfield']])
+		elif eval_type == "COND_EVAL_NAND":
+			if len(constant) > 1:
+				# Always false
+				return ("COND_EVAL_NOR", [CONDITIONS["NO_COND"]['bitfield']])
+			# One true already, so the rest must all be false
+			eval_type = "COND_EVAL_NOR"
+	
+	# With a single condition AND and OR are the same, and NAND can never fail
+	if len(conds) == 1:
+		if eval_type == "COND_EVAL_OR":
+			eval_type = "COND_EVAL_AND"
+		if eval_type == "COND_EVAL_NAND":
+			conds = []
+	
+	if len(conds) == 0:
+		return ("COND_EVAL_EMPTY", [])
+	
+	# The runtime stops at the first deciding condition, so test the cheapest first
+	conds = sorted(conds, key = condition_cost)
+	return (eval_type, conds)
+
+def compile_requirement(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, require, name):
+	""" Turn a *_require list into the bytes of a location record; the
+	evaluation rule, number of conditions and 5 bytes per condition. """
+	
+	compiled = {
+		'bytes' : [],
+		'number' : 0,
+		'cost' : 0,
+		'cost_before' : 0,
+		'saved' : 0,
+	}
+	
+	if len(require) == 0:
+		# 1 byte - Empty
+		compiled['bytes'].append(CONDITION_RULES["COND_EVAL_EMPTY"].to_bytes(1, byteorder='big'))
+		# 1 byte - 0 conditions are to follow
+		compiled['bytes'].append((0).to_bytes(1, byteorder='big'))
+		return compiled
+	
+	conds = []
+	for cond in require[2:]:
+		cond_record = evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, cond)
+		if (cond_record is False) or (len(cond_record) != 5):
+			print("ERROR! Condition record for %s did not convert to 5 bytes!!!" % name)
+			print("ERROR! %s" % cond_record)
+			return False
+		if (cond_record[0] == CONDITIONS["COND_MAP_VISIT_TYPE"]['bitfield'][0]) and (cond_record[4] > PROGRESS_COUNT_MAX):
+			print("WARNING! %s: visit and loot counts stop at %s, condition %s will be compared against that" % (name, PROGRESS_COUNT_MAX, cond))
+		conds.append(list(cond_record))
+		compiled['cost_before'] += condition_cost(cond_record)
+		
+	eval_type, conds = optimise_requirement(require[0], conds)
+	if (eval_type != require[0]) or (len(conds) != len(require[2:])):
+		print("-- %s: %s x%s optimised to %s x%s" % (name, require[0], len(require[2:]), eval_type, len(conds)))
+	
+	# 1 byte - Evaluation rule
+	compiled['bytes'].append(CONDITION_RULES[eval_type].to_bytes(1, byteorder='big'))
+	# 1 byte - Number of conditions to follow
+	compiled['bytes'].append(len(conds).to_bytes(1, byteorder='big'))
+	# 5 bytes - Per condition
+	for cond in conds:
+		for c in cond:
+			compiled['bytes'].append(c.to_bytes(1, byteorder='big'))
+		compiled['cost'] += condition_cost(cond)
+	compiled['number'] = len(conds)
+	compiled['saved'] = (len(require[2:]) - len(conds)) * 5
+	return compiled
+
 def evaluate_condition(location_ids, text_ids, monster_ids, npc_ids, item_ids, weapon_ids, player_ids, condition_list_entry):
 	""" Attempt to lookup all the elements of a condition requirement """
 	
@@ -3053,6 +3493,11 @@ if __name__ == "__main__":
 			print("Not continuing. Please fix errors in world map file.")
 			sys.exit(1)
 			
+		status = generate_backgrounds(import_dir = adventure, target = target)
+		if status is False:
+			print("Not continuing. Please fix errors in location background images.")
+			sys.exit(1)
+			
 		status = generate_story(import_dir = adventure, target = target)
 		if status is False:
 			print("Not continuing. Please fix errors in story file.")
@@ -38,11 +38,13 @@
 import string
 
 MAX_REQUIREMENTS = 8		# as per game.h
+MAX_LOCATION_REQUIREMENTS = 16	# as per game.h, across all of the requirement lists of one location
 MAX_MONSTER_TYPES = 4		# as per game.h
 MAX_REWARD_ITEMS = 6 		# as per game.h
 MAX_LEVEL_NAME_SIZE = 32	# as per game.h
 MAX_STORY_TEXT_SIZE = 1024	# as per game.h
 MAX_LOCATIONS = 256			# as per game.h
+PROGRESS_COUNT_MAX = 15		# as per game.h, visit and loot counts are held in a nibble
 MAX_PLAYER_NAME = 18		# as per game.h
 MAX_WEAPON_NAME = 18
 MAX_SHORT_NAME = 6			# as per game.h
@@ -63,6 +65,68 @@ BMP_SOURCES	= "/bmp/"		# bitmap images for this dataset should be within
 
 OUT_DIR	= "/out/"
 
+##################################################################################
+#
+# Story text compression
+#
+# Story text is byte-pair encoded; bytes 0x80 and above in story.dat are codes
+# that expand to a pair of bytes from the dictionary written to story.dic. These
+# MUST match the values in data.h.
+#
+##################################################################################
+
+STORY_COMPRESSION = True	# Set to False to write plain ASCII story text
+STORY_DICT_FIRST = 0x80		# First dictionary code, as per data.h
+STORY_DICT_SIZE = 128		# Maximum number of dictionary entries, as per data.h
+STORY_DICT_DEPTH = 8		# Maximum nesting of codes within codes, as per data.h
+
+##################################################################################
+#
+# Story text pre-wrapping
+#
+# Location and splash screen text is word-wrapped for the main window of each
+# target at build time. These MUST match the values in draw.h.
+#
+##################################################################################
+
+STORY_PREWRAP = True		# Set to False to leave all wrapping to the game engine
+TEXT_PREWRAP_START = 0x0E	# Start of pre-wrapped text, followed by its line width
+TEXT_PREWRAP_END = 0x0F		# End of pre-wrapped text
+TEXT_PAGE_BREAK = 0x0C		# Start a new page of text
+
+##################################################################################
+#
+# Location background images
+#
+# A location may name a background bitmap, found in the same bmp/ directories as
+# sprites. It is converted to the native screen format of the target and written
+# as one file per location. The QL file is a 6 byte header (signature, width in
+# pixels, height in rows), then each row as ready-to-copy 16bit screen words.
+# These MUST match the values in draw_ql.h.
+#
+##################################################################################
+
+BACKGROUND_FILE = "bg%03d.scr"	# Per-location background, by location ID
+SCR_SIGNATURE = 0x5153			# 'QS', rows of screen words follow
+SCR_SIGNATURE_LZ = 0x515A		# 'QZ', LZ compressed rows of screen words follow
+
+# Background images are LZ compressed whenever that makes them smaller. The
+# compressed data is a series of tokens; a token byte below 0x80 is followed by
+# (token + 1) literal bytes, otherwise it is followed by a 2 byte offset back into
+# the data already unpacked, from which (token - 0x80 + LZ_MIN_MATCH) bytes are copied.
+BACKGROUND_COMPRESSION = True	# Set to False to always write uncompressed images
+LZ_MIN_MATCH = 4				# Shortest copy, as per draw_ql.h
+LZ_MAX_MATCH = LZ_MIN_MATCH + 0x7F
+LZ_MAX_LITERALS = 0x80
+LZ_MAX_OFFSET = 0xFFFF
+LZ_SEARCH = 64					# Earlier matches looked at for each position
+QL_PALETTE = [					# RGB of each QL colour, in QL pixel order
+	(0, 0, 0),					# Black
+	(0, 255, 0),				# Green
+	(255, 0, 0),				# Red
+	(255, 255, 255),			# White
+]
+
 ##################################################################################
 #
 # A list of the target systems we can build the datafiles for
@@ -74,6 +138,10 @@ AVAILABLE_TARGETS = {
 			'target'	: 'Sinclair QL',
 			'res'		: '512x256 4 colour',
 			'suffix'	: 'ql',
+			'text_cols'	: 48,	# Main window text width in characters, as per ui_ql.h
+			'text_rows'	: 24,	# Main window text height in rows, as per ui_ql.h
+			'bg_width'	: 384,	# Largest background image, as per DRAW_BG_WIDTH in draw_ql.h
+			'bg_height'	: 184,	# As per DRAW_BG_HEIGHT in draw_ql.h
 	},
 }
 
@@ -235,6 +303,22 @@ CONDITIONS = {
 	
 }
 
+# Relative cost of testing each type of condition at runtime, keyed by the
+# first byte of the condition, as per the check_* functions in conditions.c.
+# Used to test the cheapest conditions of a requirement list first, and to
+# report how much work each location asks of the condition checker.
+CONDITION_COST = {
+	0x00 :	1,		# check_NoCond - a constant, or the monsters spawned flag
+	0x01 :	2,		# check_PlayerAttribute - one attribute of one PC
+	0x02 :	8,		# check_PartyAttribute - one attribute of up to 4 PCs
+	0x03 :	1,		# check_PartyState - not yet implemented
+	0x04 :	2,		# check_Map - one visit/loot counter
+	0x05 :	2,		# check_Monster - visit and defeat counters
+	0x06 :	6,		# check_NPC - walks the list of NPCs met
+	0x07 :	64,		# check_ItemWeapon - every inventory slot of every PC (MAX_PLAYERS * MAX_ITEMS)
+	0x08 :	64,		# check_ItemWeapon - as above
+}
+
 # These character types should match
 # the definitions in data.h - and are used to
 # determine when a character is instantiated,
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+
+""" bg_ql.py, Writes a set of test background images, both uncompressed and
+ LZ compressed, for the background loading benchmark of the QL target of the
+ OlderScrolls RPG game engine.
+
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Usage: bg_ql.py ../datafiles bin/bench
+
+ None of the bundled adventures have any background artwork yet, so the
+ images are drawn here: the kinds of scene a location might show, a dithered
+ picture as converted from a photo, and random noise as the worst case. Each
+ is converted and compressed by the same code as datafiles.py uses, and
+ written as bg/qsN_scr and bg/qzN_scr. The header is in host byte order, so
+ that the benchmark can read it with the real draw_ql.c on the development
+ machine.
+"""
+
+import os
+import sys
+import math
+import random
+
+from PIL import Image, ImageDraw
+
+def scene_forest(width, height):
+	""" Hills and trees under an empty sky """
+
+	img = Image.new("RGB", (width, height), (0, 0, 0))
+	d = ImageDraw.Draw(img)
+	d.polygon([(0, 120), (90, 90), (200, 110), (300, 80), (width, 100), (width, height), (0, height)], fill = (0, 255, 0))
+	for x in range(10, width, 46):
+		d.rectangle([x + 14, 100, x + 20, 150], fill = (255, 0, 0))
+		d.ellipse([x, 60, x + 34, 110], fill = (0, 255, 0), outline = (255, 255, 255))
+	d.ellipse([300, 12, 340, 52], fill = (255, 255, 255))
+	return img
+
+def scene_town(width, height):
+	""" A street of houses, with windows, doors and a cobbled road """
+
+	img = Image.new("RGB", (width, height), (0, 0, 0))
+	d = ImageDraw.Draw(img)
+	for x in range(0, width, 64):
+		d.rectangle([x + 4, 60, x + 58, 140], fill = (255, 255, 255))
+		d.polygon([(x, 60), (x + 31, 28), (x + 62, 60)], fill = (255, 0, 0))
+		d.rectangle([x + 12, 76, x + 24, 90], fill = (0, 0, 0))
+		d.rectangle([x + 38, 76, x + 50, 90], fill = (0, 0, 0))
+		d.rectangle([x + 25, 110, x + 37, 140], fill = (255, 0, 0))
+	for y in range(142, height, 6):
+		for x in range((y // 6) % 2 * 6, width, 12):
+			d.rectangle([x, y, x + 9, y + 3], fill = (0, 255, 0))
+	return img
+
+def scene_dithered(width, height):
+	""" An ordered dither of smooth, slightly noisy shading, as a converted photo would be """
+
+	random.seed(2)
+	bayer = [[0, 8, 2, 10], [12, 4, 14, 6], [3, 11, 1, 9], [15, 7, 13, 5]]
+	img = Image.new("RGB", (width, height), (0, 0, 0))
+	for y in range(0, height):
+		for x in range(0, width):
+			level = 8 + (7.5 * math.sin(x / 37.0) * math.cos(y / 23.0)) + random.uniform(-1.5, 1.5)
+			on = level > bayer[y % 4][x % 4]
+			g = 255 if (on and (y < height // 2)) else 0
+			r = 255 if (on and (x > width // 3)) else 0
+			img.putpixel((x, y), (r, g, 0))
+	return img
+
+def scene_noise(width, height):
+	""" Random pixels, which no compressor can do anything with """
+
+	random.seed(1)
+	palette = [(0, 0, 0), (0, 255, 0), (255, 0, 0), (255, 255, 255)]
+	img = Image.new("RGB", (width, height), (0, 0, 0))
+	img.putdata([palette[random.randint(0, 3)] for i in range(0, width * height)])
+	return img
+
+def host_header(scr):
+	""" Rewrite the 3 big-endian words of a screen file header in host byte order """
+
+	header = b""
+	for i in range(0, 6, 2):
+		header += int.from_bytes(scr[i:i + 2], byteorder='big').to_bytes(2, byteorder=sys.byteorder)
+	return header + scr[6:]
+
+if __name__ == "__main__":
+
+	if len(sys.argv) != 3:
+		print("Usage: %s <datafiles directory> <output directory>" % sys.argv[0])
+		sys.exit(1)
+
+	sys.path.insert(0, sys.argv[1])
+	import datafiles
+
+	target = datafiles.AVAILABLE_TARGETS['1']
+	out_dir = sys.argv[2] + "/bg"
+	if not os.path.exists(out_dir):
+		os.makedirs(out_dir)
+
+	scenes = [scene_forest, scene_town, scene_dithered, scene_noise]
+	for i in range(0, len(scenes)):
+		b = datafiles.bmp_to_target(target = target)
+		b.bmp = scenes[i](target['bg_width'], target['bg_height'])
+		b.to_ql()
+		b.out_ql()
+		sizes = []
+		for name, compress in [("qs", False), ("qz", True)]:
+			scr = b.out_ql_scr(compress = compress)
+			f = open("%s/%s%d_scr" % (out_dir, name, i), "wb")
+			f.write(host_header(scr))
+			f.close()
+			sizes.append(len(scr))
+		print("- %-16s %6d bytes, %6d compressed" % (scenes[i].__name__, sizes[0], sizes[1]))
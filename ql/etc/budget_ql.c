@@ -0,0 +1,298 @@
+/* budget_ql.c, Host tool which reports the memory budget of the Sinclair QL
+ target, structure by structure and field by field.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make budget', not on
+// the QL. It includes the same headers, with the same MAX_* settings, as the
+// game itself. To get the sizes that C68 will use it must be built as 32bit
+// code with no more than 16bit alignment, like the 68008:
+//
+//		gcc -m32 -fpack-struct=2 -DTARGET_QL -I./src -I./etc/host etc/budget_ql.c
+//
+// It exits with an error if the fixed footprint is over MEMORY_BUDGET, the
+// same check that main_ql.c makes when the game itself is compiled.
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _UTIL_H
+#include "../common/utils.h"
+#define _UTIL_H
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
+#ifndef _DATA_H
+#include "../common/data.h"
+#endif
+
+// Print the offset and size of one field of a structure
+#define FIELD(s, f)	budget_Field(#f, offsetof(s, f), sizeof(((s *) 0)->f))
+
+unsigned long budget_fields;		// Bytes of the current structure accounted for by its fields
+
+void budget_Struct(char *name, unsigned long size){
+	// Start the breakdown of a structure
+	
+	printf("\n%-28s %6lu bytes\n", name, size);
+	budget_fields = 0;
+}
+
+void budget_Field(char *name, unsigned long offset, unsigned long size){
+	// One line of the breakdown of a structure
+	
+	printf("  %-26s %6lu %6lu\n", name, offset, size);
+	budget_fields += size;
+}
+
+void budget_Padding(unsigned long size){
+	// Finish the breakdown of a structure with any bytes lost to alignment
+	
+	if (size > budget_fields){
+		printf("  %-26s %6s %6lu\n", "(padding)", "", size - budget_fields);
+	}
+}
+
+void budget_Line(char *name, unsigned long size){
+	// One line of the fixed footprint summary
+	
+	printf("  %-26s %6lu\n", name, size);
+}
+
+int main(void){
+	
+	unsigned long total;
+	
+	if (sizeof(void *) != 4){
+		printf("Warning: built with %lu byte pointers, sizes will not match the QL (build with -m32)\n", (unsigned long) sizeof(void *));
+	}
+	
+	printf("Sinclair QL memory budget\n");
+	printf("=========================\n");
+	printf("MAX_PLAYERS %d, MAX_MONSTER_TYPES %d, MAX_LOCATIONS %d, MAX_CHARACTERS %d, MAX_REQUIREMENTS %d\n", MAX_PLAYERS, MAX_MONSTER_TYPES, MAX_LOCATIONS, MAX_CHARACTERS, MAX_REQUIREMENTS);
+	printf("\n%-28s %6s %6s\n", "Structure / field", "offset", "size");
+	
+	// Basic game data, held for the whole session
+	budget_Struct("GameState_t", sizeof(GameState_t));
+	FIELD(GameState_t, text_buffer);
+	FIELD(GameState_t, buf);
+	FIELD(GameState_t, gamemode);
+	FIELD(GameState_t, name);
+	FIELD(GameState_t, level);
+	FIELD(GameState_t, level_previous);
+	FIELD(GameState_t, progress);
+	FIELD(GameState_t, counter);
+	FIELD(GameState_t, version);
+	FIELD(GameState_t, gold);
+	FIELD(GameState_t, players);
+	FIELD(GameState_t, enemies);
+	FIELD(GameState_t, npcs);
+	FIELD(GameState_t, seed1);
+	FIELD(GameState_t, seed2);
+	FIELD(GameState_t, seed);
+	budget_Padding(sizeof(GameState_t));
+	
+	// The current location
+	budget_Struct("LevelState_t", sizeof(LevelState_t));
+	FIELD(LevelState_t, id);
+	FIELD(LevelState_t, name);
+	FIELD(LevelState_t, text);
+	FIELD(LevelState_t, north);
+	FIELD(LevelState_t, south);
+	FIELD(LevelState_t, east);
+	FIELD(LevelState_t, west);
+	FIELD(LevelState_t, north_text);
+	FIELD(LevelState_t, south_text);
+	FIELD(LevelState_t, east_text);
+	FIELD(LevelState_t, west_text);
+	FIELD(LevelState_t, north_require);
+	FIELD(LevelState_t, south_require);
+	FIELD(LevelState_t, east_require);
+	FIELD(LevelState_t, west_require);
+	FIELD(LevelState_t, north_eval_type);
+	FIELD(LevelState_t, south_eval_type);
+	FIELD(LevelState_t, east_eval_type);
+	FIELD(LevelState_t, west_eval_type);
+	FIELD(LevelState_t, north_require_number);
+	FIELD(LevelState_t, south_require_number);
+	FIELD(LevelState_t, east_require_number);
+	FIELD(LevelState_t, west_require_number);
+	FIELD(LevelState_t, spawn_chance);
+	FIELD(LevelState_t, spawn_number);
+	FIELD(LevelState_t, spawn_list);
+	FIELD(LevelState_t, spawn_require);
+	FIELD(LevelState_t, spawn_require_number);
+	FIELD(LevelState_t, spawn_eval_type);
+	FIELD(LevelState_t, text_spawn);
+	FIELD(LevelState_t, text_after_spawn);
+	FIELD(LevelState_t, respawn_chance);
+	FIELD(LevelState_t, respawn_number);
+	FIELD(LevelState_t, respawn_list);
+	FIELD(LevelState_t, respawn_require);
+	FIELD(LevelState_t, respawn_require_number);
+	FIELD(LevelState_t, respawn_eval_type);
+	FIELD(LevelState_t, text_respawn);
+	FIELD(LevelState_t, text_after_respawn);
+	FIELD(LevelState_t, spawned);
+	FIELD(LevelState_t, weapons_list);
+	FIELD(LevelState_t, items_list);
+	FIELD(LevelState_t, items_chance);
+	FIELD(LevelState_t, weapons_number);
+	FIELD(LevelState_t, items_number);
+	FIELD(LevelState_t, items_require);
+	FIELD(LevelState_t, items_require_number);
+	FIELD(LevelState_t, items_eval_type);
+	FIELD(LevelState_t, has_npc1);
+	FIELD(LevelState_t, npc1);
+	FIELD(LevelState_t, npc1_require);
+	FIELD(LevelState_t, npc1_require_number);
+	FIELD(LevelState_t, npc1_eval_type);
+	FIELD(LevelState_t, npc1_text);
+	FIELD(LevelState_t, npc1_text_unique_id);
+	FIELD(LevelState_t, has_npc2);
+	FIELD(LevelState_t, npc2);
+	FIELD(LevelState_t, npc2_require);
+	FIELD(LevelState_t, npc2_require_number);
+	FIELD(LevelState_t, npc2_eval_type);
+	FIELD(LevelState_t, npc2_text);
+	FIELD(LevelState_t, npc2_text_unique_id);
+	FIELD(LevelState_t, has_npc3);
+	FIELD(LevelState_t, npc3);
+	FIELD(LevelState_t, npc3_require);
+	FIELD(LevelState_t, npc3_require_number);
+	FIELD(LevelState_t, npc3_eval_type);
+	FIELD(LevelState_t, npc3_text);
+	FIELD(LevelState_t, npc3_text_unique_id);
+	FIELD(LevelState_t, selected_npc);
+	FIELD(LevelState_t, requires);
+	budget_Padding(sizeof(LevelState_t));
+	
+	// A single PC, NPC or monster
+	budget_Struct("PlayerState_t", sizeof(PlayerState_t));
+	FIELD(PlayerState_t, name);
+	FIELD(PlayerState_t, short_name);
+	FIELD(PlayerState_t, id);
+	FIELD(PlayerState_t, type);
+	FIELD(PlayerState_t, sprite_type);
+	FIELD(PlayerState_t, player_class);
+	FIELD(PlayerState_t, player_race);
+	FIELD(PlayerState_t, level);
+	FIELD(PlayerState_t, profile);
+	FIELD(PlayerState_t, str);
+	FIELD(PlayerState_t, dex);
+	FIELD(PlayerState_t, con);
+	FIELD(PlayerState_t, wis);
+	FIELD(PlayerState_t, intl);
+	FIELD(PlayerState_t, chr);
+	FIELD(PlayerState_t, hp);
+	FIELD(PlayerState_t, hp_reset);
+	FIELD(PlayerState_t, status);
+	FIELD(PlayerState_t, head);
+	FIELD(PlayerState_t, body);
+	FIELD(PlayerState_t, option);
+	FIELD(PlayerState_t, formation);
+	FIELD(PlayerState_t, items);
+	FIELD(PlayerState_t, kills);
+	FIELD(PlayerState_t, spells_cast);
+	FIELD(PlayerState_t, hits_taken);
+	FIELD(PlayerState_t, hits_caused);
+	FIELD(PlayerState_t, weapon_r);
+	FIELD(PlayerState_t, weapon_l);
+	budget_Padding(sizeof(PlayerState_t));
+	
+	// Screen state
+	budget_Struct("Screen_t", sizeof(Screen_t));
+	FIELD(Screen_t, win);
+	FIELD(Screen_t, x);
+	FIELD(Screen_t, y);
+	FIELD(Screen_t, buf);
+	FIELD(Screen_t, offscreen);
+	FIELD(Screen_t, screen);
+	FIELD(Screen_t, indirect);
+	FIELD(Screen_t, dirty);
+	FIELD(Screen_t, vblank_timer);
+	FIELD(Screen_t, popup_steps);
+	FIELD(Screen_t, font_8x8);
+	FIELD(Screen_t, bmp);
+	FIELD(Screen_t, bmpstate);
+	FIELD(Screen_t, players);
+	FIELD(Screen_t, enemies);
+	FIELD(Screen_t, boss);
+	budget_Padding(sizeof(Screen_t));
+	
+	// Player/monster sprite and portrait
+	budget_Struct("ssprite_t", sizeof(ssprite_t));
+	FIELD(ssprite_t, width);
+	FIELD(ssprite_t, height);
+	FIELD(ssprite_t, bpp);
+	FIELD(ssprite_t, portrait);
+	FIELD(ssprite_t, pixels);
+	budget_Padding(sizeof(ssprite_t));
+	
+	// Boss sprite and portrait
+	budget_Struct("lsprite_t", sizeof(lsprite_t));
+	FIELD(lsprite_t, width);
+	FIELD(lsprite_t, height);
+	FIELD(lsprite_t, bpp);
+	FIELD(lsprite_t, portrait);
+	FIELD(lsprite_t, pixels);
+	budget_Padding(sizeof(lsprite_t));
+	
+	// Fixed footprint, as reserved for the startup arena by main()
+	printf("\nFixed footprint (startup arena)\n");
+	budget_Line("GameState_t", ARENA_ALIGN(sizeof(GameState_t)));
+	budget_Line("LevelState_t", ARENA_ALIGN(sizeof(LevelState_t)));
+	budget_Line("Screen_t", ARENA_ALIGN(sizeof(Screen_t)));
+	budget_Line("Sprites, bmp state, font", DRAW_ARENA_BYTES);
+	budget_Line("Party and enemies", GAME_ARENA_BYTES);
+	budget_Line("Scratch region", ARENA_SCRATCH_SIZE);
+	total = ARENA_FIXED_BYTES + ARENA_SCRATCH_SIZE;
+	printf("  %-26s %6lu of %lu (%lu%%)\n", "Total", total, (unsigned long) MEMORY_BUDGET, (total * 100) / MEMORY_BUDGET);
+	
+	
+	// Not part of the arena, but also fixed in size
+	printf("\nShared definitions (static data)\n");
+	budget_Line("Items", ITEM_DEF_CACHE_SIZE * sizeof(ItemDef_t));
+	budget_Line("Weapons", WEAPON_DEF_CACHE_SIZE * sizeof(WeaponDef_t));
+	
+	// Only taken if there is memory to spare once everything else is loaded
+	printf("\nCaches (from whatever memory is left)\n");
+	budget_Line("Map and story, at most", DATA_CACHE_BYTES);
+	budget_Line("Left free, at least", MAP_CACHE_MIN_FREE);
+	
+	if (total > MEMORY_BUDGET){
+		printf("Error: fixed footprint is %lu bytes over budget\n", total - MEMORY_BUDGET);
+		return 1;
+	}
+	if (sizeof(GameState_t) > MEMORY_BUDGET_GAMESTATE){
+		printf("Error: GameState_t is over its budget of %lu bytes\n", (unsigned long) MEMORY_BUDGET_GAMESTATE);
+		return 1;
+	}
+	if (sizeof(LevelState_t) > MEMORY_BUDGET_LEVELSTATE){
+		printf("Error: LevelState_t is over its budget of %lu bytes\n", (unsigned long) MEMORY_BUDGET_LEVELSTATE);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+
+""" cond_ql.py, Writes the requirement lists of an adventure, as compiled into
+ its location records, for the condition benchmark of the QL target of the
+ OlderScrolls RPG game engine.
+
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Usage: cond_ql.py ../datafiles leafy_glade bin/bench
+
+ Every non-empty *_require list in world.py is compiled by the same code as
+ generate_world() uses. The bundled adventures only use AND, so a few more
+ lists are added, written as an adventure would write them in world.py, to
+ cover the other evaluation rules. They are written to cond/requires as:
+
+ 	1 byte	length of the name
+ 	n bytes	name
+ 	1 byte	evaluation rule
+ 	1 byte	number of conditions
+ 	5 bytes	per condition
+"""
+
+import os
+import sys
+
+# Extra requirement lists, in world.py form, using IDs which exist in leafy_glade
+EXTRA_REQUIRES = [
+	["Exit, item or weapon or STR", ["COND_EVAL_OR", 3,
+		["COND_ITEM_TYPE", "COND_ITEM_OWN", 3, 1],
+		["COND_WEAPON_TYPE", "COND_ITEM_OWN", 2, 1],
+		["COND_PC_ATR_TYPE", "COND_TYPE_STR", 14],
+	]],
+	["Exit, no monsters or item", ["COND_EVAL_OR", 2,
+		["COND_NO_MONSTERS"],
+		["COND_ITEM_TYPE", "COND_ITEM_OWN", 4, 1],
+	]],
+	["NPC, not dead and no fight", ["COND_EVAL_NOR", 2,
+		["COND_NPC_TYPE", "COND_NPC_DEAD", 1, 0],
+		["COND_MONSTER_DEFEAT_TYPE", "MONSTER_TYPE_PRIMARY", 3, 1],
+	]],
+	["Items, one of three", ["COND_EVAL_NAND", 3,
+		["COND_NPC_TYPE", "COND_NPC_TALK", 0, 0],
+		["COND_NPC_TYPE", "COND_NPC_TALK", 1, 0],
+		["COND_MAP_VISIT_TYPE", "COND_MAP_VISIT_TYPE_MIN", 3, 2],
+	]],
+	["Spawn, party and visits", ["COND_EVAL_AND", 3,
+		["COND_PARTY_ATR_TYPE", "COND_TYPE_INT", 12],
+		["COND_MAP_VISIT_TYPE", "COND_MAP_VISIT_TYPE_MIN", 2, 1],
+		["COND_MAP_VISIT_TYPE", "COND_MAP_LOOTED_TYPE_MAX", 2, 0],
+	]],
+]
+
+def write_require(f, name, compiled):
+	""" Write one compiled requirement list and its name """
+
+	f.write(bytes([len(name)]))
+	f.write(name.encode('ascii'))
+	for b in compiled['bytes']:
+		f.write(b)
+
+if __name__ == "__main__":
+
+	if len(sys.argv) != 4:
+		print("Usage: %s <datafiles directory> <adventure> <output directory>" % sys.argv[0])
+		sys.exit(1)
+
+	datafiles_dir = sys.argv[1]
+	adventure = sys.argv[2]
+	out_dir = sys.argv[3] + "/cond"
+
+	sys.path.insert(0, datafiles_dir)
+	import datafiles
+
+	game_world = __import__(adventure + ".world", globals(), locals(), ["MAP"])
+	game_monsters = __import__(adventure + ".monster", globals(), locals(), ["MONSTER"])
+	game_items = __import__(adventure + ".items", globals(), locals(), ["ITEMS"])
+	game_weapons = __import__(adventure + ".weapons", globals(), locals(), ["WEAPONS"])
+
+	# The same ID lists as generate_world() builds
+	location_ids = sorted(game_world.MAP.keys())
+	npc_ids = sorted(game_monsters.NPC.keys())
+	monster_ids = sorted(game_monsters.MONSTER.keys())
+	item_ids = sorted(game_items.ITEMS.keys())
+	weapon_ids = sorted(game_weapons.WEAPONS.keys())
+
+	requires = []
+	for location_id in location_ids:
+		location = game_world.MAP[location_id]
+		for r in ["north", "south", "east", "west", "spawn", "respawn", "items", "npc1", "npc2", "npc3"]:
+			if len(location[r + "_require"]) > 0:
+				requires.append(["%s, %s" % (location['name'][:18], r), location[r + "_require"]])
+	requires += EXTRA_REQUIRES
+
+	if not os.path.exists(out_dir):
+		os.makedirs(out_dir)
+	f = open(out_dir + "/requires", "wb")
+	for name, require in requires:
+		compiled = datafiles.compile_requirement(location_ids, [], monster_ids, npc_ids, item_ids, weapon_ids, [], require, name)
+		if compiled is False:
+			sys.exit(1)
+		write_require(f, name, compiled)
+	f.close()
+
+	print("%d requirement lists from %s written to %s/requires" % (len(requires), adventure, out_dir))
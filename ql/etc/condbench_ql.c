@@ -0,0 +1,432 @@
+/* condbench_ql.c, Host benchmark of requirement list evaluation, with the
+ short-circuit check_Eval() and with the original evaluate-everything loop.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make condbench'.
+// etc/cond_ql.py first compiles the requirement lists of a bundled adventure,
+// as datafiles.py does for the location records, into bin/bench/cond. Each
+// list is then evaluated through the real conditions.c, by check_Eval(), and
+// by a replay of the original check_Cond(), which copied every condition out,
+// ran all of them through a switch and only then applied the AND/OR/NOR/NAND
+// rule. The two must agree.
+//
+// Each list is run against a new game, a game part way through and a game
+// where everything has been done, as results (and how soon check_Eval() can
+// stop) depend on the state of the game. The host is far faster than a 68008,
+// so only the ratio between the two timings and the number of conditions
+// tested say anything about the QL.
+//
+// Then a turn is replayed: something changes, as moving to a location does,
+// and every list is checked CONDBENCH_CHECKS times, as the exits are checked
+// when the location is drawn and again on move, and NPCs on draw and again
+// on talk. This is timed through check_Cond(), with its cache of results, and
+// through check_Eval() on its own, which is how every check used to be done.
+// On the host, looking a list up in the cache costs about as much as testing
+// the cheap conditions in these lists; on the QL, where a condition costs
+// far more, the number of conditions tested is the better guide.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#define _GAME_H
+#endif
+#ifndef _CONDITIONS_H
+#include "../common/conditions.h"
+#define _CONDITIONS_H
+#endif
+#ifndef _ENGINE_H
+#include "../common/engine.h"
+#endif
+#include "host/bench_ql.h"
+
+#define CONDBENCH_LISTS		64			// Most requirement lists read from cond/requires
+#define CONDBENCH_STATES	3			// Game states each list is evaluated against
+#define CONDBENCH_CALLS		2000000UL	// Evaluations of each list, in each state, for the timings
+#define CONDBENCH_TURNS		200000UL	// Turns replayed in each state, for the timings
+#define CONDBENCH_CHECKS	2			// Times every list is checked in a turn
+
+// One compiled requirement list
+typedef struct {
+	char name[32];
+	unsigned char eval_type;
+	unsigned char number;
+	unsigned char requires[MAX_LOCATION_REQUIREMENTS * COND_LENGTH];
+} CondList_t;
+
+extern check_func_t check_table[COND_TYPES];
+
+CondList_t condbench_lists[CONDBENCH_LISTS];
+unsigned char condbench_count;
+
+GameState_t condbench_gamestate[CONDBENCH_STATES];
+LevelState_t condbench_levelstate;
+PartyState_t condbench_party;
+PlayerState_t condbench_players[MAX_PLAYERS];
+GameState_t condbench_turn;					// Copy of a game state, for replaying turns
+unsigned short condbench_version;			// Last gamestate->version used, so cached results never carry over between states
+
+char *condbench_state_names[CONDBENCH_STATES] = {
+	"new game",
+	"part way",
+	"all done",
+};
+
+check_func_t condbench_table[COND_TYPES];	// The real check_table[], while it is counting
+unsigned long condbench_tested;				// Conditions tested while counting
+
+int condbench_Read(char *filename){
+	// Load the compiled requirement lists written by etc/cond_ql.py
+
+	FILE *f;
+	unsigned char len;
+	CondList_t *list;
+
+	f = fopen(filename, "rb");
+	if (f == NULL){
+		printf("Error: unable to open %s, run etc/cond_ql.py first\n", filename);
+		return -1;
+	}
+	condbench_count = 0;
+	while ((condbench_count < CONDBENCH_LISTS) && (fread(&len, 1, 1, f) == 1)){
+		list = &condbench_lists[condbench_count];
+		memset(list, 0, sizeof(CondList_t));
+		if (len >= sizeof(list->name)){
+			len = sizeof(list->name) - 1;
+		}
+		fread(list->name, 1, len, f);
+		fread(&list->eval_type, 1, 1, f);
+		fread(&list->number, 1, 1, f);
+		if (list->number > MAX_LOCATION_REQUIREMENTS){
+			printf("Error: %s has %d conditions\n", list->name, list->number);
+			fclose(f);
+			return -1;
+		}
+		fread(list->requires, COND_LENGTH, list->number, f);
+		condbench_count++;
+	}
+	fclose(f);
+	return 0;
+}
+
+void condbench_Party(unsigned char stats, unsigned char items){
+	// A full party, every member with the same attributes, sharing
+	// the first 'items' items and weapons from the adventure
+
+	unsigned char p, i;
+	PlayerState_t *pc;
+
+	for (p = 0; p < MAX_PLAYERS; p++){
+		pc = &condbench_players[p];
+		pc->level = 1;
+		pc->str = stats;
+		pc->dex = stats;
+		pc->con = stats;
+		pc->wis = stats;
+		pc->intl = stats;
+		pc->chr = stats;
+		pc->hp = stats;
+		for (i = 0; i < MAX_ITEMS; i++){
+			pc->items[i].item_type = 0;
+			pc->items[i].item_id = 0;
+		}
+		for (i = 0; i < items; i++){
+			pc->items[i * 2].item_type = 'i';
+			pc->items[i * 2].item_id = i + 1;
+			pc->items[(i * 2) + 1].item_type = 'w';
+			pc->items[(i * 2) + 1].item_id = i + 1;
+		}
+		condbench_party.player[p] = pc;
+	}
+}
+
+void condbench_States(){
+	// A new game, one part way through, and one where every location has
+	// been visited, looted and cleared, and every NPC met
+
+	GameState_t *g;
+	unsigned short id;
+	unsigned char n;
+
+	for (n = 0; n < CONDBENCH_STATES; n++){
+		g = &condbench_gamestate[n];
+		memset(g, 0, sizeof(GameState_t));
+		g->players = &condbench_party;
+		g->counter = 50 * n;
+		for (id = 0; id < (n * 3); id++){
+			progress_Visit(g, id);
+			if (n > 1){
+				progress_Visit(g, id);
+				progress_Loot(g, id);
+				progress_Defeat(g, id, PROGRESS_PRIMARY);
+				progress_Defeat(g, id, PROGRESS_SECONDARY);
+			}
+		}
+		for (id = 0; id < n; id++){
+			g->npcs.met[id >> 3] |= (1 << (id & 0x07));
+			g->npcs.talked_time[id] = 10;
+		}
+	}
+}
+
+unsigned char condbench_OldCond(GameState_t *gamestate, LevelState_t *levelstate, unsigned char *requires, unsigned char number, unsigned char eval_type){
+	// Replay of the original check_Cond(): every condition copied out,
+	// tested through a switch, and the rule applied to the totals
+
+	unsigned char result = 0;
+	unsigned char total_false = 0;
+	unsigned char total_true = 0;
+	unsigned char i;
+	unsigned char cond[COND_LENGTH];
+	unsigned char retval = 0;
+
+	if (number == 0){
+		return 1;
+	}
+	for (i = 0; i < number; i++){
+		memcpy(cond, requires + (i * COND_LENGTH), COND_LENGTH);
+		switch(cond[0]){
+			case SIMPLE_COND_TYPE:
+				result = check_NoCond(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_PC_ATR_TYPE:
+				result = check_PlayerAttribute(gamestate, levelstate, (char *) cond, 1);
+				break;
+			case COND_PARTY_ATR_TYPE:
+				result = check_PartyAttribute(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_PARTY_MEMBER_TYPE:
+				result = check_PartyState(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_MAP_VISIT_TYPE:
+				result = check_Map(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_MONSTER_DEFEAT_TYPE:
+				result = check_Monster(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_NPC_TYPE:
+				result = check_NPC(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_ITEM_TYPE:
+				result = check_Item(gamestate, levelstate, (char *) cond);
+				break;
+			case COND_WEAPON_TYPE:
+				result = check_Weapon(gamestate, levelstate, (char *) cond);
+				break;
+			default:
+				return 0;
+		}
+		if (result){
+			total_true++;
+		} else {
+			total_false++;
+		}
+	}
+	switch(eval_type){
+		case COND_EVAL_AND:
+			retval = (total_true == number);
+			break;
+		case COND_EVAL_OR:
+			retval = (total_true > 0);
+			break;
+		case COND_EVAL_NOR:
+			retval = (total_false == number);
+			break;
+		case COND_EVAL_NAND:
+			retval = (total_true <= 1);
+			break;
+		default:
+			break;
+	}
+	return retval;
+}
+
+unsigned char condbench_Counted(GameState_t *gamestate, LevelState_t *levelstate, char *cond){
+	// Stands in for every entry of check_table[], counting each condition tested
+
+	condbench_tested++;
+	return condbench_table[(unsigned char) cond[0]](gamestate, levelstate, cond);
+}
+
+void condbench_Counting(unsigned char on){
+	// Put the counting stand-in into every entry of check_table[], or put the real functions back
+
+	unsigned char i;
+
+	if (on){
+		memcpy(condbench_table, check_table, sizeof(condbench_table));
+		for (i = 0; i < COND_TYPES; i++){
+			check_table[i] = condbench_Counted;
+		}
+		condbench_tested = 0;
+	} else {
+		memcpy(check_table, condbench_table, sizeof(condbench_table));
+	}
+}
+
+unsigned long condbench_Tested(CondList_t *list, GameState_t *gamestate){
+	// Number of conditions check_Eval() tests before the outcome is known
+
+	condbench_Counting(1);
+	check_Eval(gamestate, &condbench_levelstate, list->requires, list->number, list->eval_type);
+	condbench_Counting(0);
+	return condbench_tested;
+}
+
+double condbench_Run(CondList_t *list, GameState_t *gamestate, unsigned char old){
+	// Evaluate a list over and over, returning the time per call in nanoseconds
+
+	unsigned long i;
+	unsigned long passed = 0;
+	double start;
+
+	start = bench_Now();
+	for (i = 0; i < CONDBENCH_CALLS; i++){
+		if (old){
+			passed += condbench_OldCond(gamestate, &condbench_levelstate, list->requires, list->number, list->eval_type);
+		} else {
+			passed += check_Eval(gamestate, &condbench_levelstate, list->requires, list->number, list->eval_type);
+		}
+	}
+	// Use the results, so the calls cannot be left out
+	if (passed > CONDBENCH_CALLS){
+		printf("Error: impossible result count\n");
+	}
+	return ((bench_Now() - start) * 1000000000.0) / CONDBENCH_CALLS;
+}
+
+unsigned long condbench_Turns(GameState_t *state, unsigned long turns, unsigned char cached){
+	// Replay turns in a game state, every list checked CONDBENCH_CHECKS
+	// times after each change, through check_Cond() or check_Eval().
+	// Returns the number of lists which passed.
+
+	unsigned long t;
+	unsigned long passed = 0;
+	unsigned char i, r;
+	GameState_t *g = &condbench_turn;
+	CondList_t *list;
+
+	memcpy(g, state, sizeof(GameState_t));
+	g->version = condbench_version;
+	for (t = 0; t < turns; t++){
+		check_Changed(g);
+		for (r = 0; r < CONDBENCH_CHECKS; r++){
+			for (i = 0; i < condbench_count; i++){
+				list = &condbench_lists[i];
+				if (cached){
+					passed += check_Cond(g, &condbench_levelstate, list->requires, list->number, list->eval_type);
+				} else {
+					passed += check_Eval(g, &condbench_levelstate, list->requires, list->number, list->eval_type);
+				}
+			}
+		}
+	}
+	condbench_version = g->version;
+	return passed;
+}
+
+void condbench_TurnLine(unsigned char n){
+	// Time turns in one game state, with and without the cache of results
+
+	unsigned long passed[2];
+	unsigned long tested[2];
+	double elapsed[2];
+	double start;
+	unsigned char cached;
+
+	for (cached = 0; cached < 2; cached++){
+		// One turn to count the conditions tested
+		condbench_Counting(1);
+		passed[cached] = condbench_Turns(&condbench_gamestate[n], 1, cached);
+		condbench_Counting(0);
+		tested[cached] = condbench_tested;
+
+		start = bench_Now();
+		condbench_Turns(&condbench_gamestate[n], CONDBENCH_TURNS, cached);
+		elapsed[cached] = ((bench_Now() - start) * 1000000000.0) / CONDBENCH_TURNS;
+	}
+	if (passed[0] != passed[1]){
+		printf("Error: %ld lists pass with the cache, %ld without, in a %s game\n", passed[1], passed[0], condbench_state_names[n]);
+		bench_errors++;
+	}
+	printf("  %-30s %6ld %6ld %9.1f %9.1f %7.1fx\n", condbench_state_names[n],
+		tested[0], tested[1], elapsed[0], elapsed[1], elapsed[0] / elapsed[1]);
+}
+
+int main(void){
+
+	unsigned char i, n;
+	unsigned char before_result, after_result;
+	unsigned long tested;
+	unsigned long tested_total = 0, number_total = 0;
+	double before, after;
+	double before_total = 0, after_total = 0;
+	CondList_t *list;
+
+	if (condbench_Read("bin/bench/cond/requires") != 0){
+		return 1;
+	}
+	condbench_Party(12, 2);
+	condbench_States();
+
+	printf("Sinclair QL requirement list evaluation, on the host\n");
+	printf("====================================================\n");
+	printf("%d requirement lists, each run in %d game states\n\n", condbench_count, CONDBENCH_STATES);
+	printf("  %-30s %-8s %5s %6s %9s %9s %8s\n", "", "state", "conds", "tested", "old ns", "new ns", "speedup");
+
+	for (i = 0; i < condbench_count; i++){
+		list = &condbench_lists[i];
+		for (n = 0; n < CONDBENCH_STATES; n++){
+			before_result = condbench_OldCond(&condbench_gamestate[n], &condbench_levelstate, list->requires, list->number, list->eval_type);
+			after_result = check_Eval(&condbench_gamestate[n], &condbench_levelstate, list->requires, list->number, list->eval_type);
+			if (before_result != after_result){
+				printf("Error: %s gives %d, was %d, in a %s game\n", list->name, after_result, before_result, condbench_state_names[n]);
+				return 1;
+			}
+			tested = condbench_Tested(list, &condbench_gamestate[n]);
+			before = condbench_Run(list, &condbench_gamestate[n], 1);
+			after = condbench_Run(list, &condbench_gamestate[n], 0);
+			tested_total += tested;
+			number_total += list->number;
+			before_total += before;
+			after_total += after;
+			printf("  %-30s %-8s %5d %6ld %9.1f %9.1f %7.1fx\n", (n == 0) ? list->name : "",
+				condbench_state_names[n], list->number, tested, before, after, before / after);
+		}
+	}
+
+	printf("\nConditions tested: %ld of %ld, all lists in all states.\n", tested_total, number_total);
+	printf("Time for every list in every state: %.0fns old, %.0fns new, %.1fx.\n", before_total, after_total, before_total / after_total);
+
+	printf("\nOne turn: a change, then every list checked %d times\n\n", CONDBENCH_CHECKS);
+	printf("  %-30s %13s %19s %8s\n", "", "conds tested", "ns per turn", "speedup");
+	printf("  %-30s %6s %6s %9s %9s\n", "state", "eval", "cache", "eval", "cache");
+	for (n = 0; n < CONDBENCH_STATES; n++){
+		condbench_TurnLine(n);
+	}
+
+	if (bench_errors){
+		printf("Error: %d errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+/* fillbench_ql.c, Host microbenchmark of the cost of filling each 8 pixel block
+ of the screen, with draw_Fill() and with the original word at a time loops.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make fillbench'. The
+// rectangles that the UI draws most are filled through the real draw_ql.c,
+// and through a replay of the loops that draw_Clear() and draw_HLine() used
+// before draw_Fill(), which stored one 16bit word (8 pixels) at a time.
+//
+// Costs are given in CPU cycles per 8 pixel block, read from the time stamp
+// counter on x86 hosts, or in nanoseconds anywhere else. The host is far
+// faster than a 68008, so only the ratio between the two columns says
+// anything about the QL; the host compiler may also turn the plain word loop
+// of the old draw_Clear() into a block fill of its own.
+//
+// draw_Fill() stores 32bit long words as 'unsigned long', as on the QL, so
+// this has to be built as 32bit code like the other benchmarks.
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DRAW_H
+#include "../common/draw.h"
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#endif
+#include "host/bench_ql.h"
+
+#define FILLBENCH_BLOCKS	50000000UL	// 8 pixel blocks filled by each test
+
+// A rectangle to fill
+typedef struct {
+	char *name;
+	unsigned short x;
+	unsigned short y;
+	unsigned short length;
+	unsigned short height;
+	unsigned short fill;
+	unsigned char hatch;
+} FillTest_t;
+
+FillTest_t fillbench_tests[] = {
+	{ "Clear screen",				0,		0,		SCREEN_WIDTH,	SCREEN_HEIGHT,	PIXEL_BLACK,			0 },
+	{ "Background, 384x184",		8,		16,		384,			184,			PIXEL_BLACK,			0 },
+	{ "Window, 300x150 unaligned",	13,		40,		300,			150,			PIXEL_GREEN,			0 },
+	{ "Window, 300x150 stippled",	13,		40,		300,			150,			PIXEL_WHITE_STIPPLED,	1 },
+	{ "Window, 300x150 yellow",		13,		40,		300,			150,			PIXEL_YELLOW,			1 },
+	{ "Line, 200x1 unaligned",		3,		100,	200,			1,				PIXEL_RED,				0 },
+};
+
+Screen_t fillbench_screen;
+
+double fillbench_Ticks(){
+	// Current time stamp counter, or time in nanoseconds without one
+
+#if defined(__i386__) || defined(__x86_64__)
+	return (double) __rdtsc();
+#else
+	return bench_Now() * 1000000000.0;
+#endif
+}
+
+void fillbench_OldFill(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short height, unsigned short fill){
+	// Replay of the original fill: each row drawn as a line, with masked
+	// end words and every word in between stored on its own
+
+	unsigned short *p;
+	unsigned short row;
+	unsigned short c;
+	unsigned short start_p;
+	unsigned short end_p;
+	unsigned char start_bits;
+	unsigned char end_bits;
+
+	for (row = 0; row < height; row++){
+		draw_GetXY(x, y + row, &start_p, &start_bits);
+		draw_GetXY(x + length, y + row, &end_p, &end_bits);
+		p = (unsigned short*) screen->buf;
+		p += start_p;
+		c = start_p;
+		if (start_bits != 0){
+			*p = fill & ((0xFF >> start_bits) * 0x0101);
+			p++;
+			c++;
+		}
+		while (c < end_p){
+			*p = fill;
+			p++;
+			c++;
+		}
+		if (end_bits != 0){
+			*p = fill & (((0xFF << (8 - end_bits)) & 0xFF) * 0x0101);
+		}
+		draw_Dirty(screen, y + row, 1);
+	}
+}
+
+void fillbench_OldClear(Screen_t *screen){
+	// Replay of the original draw_Clear(), one word at a time
+
+	unsigned short i;
+	unsigned short *p;
+
+	p = (unsigned short*) screen->buf;
+	for (i = 0 ; i < SCREEN_BLOCKS; i++){
+		*p = PIXEL_BLACK;
+		p++;
+	}
+}
+
+double fillbench_Run(FillTest_t *test, unsigned char old){
+	// Fill one rectangle over and over, returning the cost per 8 pixel block
+
+	unsigned long blocks = ((unsigned long) test->length * test->height) / 8;
+	unsigned long i;
+	unsigned long n = FILLBENCH_BLOCKS / blocks;
+	double start;
+
+	start = fillbench_Ticks();
+	for (i = 0; i < n; i++){
+		if (test->length == SCREEN_WIDTH){
+			if (old){
+				fillbench_OldClear(&fillbench_screen);
+			} else {
+				draw_Clear(&fillbench_screen);
+			}
+		} else if (old){
+			fillbench_OldFill(&fillbench_screen, test->x, test->y, test->length, test->height, test->fill);
+		} else {
+			draw_Fill(&fillbench_screen, test->x, test->y, test->length, test->height, test->fill, 0, test->hatch, MODE_PIXEL_SET);
+		}
+	}
+	return (fillbench_Ticks() - start) / ((double) n * blocks);
+}
+
+int main(void){
+
+	unsigned char i;
+	double before, after;
+
+	if (bench_Screen(&fillbench_screen) != SCREEN_INIT_OK){
+		return 1;
+	}
+
+	printf("Sinclair QL rectangle fill cost per 8 pixel block, on the host\n");
+	printf("==============================================================\n");
+#if defined(__i386__) || defined(__x86_64__)
+	printf("In CPU cycles (time stamp counter)\n\n");
+#else
+	printf("In nanoseconds\n\n");
+#endif
+	printf("  %-28s %8s %10s %10s %8s\n", "", "blocks", "word loop", "draw_Fill", "speedup");
+	for (i = 0; i < (sizeof(fillbench_tests) / sizeof(FillTest_t)); i++){
+		before = fillbench_Run(&fillbench_tests[i], 1);
+		after = fillbench_Run(&fillbench_tests[i], 0);
+		printf("  %-28s %8ld %10.2f %10.2f %7.1fx\n", fillbench_tests[i].name,
+			((unsigned long) fillbench_tests[i].length * fillbench_tests[i].height) / 8,
+			before, after, before / after);
+	}
+
+	bench_ScreenExit(&fillbench_screen);
+	if (bench_errors){
+		printf("Error: %d errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+
+""" font_ql.py, Turns the 8x8 font bitmap into a C table for the QL target
+ of the OlderScrolls RPG game engine, so that the font does not have to be
+ loaded and sliced up from a BMP file every time the game starts.
+ 
+ Copyright (C) 2021  John Snowdon
+  
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Usage: font_ql.py assets/font8x8.bmp > src/font_ql.c
+"""
+
+import sys
+import struct
+
+FONT_WIDTH = 8				# As per BMP_FONT_MAX_WIDTH in bmp_ql.h
+FONT_HEIGHT = 8				# As per BMP_FONT_MAX_HEIGHT in bmp_ql.h
+MAX_SYMBOLS = 96			# As per BMP_MAX_SYMBOLS in bmp_ql.h
+ASCII_START = 32			# First symbol is ' ' (space)
+UNKNOWN_SYMBOL = 37			# Unknown characters are replaced with '%' (percent)
+
+def read_font(filename):
+	""" Slice a 1bpp BMP into one byte per row of each 8x8 symbol, left to
+	right and then top to bottom, in the same way as bmp_ReadFont() """
+	
+	data = open(filename, "rb").read()
+	if data[0:2] != b"BM":
+		raise Exception("%s is not a BMP file" % filename)
+	offset = struct.unpack("<I", data[10:14])[0]
+	width, height = struct.unpack("<ii", data[18:26])
+	bpp = struct.unpack("<H", data[28:30])[0]
+	if bpp != 1:
+		raise Exception("%s is %d bpp, only 1bpp fonts are supported" % (filename, bpp))
+	
+	# Rows are padded to 4 bytes, and stored bottom to top unless the height is negative
+	row_bytes = ((width + 31) // 32) * 4
+	rows = []
+	for y in range(0, abs(height)):
+		start = offset + (y * row_bytes)
+		rows.append(data[start:start + (width // 8)])
+	if height > 0:
+		rows.reverse()
+	
+	symbols = []
+	for h in range(0, abs(height) // FONT_HEIGHT):
+		for w in range(0, width // FONT_WIDTH):
+			if len(symbols) < MAX_SYMBOLS:
+				symbols.append([rows[(h * FONT_HEIGHT) + r][w] for r in range(0, FONT_HEIGHT)])
+	return symbols
+
+if __name__ == "__main__":
+	
+	if len(sys.argv) != 2:
+		print("Usage: %s font.bmp > font_ql.c" % sys.argv[0])
+		sys.exit(1)
+	
+	symbols = read_font(sys.argv[1])
+	
+	print("/* font_ql.c, The 8x8 font for the Sinclair QL.")
+	print("")
+	print(" Generated by etc/font_ql.py from %s - do not edit." % sys.argv[1])
+	print("*/")
+	print("")
+	print("#include <stdlib.h>")
+	print("")
+	print("#include \"bmp_ql.h\"")
+	print("")
+	print("fontdata_t font_8x8_data = {")
+	print("\t%d,\t\t// Width of each character, in pixels" % FONT_WIDTH)
+	print("\t%d,\t\t// Height of each character, in pixels" % FONT_HEIGHT)
+	print("\t%d,\t\t// ASCII number of symbol 0" % ASCII_START)
+	print("\t%d,\t\t// Total number of symbols" % len(symbols))
+	print("\t%d,\t\t// Which symbol do we map to unknown/missing symbols?" % UNKNOWN_SYMBOL)
+	print("\t{")
+	for i in range(0, len(symbols)):
+		row_list = ", ".join(["0x%02X" % b for b in symbols[i]])
+		if (ASCII_START + i) == 92:
+			# A trailing backslash would continue the comment onto the next line
+			print("\t\t{ %s },\t// %3d backslash" % (row_list, ASCII_START + i))
+		elif (ASCII_START + i) < 127:
+			print("\t\t{ %s },\t// %3d '%s'" % (row_list, ASCII_START + i, chr(ASCII_START + i)))
+		else:
+			print("\t\t{ %s },\t// %3d" % (row_list, ASCII_START + i))
+	print("\t},")
+	print("\tNULL\t\t// Colour expanded symbols are built by draw_ExpandFont()")
+	print("};")
@@ -0,0 +1,79 @@
+/* bench_ql.c, Helpers shared by the host benchmarks of the Sinclair QL target.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <time.h>
+
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DRAW_H
+#include "../common/draw.h"
+#endif
+#include "bench_ql.h"
+
+unsigned short bench_errors = 0;
+unsigned long bench_seed = 1;
+
+void ui_DrawError(Screen_t *screen, char *title, char *text, short errorcode){
+	// Report game errors on the console; only the first is printed in full
+	
+	if (bench_errors == 0){
+		printf("Error: %s %s (%d)\n", title, text, errorcode);
+	}
+	bench_errors++;
+}
+
+double bench_Now(){
+	// Current time, in seconds
+	
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + (t.tv_nsec / 1000000000.0);
+}
+
+void bench_Seed(unsigned long seed){
+	// Restart the pseudo random sequence, so that every run builds the same test data
+	
+	bench_seed = seed;
+}
+
+unsigned short bench_Rand(unsigned short range){
+	// A pseudo random number from 0 to range - 1
+	
+	bench_seed = (bench_seed * 1103515245UL) + 12345UL;
+	return ((bench_seed >> 16) & 0x7fff) % range;
+}
+
+void bench_Put(FILE *f, unsigned long value, unsigned char size){
+	// Write a 1, 2 or 4 byte number to a test datafile, in host byte order
+	
+	unsigned char b = value;
+	unsigned short s = value;
+	unsigned int l = value;
+	
+	if (size == 1){
+		fwrite(&b, 1, 1, f);
+	}
+	if (size == 2){
+		fwrite(&s, 2, 1, f);
+	}
+	if (size == 4){
+		fwrite(&l, 4, 1, f);
+	}
+}
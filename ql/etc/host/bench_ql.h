@@ -0,0 +1,50 @@
+/* bench_ql.h, Helpers shared by the host benchmarks of the Sinclair QL target.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The benchmarks in ql/etc are built and run on the development machine,
+// linked against the real game sources (see the bench targets in the
+// Makefile). bench_ql.c provides the few functions they need from the parts
+// of the game that are not linked in, e.g. ui_DrawError().
+//
+// Numbers read from, or written to, datafiles by a benchmark are in the byte
+// order of the host, so that the game code decodes them just as the QL decodes
+// the big-endian datafiles built by datafiles.py.
+
+#ifndef _BENCH_QL_H
+#define _BENCH_QL_H
+
+// Rough model of a QL with a floppy disk interface, for benchmarks which
+// estimate load times on the QL from what the game asks the disk for
+#define QL_DISK_BYTES		20000	// Sustained floppy read rate, bytes per second
+#define QL_SECTOR_BYTES		512		// Files are read from disk a whole sector at a time
+#define QL_TRAP_US			400		// QDOS trap overhead of each read, in microseconds
+#define QL_CPU_HZ			7500000	// 68008 clock
+
+extern unsigned short bench_errors;		// Number of calls to ui_DrawError() so far
+
+double bench_Now();
+unsigned short bench_Rand(unsigned short range);
+void bench_Seed(unsigned long seed);
+void bench_Put(FILE *f, unsigned long value, unsigned char size);
+
+// In screen_ql.c, for benchmarks linked with draw_ql.c
+#ifdef _DRAW_H
+int bench_Screen(Screen_t *screen);
+void bench_ScreenExit(Screen_t *screen);
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+/* nodraw_ql.c, Stand-ins for the drawing functions called by the data layer,
+ for host benchmarks which are not linked with draw_ql.c.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+void draw_SpriteUncache(unsigned short *pixels){
+	// There are no shifted sprite copies to forget
+}
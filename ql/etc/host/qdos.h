@@ -0,0 +1,14 @@
+/* qdos.h, Minimal stand-in for the C68 QDOS header, so that the QL
+ headers can be included by host tools such as budget_ql.c. Only
+ the types used in structure definitions are needed, plus the few
+ QDOS calls made by draw_ql.c (see host/screen_ql.c).
+*/
+
+#ifndef _QDOS_H
+#define _QDOS_H
+
+typedef long chanid_t;		// QDOS channel ID, 32bit as on the QL
+
+chanid_t io_open(const char *name, long mode);
+
+#endif
@@ -0,0 +1,81 @@
+/* screen_ql.c, A screen for host benchmarks which are linked with draw_ql.c,
+ and stand-ins for the QDOS calls that screen_Init() makes.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <qdos.h>
+
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DRAW_H
+#include "../common/draw.h"
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#endif
+#include "bench_ql.h"
+
+chanid_t io_open(const char *name, long mode){
+	// There is no console channel on the host
+	return 0;
+}
+
+void poll_init(volatile unsigned int *counter){
+	// There is no vblank interrupt on the host, screen_Vsync() must not be called
+}
+
+unsigned char data_CacheShrink(){
+	// There are no map or story caches to give memory back
+	return 0;
+}
+
+int bench_Screen(Screen_t *screen){
+	// Set up a screen as screen_Init() does, drawing into an offscreen buffer
+	// in host memory. There is no QL video memory, so draw_Flip() must not be called.
+	
+	int status;
+	
+	memset(screen, 0, sizeof(Screen_t));
+	arena_Init(DRAW_ARENA_BYTES);
+	status = screen_Init(screen);
+	if (status != SCREEN_INIT_OK){
+		return status;
+	}
+	screen->offscreen = calloc(SCREEN_BYTES, 1);
+	if (screen->offscreen == NULL){
+		printf("Error: unable to allocate a host screen\n");
+		return -1;
+	}
+	screen->buf = (unsigned short *) screen->offscreen;
+	screen->indirect = 1;
+	screen->screen = 0;
+	return SCREEN_INIT_OK;
+}
+
+void bench_ScreenExit(Screen_t *screen){
+	// Release the host screen and the arena
+	
+	screen_Exit(screen);
+	arena_Exit();
+}
@@ -0,0 +1,364 @@
+/* iobench_ql.c, Host benchmark which counts the datafile system calls made
+ to load a location, with the old field-by-field loader and the current one.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make iobench'. It
+// writes a test world (map and story datafiles) into the current directory,
+// shaped like the bundled adventures: up to 3 conditions per location, spawn
+// and reward lists, NPCs, and story text of up to 700 characters. Each location
+// is then loaded, as game_Map() does, through the real data_ql.c.
+//
+// Every open(), close(), lseek() and read() on the QL is a trap into QDOS, so
+// the number of calls is what matters most. The 'before' figures are from a
+// replay of the original loader, which opened both files for every load and
+// read each field of the record with its own read().
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DATA_H
+#include "../common/data.h"
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
+#include "host/bench_ql.h"
+
+#define IOBENCH_LOCATIONS	40		// Locations in the test world
+#define IOBENCH_STORY_MIN	150		// Shortest story text
+#define IOBENCH_STORY_MAX	700		// Longest story text, more than one record buffer
+
+// System calls made by one loader
+typedef struct {
+	unsigned long opens;
+	unsigned long closes;
+	unsigned long seeks;
+	unsigned long reads;
+} IOCount_t;
+
+IOCount_t iobench_old;				// Calls made by the replay of the original loader
+
+GameState_t iobench_gamestate;
+LevelState_t iobench_levelstate;
+Screen_t iobench_screen;
+
+void iobench_Requires(FILE *f, unsigned char number){
+	// Write an eval type, a requirement count and that many 5 byte requirements
+
+	unsigned char i;
+
+	bench_Put(f, number ? 1 : 0, 1);
+	bench_Put(f, number, 1);
+	for (i = 0; i < (number * REQUIREMENT_BYTES); i++){
+		bench_Put(f, bench_Rand(256), 1);
+	}
+}
+
+unsigned short iobench_WriteLocation(FILE *f, unsigned short id){
+	// Write one test map record, returning its size
+
+	long start;
+	unsigned char i, n;
+	unsigned char requires[10];
+
+	start = ftell(f);
+
+	// Spread up to 3 conditions over the 10 requirement lists
+	memset(requires, 0, sizeof(requires));
+	n = bench_Rand(4);
+	for (i = 0; i < n; i++){
+		requires[bench_Rand(10)]++;
+	}
+
+	bench_Put(f, id, 2);
+	bench_Put(f, id, 2);						// Story text, one per location
+	for (i = 0; i < MAX_LEVEL_NAME_SIZE; i++){
+		bench_Put(f, (i < 12) ? 'A' + bench_Rand(26) : 0, 1);
+	}
+
+	// Exits
+	for (i = 0; i < 4; i++){
+		bench_Put(f, bench_Rand(2) ? 1 + bench_Rand(IOBENCH_LOCATIONS) : 0, 2);
+		bench_Put(f, 0, 2);
+		iobench_Requires(f, requires[i]);
+	}
+
+	// Primary and secondary monsters
+	for (i = 0; i < 2; i++){
+		bench_Put(f, bench_Rand(100), 1);
+		n = bench_Rand(MAX_MONSTER_TYPES + 1);
+		bench_Put(f, n, 1);
+		while (n--){
+			bench_Put(f, 1 + bench_Rand(10), 1);
+		}
+		iobench_Requires(f, requires[4 + i]);
+	}
+
+	// Rewards
+	bench_Put(f, bench_Rand(100), 1);
+	n = bench_Rand(5);
+	bench_Put(f, n, 1);
+	while (n--){
+		bench_Put(f, bench_Rand(2) ? ITEM_TYPE_WEAPON : ITEM_TYPE_ITEM, 1);
+		bench_Put(f, 1 + bench_Rand(10), 1);
+	}
+	iobench_Requires(f, requires[6]);
+
+	// Spawn text
+	for (i = 0; i < 4; i++){
+		bench_Put(f, 0, 2);
+	}
+
+	// NPCs
+	for (i = 0; i < 3; i++){
+		bench_Put(f, bench_Rand(3) ? 0 : 1 + bench_Rand(10), 1);
+		iobench_Requires(f, requires[7 + i]);
+		bench_Put(f, 0, 1);
+		bench_Put(f, 0, 2);
+	}
+
+	// Background image flag
+	bench_Put(f, bench_Rand(4) ? 0 : 1, 1);
+
+	return ftell(f) - start;
+}
+
+void iobench_WriteWorld(){
+	// Write the map and story datafiles, and their indexes
+
+	FILE *dat, *idx;
+	unsigned short id, size;
+	unsigned long offset;
+
+	bench_Seed(1);
+
+	// Map locations start at 1
+	dat = fopen(MAP_DAT, "wb");
+	idx = fopen(MAP_IDX, "wb");
+	for (id = 1; id <= IOBENCH_LOCATIONS; id++){
+		offset = ftell(dat);
+		size = iobench_WriteLocation(dat, id);
+		bench_Put(idx, size, DATA_HEADER_RECORD_SIZE);
+		bench_Put(idx, offset, DATA_HEADER_OFFSET_SIZE);
+	}
+	fclose(dat);
+	fclose(idx);
+
+	// Story text starts at 0, plain ASCII (there is no dictionary file)
+	dat = fopen(STORY_DAT, "wb");
+	idx = fopen(STORY_IDX, "wb");
+	for (id = 0; id <= IOBENCH_LOCATIONS; id++){
+		offset = ftell(dat);
+		size = IOBENCH_STORY_MIN + bench_Rand(IOBENCH_STORY_MAX - IOBENCH_STORY_MIN);
+		bench_Put(idx, size, DATA_HEADER_RECORD_SIZE);
+		bench_Put(idx, offset, DATA_HEADER_OFFSET_SIZE);
+		while (size--){
+			bench_Put(dat, (size % 7) ? 'a' + bench_Rand(26) : ' ', 1);
+		}
+	}
+	fclose(dat);
+	fclose(idx);
+	unlink(STORY_DIC);
+}
+
+void iobench_OldRead(int f, void *buf, unsigned short size){
+	// read() as made by the original loader, counted
+
+	iobench_old.reads++;
+	read(f, buf, size);
+}
+
+void iobench_OldRecord(int f, unsigned char *buf){
+	// Replay the reads that the original data_LoadMap() made for one record,
+	// a field at a time, copying them into buf as they arrive
+
+	unsigned char *p = buf;
+	unsigned char i, n;
+
+	#define OLD_FIELD(size) iobench_OldRead(f, p, (size)); p += (size)
+	#define OLD_REQUIRES() OLD_FIELD(1); OLD_FIELD(1); n = p[-1]; if (n){ OLD_FIELD(n * REQUIREMENT_BYTES); }
+
+	OLD_FIELD(2);						// ID
+	OLD_FIELD(2);						// Text
+	OLD_FIELD(MAX_LEVEL_NAME_SIZE);		// Name
+	for (i = 0; i < 4; i++){
+		OLD_FIELD(2);					// Exit
+		OLD_FIELD(2);					// Exit text
+		OLD_REQUIRES();
+	}
+	for (i = 0; i < 2; i++){
+		OLD_FIELD(1);					// Spawn chance
+		OLD_FIELD(1);					// Spawn number
+		n = p[-1];
+		if (n){
+			OLD_FIELD(n);
+		}
+		OLD_REQUIRES();
+	}
+	OLD_FIELD(1);						// Item chance
+	OLD_FIELD(1);						// Item number
+	n = p[-1];
+	for (i = 0; i < n; i++){
+		OLD_FIELD(1);					// Item type
+		OLD_FIELD(1);					// Item ID
+	}
+	OLD_REQUIRES();
+	for (i = 0; i < 4; i++){
+		OLD_FIELD(2);					// Spawn text
+	}
+	for (i = 0; i < 3; i++){
+		OLD_FIELD(1);					// NPC
+		OLD_REQUIRES();
+		OLD_FIELD(1);					// NPC unique dialogue
+		OLD_FIELD(2);					// NPC text
+	}
+}
+
+void iobench_OldLoad(char *idx_name, char *dat_name, unsigned short entry, unsigned char is_map){
+	// Replay the original loader: open the index, look up the record, close it,
+	// then open the datafile, read the record and close that too
+
+	int f;
+	unsigned short record_size = 0;
+	unsigned long record_offset = 0;
+	unsigned char buf[MAX_STORY_TEXT_SIZE];
+
+	f = open(idx_name, O_RDONLY);
+	iobench_old.opens++;
+	lseek(f, entry * DATA_HEADER_ENTRY_SIZE, SEEK_SET);
+	iobench_old.seeks++;
+	iobench_OldRead(f, &record_size, DATA_HEADER_RECORD_SIZE);
+	iobench_OldRead(f, &record_offset, DATA_HEADER_OFFSET_SIZE);
+	close(f);
+	iobench_old.closes++;
+
+	f = open(dat_name, O_RDONLY);
+	iobench_old.opens++;
+	lseek(f, record_offset, SEEK_SET);
+	iobench_old.seeks++;
+	if (is_map){
+		iobench_OldRecord(f, buf);
+	} else {
+		iobench_OldRead(f, buf, record_size);
+	}
+	close(f);
+	iobench_old.closes++;
+}
+
+void iobench_Line(char *name, unsigned long opens, unsigned long closes, unsigned long seeks, unsigned long reads){
+	// Print the calls made per location load
+
+	printf("  %-32s %6.1f %6.1f %6.1f %6.1f %7.1f\n", name,
+		(double) opens / IOBENCH_LOCATIONS,
+		(double) closes / IOBENCH_LOCATIONS,
+		(double) seeks / IOBENCH_LOCATIONS,
+		(double) reads / IOBENCH_LOCATIONS,
+		(double) (opens + closes + seeks + reads) / IOBENCH_LOCATIONS);
+}
+
+int main(void){
+
+	unsigned short i, j, id;
+	unsigned short order[IOBENCH_LOCATIONS];
+	DataStats_t *stats;
+	DataStats_t start, cold, warm;
+	unsigned short startup_opens;
+	unsigned long startup_reads;
+
+	iobench_WriteWorld();
+
+	// Locations are visited in a shuffled order, as the player wanders about
+	for (i = 0; i < IOBENCH_LOCATIONS; i++){
+		order[i] = i + 1;
+	}
+	for (i = IOBENCH_LOCATIONS - 1; i > 0; i--){
+		j = bench_Rand(i + 1);
+		id = order[i];
+		order[i] = order[j];
+		order[j] = id;
+	}
+
+	printf("Sinclair QL datafile system calls per location load\n");
+	printf("===================================================\n");
+	printf("%d test locations, map record and story text\n\n", IOBENCH_LOCATIONS);
+	printf("  %-32s %6s %6s %6s %6s %7s\n", "", "open", "close", "lseek", "read", "total");
+
+	// Original loader
+	memset(&iobench_old, 0, sizeof(IOCount_t));
+	for (i = 0; i < IOBENCH_LOCATIONS; i++){
+		id = order[i];
+		iobench_OldLoad(MAP_IDX, MAP_DAT, id - 1, 1);
+		iobench_OldLoad(STORY_IDX, STORY_DAT, id, 0);
+	}
+	iobench_Line("Field by field (original)", iobench_old.opens, iobench_old.closes, iobench_old.seeks, iobench_old.reads);
+
+	// Current loader, with handles and indexes opened and loaded once at startup
+	arena_Init(0);
+	stats = data_Stats();
+	data_OpenFiles();
+	data_LoadIndexes(&iobench_screen);
+	data_CacheInit();
+	startup_opens = stats->opens;
+	startup_reads = stats->reads;
+
+	// Each location loaded for the first time, then again straight after, as
+	// when walking back to it; the second load comes from the map cache
+	memset(&cold, 0, sizeof(DataStats_t));
+	memset(&warm, 0, sizeof(DataStats_t));
+	for (i = 0; i < IOBENCH_LOCATIONS; i++){
+		id = order[i];
+		memcpy(&start, stats, sizeof(DataStats_t));
+		data_LoadMap(&iobench_screen, &iobench_gamestate, &iobench_levelstate, id);
+		data_LoadStory(&iobench_screen, &iobench_gamestate, &iobench_levelstate, iobench_levelstate.text);
+		cold.opens += stats->opens - start.opens;
+		cold.seeks += stats->seeks - start.seeks;
+		cold.reads += stats->reads - start.reads;
+
+		memcpy(&start, stats, sizeof(DataStats_t));
+		data_LoadMap(&iobench_screen, &iobench_gamestate, &iobench_levelstate, id);
+		data_LoadStory(&iobench_screen, &iobench_gamestate, &iobench_levelstate, iobench_levelstate.text);
+		warm.opens += stats->opens - start.opens;
+		warm.seeks += stats->seeks - start.seeks;
+		warm.reads += stats->reads - start.reads;
+	}
+	iobench_Line("Whole record (first visit)", cold.opens, 0, cold.seeks, cold.reads);
+	iobench_Line("Whole record (map cache hit)", warm.opens, 0, warm.seeks, warm.reads);
+	printf("\nThe whole record loader also makes %d opens and %ld reads once, at startup,\n", startup_opens, startup_reads);
+	printf("to open every datafile and load the map and story indexes.\n");
+
+	data_CloseFiles();
+	data_FreeIndexes();
+	data_StoryCacheFree();
+	data_MapCacheFree();
+	arena_Exit();
+
+	if (bench_errors){
+		printf("Error: %d datafile errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,212 @@
+/* lzbench_ql.c, Host benchmark of the time taken to load a background image,
+ stored uncompressed and LZ compressed, under a simulated floppy disk.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make lzbench'.
+// etc/bg_ql.py first writes a set of test backgrounds into bin/bench/bg,
+// each as an uncompressed 'QS' file and an LZ compressed 'QZ' file, and
+// both are then drawn through the real draw_Image() in draw_ql.c. The two
+// must give the same pixels.
+//
+// On the development machine the files come straight from the page cache, so
+// the time a QL would take is estimated from the disk model in
+// host/bench_ql.h: whole sectors at QL_DISK_BYTES per second, plus a trap for
+// every read() that draw_Image() makes. Unpacking is costed from the number
+// of tokens, literal bytes and copied bytes in each file.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DRAW_H
+#include "../common/draw.h"
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#endif
+#include "host/bench_ql.h"
+
+#define LZBENCH_IMAGES		4		// Test images written by etc/bg_ql.py
+#define LZBENCH_SECONDS		0.25	// Time each image is drawn for, for the host timings
+
+#define QL_TOKEN_CYCLES		120		// draw_ImageUnpack() cycles per token
+#define QL_LITERAL_CYCLES	30		// draw_ImageUnpack() cycles per literal byte
+#define QL_COPY_CYCLES		60		// draw_ImageUnpack() cycles per copied byte
+
+// What it takes to load one image file
+typedef struct {
+	unsigned long bytes;			// Size of the file
+	unsigned long reads;			// read() calls made by draw_Image()
+	unsigned long tokens;			// LZ tokens
+	unsigned long literals;			// Bytes copied from the file
+	unsigned long copied;			// Bytes copied from earlier in the image
+	double host_us;					// Host time to draw, in microseconds
+} ImageCount_t;
+
+char *lzbench_names[LZBENCH_IMAGES] = {
+	"Forest",
+	"Town",
+	"Dithered photo",
+	"Random noise",
+};
+
+Screen_t lzbench_screen;
+unsigned char lzbench_pixels[SCREEN_BYTES];
+
+int lzbench_Count(char *filename, ImageCount_t *count){
+	// Read an image file and count what draw_Image() will do with it
+
+	FILE *f;
+	ScrHeader_t header;
+	unsigned char data[SCREEN_BYTES];
+	unsigned long i;
+	unsigned short n;
+
+	memset(count, 0, sizeof(ImageCount_t));
+	f = fopen(filename, "rb");
+	if (f == NULL){
+		printf("Error: unable to open %s, run etc/bg_ql.py first\n", filename);
+		return -1;
+	}
+	fread(&header, SCR_HEADER_SIZE, 1, f);
+	count->bytes = SCR_HEADER_SIZE + fread(data, 1, sizeof(data), f);
+	fclose(f);
+
+	// The header is read on its own
+	count->reads = 1;
+	if (header.signature == SCR_SIGNATURE_LZ){
+		// Compressed data is read a buffer at a time
+		count->reads += (count->bytes - SCR_HEADER_SIZE + LZ_BUFFER_SIZE - 1) / LZ_BUFFER_SIZE;
+		i = 0;
+		while (i < (count->bytes - SCR_HEADER_SIZE)){
+			count->tokens++;
+			if (data[i] < 0x80){
+				n = data[i] + 1;
+				count->literals += n;
+				i += 1 + n;
+			} else {
+				count->copied += data[i] - 0x80 + LZ_MIN_MATCH;
+				i += 3;
+			}
+		}
+	} else if (header.width == SCREEN_WIDTH){
+		// Full width images are read in one go
+		count->reads++;
+	} else {
+		// Anything narrower is read a row at a time
+		count->reads += header.height;
+	}
+	return 0;
+}
+
+double lzbench_Draw(char *filename){
+	// Draw an image over and over, returning the time per draw in microseconds
+
+	unsigned long calls = 0;
+	double start, elapsed;
+
+	start = bench_Now();
+	do {
+		if (draw_Image(&lzbench_screen, DRAW_BG_X, DRAW_BG_Y, filename) != BMP_OK){
+			printf("Error: unable to draw %s\n", filename);
+			return -1;
+		}
+		calls++;
+		elapsed = bench_Now() - start;
+	} while (elapsed < LZBENCH_SECONDS);
+	return (elapsed * 1000000.0) / calls;
+}
+
+double lzbench_QL(ImageCount_t *count){
+	// Estimated QL time to load and draw an image, in milliseconds
+
+	unsigned long sectors;
+	double disk, cpu;
+
+	sectors = (count->bytes + QL_SECTOR_BYTES - 1) / QL_SECTOR_BYTES;
+	disk = (double) (sectors * QL_SECTOR_BYTES) / QL_DISK_BYTES;
+	disk += (double) count->reads * QL_TRAP_US / 1000000.0;
+	cpu = (double) ((count->tokens * QL_TOKEN_CYCLES) + (count->literals * QL_LITERAL_CYCLES) + (count->copied * QL_COPY_CYCLES)) / QL_CPU_HZ;
+	return (disk + cpu) * 1000.0;
+}
+
+int main(void){
+
+	unsigned char i;
+	char qs_name[32], qz_name[32];
+	ImageCount_t qs, qz;
+	double qs_ms, qz_ms;
+	double qs_total = 0, qz_total = 0;
+
+	if (bench_Screen(&lzbench_screen) != SCREEN_INIT_OK){
+		return 1;
+	}
+
+	printf("Sinclair QL background image load time, uncompressed and LZ compressed\n");
+	printf("======================================================================\n");
+	printf("%dx%d images at %d,%d\n\n", DRAW_BG_WIDTH, DRAW_BG_HEIGHT, DRAW_BG_X, DRAW_BG_Y);
+	printf("  %-16s %13s %11s %11s %15s %15s %6s\n", "", "bytes", "sectors", "reads", "host us", "QL ms", "saved");
+	printf("  %-16s %6s %6s %5s %5s %5s %5s %7s %7s %7s %7s\n", "", "QS", "QZ", "QS", "QZ", "QS", "QZ", "QS", "QZ", "QS", "QZ");
+
+	for (i = 0; i < LZBENCH_IMAGES; i++){
+		sprintf(qs_name, "bin/bench/bg/qs%d_scr", i);
+		sprintf(qz_name, "bin/bench/bg/qz%d_scr", i);
+		if ((lzbench_Count(qs_name, &qs) != 0) || (lzbench_Count(qz_name, &qz) != 0)){
+			return 1;
+		}
+
+		// Both files must give exactly the same picture
+		memset(lzbench_screen.buf, 0, SCREEN_BYTES);
+		draw_Image(&lzbench_screen, DRAW_BG_X, DRAW_BG_Y, qs_name);
+		memcpy(lzbench_pixels, lzbench_screen.buf, SCREEN_BYTES);
+		memset(lzbench_screen.buf, 0, SCREEN_BYTES);
+		draw_Image(&lzbench_screen, DRAW_BG_X, DRAW_BG_Y, qz_name);
+		if (memcmp(lzbench_pixels, lzbench_screen.buf, SCREEN_BYTES) != 0){
+			printf("Error: %s and %s do not draw the same image\n", qs_name, qz_name);
+			return 1;
+		}
+
+		qs.host_us = lzbench_Draw(qs_name);
+		qz.host_us = lzbench_Draw(qz_name);
+		qs_ms = lzbench_QL(&qs);
+		qz_ms = lzbench_QL(&qz);
+		qs_total += qs_ms;
+		qz_total += qz_ms;
+		printf("  %-16s %6ld %6ld %5ld %5ld %5ld %5ld %7.1f %7.1f %7.0f %7.0f %5.0f%%\n", lzbench_names[i],
+			qs.bytes, qz.bytes,
+			(qs.bytes + QL_SECTOR_BYTES - 1) / QL_SECTOR_BYTES, (qz.bytes + QL_SECTOR_BYTES - 1) / QL_SECTOR_BYTES,
+			qs.reads, qz.reads,
+			qs.host_us, qz.host_us,
+			qs_ms, qz_ms, 100.0 * (qs_ms - qz_ms) / qs_ms);
+	}
+
+	printf("\nEstimated QL time for all %d images: %.0fms uncompressed, %.0fms compressed.\n", LZBENCH_IMAGES, qs_total, qz_total);
+	printf("Disk modelled at %d bytes/s, %d byte sectors and %dus per read, 68008 at %dHz.\n", QL_DISK_BYTES, QL_SECTOR_BYTES, QL_TRAP_US, QL_CPU_HZ);
+
+	bench_ScreenExit(&lzbench_screen);
+	if (bench_errors){
+		printf("Error: %d errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
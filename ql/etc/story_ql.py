@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+
+""" story_ql.py, Writes the story text of an adventure twice, as plain text
+ and byte-pair compressed, for the story loading benchmark of the QL target
+ of the OlderScrolls RPG game engine.
+
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Usage: story_ql.py ../datafiles leafy_glade bin/bench
+
+ The text is wrapped and compressed by the same functions as datafiles.py
+ uses, but the index is written in host byte order, so that the benchmark
+ can read it with the real data_ql.c on the development machine.
+"""
+
+import os
+import sys
+
+def write_story(out_dir, texts, dictionary):
+	""" Write story_dat, story_idx and, if there is a dictionary, story_dic """
+
+	if not os.path.exists(out_dir):
+		os.makedirs(out_dir)
+	dat = open(out_dir + "/story_dat", "wb")
+	idx = open(out_dir + "/story_idx", "wb")
+	offset = 0
+	for text in texts:
+		dat.write(bytes(text))
+		idx.write(len(text).to_bytes(2, byteorder=sys.byteorder))
+		idx.write(offset.to_bytes(4, byteorder=sys.byteorder))
+		offset += len(text)
+	dat.close()
+	idx.close()
+
+	if os.path.exists(out_dir + "/story_dic"):
+		os.remove(out_dir + "/story_dic")
+	if len(dictionary) > 0:
+		f = open(out_dir + "/story_dic", "wb")
+		f.write(bytes([len(dictionary)]))
+		for pair in dictionary:
+			f.write(bytes(pair))
+		f.close()
+
+if __name__ == "__main__":
+
+	if len(sys.argv) != 4:
+		print("Usage: %s <datafiles directory> <adventure> <output directory>" % sys.argv[0])
+		sys.exit(1)
+
+	datafiles_dir = sys.argv[1]
+	adventure = sys.argv[2]
+	out_dir = sys.argv[3]
+
+	sys.path.insert(0, datafiles_dir)
+	import datafiles
+
+	target = datafiles.AVAILABLE_TARGETS['1']
+	game_story = __import__(adventure + ".story", globals(), locals(), ["STORY"])
+	text_ids = list(game_story.STORY.keys())
+	text_ids.sort()
+
+	# Pre-wrap the splash screen and location text, as generate_story() does
+	wrap_ids = [1]
+	try:
+		game_world = __import__(adventure + ".world", globals(), locals(), ["MAP"])
+		for location_id in game_world.MAP.keys():
+			wrap_ids.append(game_world.MAP[location_id]['text'])
+	except Exception as e:
+		pass
+
+	texts = []
+	for i in text_ids:
+		text = game_story.STORY[i]
+		if i in wrap_ids:
+			wrapped = datafiles.story_wrap(text, target['text_cols'], target['text_rows'])
+			if len(wrapped) < datafiles.MAX_STORY_TEXT_SIZE:
+				text = wrapped
+		texts.append(list(text.encode('ascii')))
+
+	write_story(out_dir + "/plain", texts, [])
+	dictionary, packed = datafiles.story_compress(texts)
+	write_story(out_dir + "/packed", packed, dictionary)
+
+	print("%d story texts from %s written to %s/plain and %s/packed" % (len(texts), adventure, out_dir, out_dir))
@@ -0,0 +1,202 @@
+/* storybench_ql.c, Host benchmark of the time taken to load story text,
+ stored plain and byte-pair compressed.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make storybench'.
+// etc/story_ql.py first writes the story text of a bundled adventure into
+// bin/bench/plain and bin/bench/packed, and every text is then loaded from
+// each, as game_Map() does, through the real data_ql.c.
+//
+// On the development machine the files come straight from the page cache, so
+// the time spent in the disk is estimated from the bytes and reads that the
+// loader asked for, and the time spent expanding the text on the 68008 from
+// the characters and dictionary codes it expanded. Both are rough figures,
+// the QL_ constants here and in host/bench_ql.h can be changed to model other drives.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DATA_H
+#include "../common/data.h"
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
+#include "host/bench_ql.h"
+
+#define STORYBENCH_REPEAT	2000	// Times every text is loaded for the host timings
+
+#define QL_CHAR_CYCLES		80		// data_DecodeStory() cycles per character written
+#define QL_CODE_CYCLES		140		// data_DecodeStory() cycles per dictionary code expanded
+
+// Totals for one way of storing the text
+typedef struct {
+	unsigned short texts;
+	unsigned long bytes;			// Record bytes read from story_dat
+	unsigned long reads;			// read() calls made by data_LoadStory()
+	unsigned long startup_reads;	// read() calls to load the index and dictionary
+	unsigned long chars;			// Characters of text after expansion
+	unsigned long codes;			// Dictionary codes expanded
+	unsigned short dict_bytes;		// Size of story_dic, read once at startup
+	double host_us;					// Host time per text, in microseconds
+} StoryCount_t;
+
+extern DataIndex_t data_story_index;
+
+GameState_t storybench_gamestate;
+LevelState_t storybench_levelstate;
+Screen_t storybench_screen;
+
+int storybench_Load(char *dir, StoryCount_t *count){
+	// Load every story text from one directory, counting the bytes
+	// read and characters expanded, then time repeated loads of them all
+
+	DataStats_t *stats;
+	unsigned short id, size;
+	unsigned long offset;
+	unsigned short i;
+	double start;
+	FILE *f;
+
+	memset(count, 0, sizeof(StoryCount_t));
+	if (chdir(dir) != 0){
+		printf("Error: unable to change to %s\n", dir);
+		return -1;
+	}
+
+	f = fopen(STORY_DIC, "rb");
+	if (f != NULL){
+		fseek(f, 0, SEEK_END);
+		count->dict_bytes = ftell(f);
+		fclose(f);
+	}
+
+	arena_Init(0);
+	stats = data_Stats();
+	memset(stats, 0, sizeof(DataStats_t));
+	data_OpenFiles();
+	data_LoadIndex(DATA_FILE_STORY_IDX, &data_story_index);
+	data_LoadStoryDict(&storybench_screen);
+	// The dictionary is read directly, a count and then the pairs
+	count->startup_reads = stats->reads + (count->dict_bytes ? 2 : 0);
+	stats->reads = 0;
+
+	// One pass to count what the loader does for each text
+	for (id = 0; id < data_story_index.entries; id++){
+		size = 0;
+		offset = 0;
+		data_IndexLookup(DATA_FILE_STORY_IDX, id, &size, &offset);
+		data_LoadStory(&storybench_screen, &storybench_gamestate, &storybench_levelstate, id);
+		count->bytes += size;
+		count->chars += strlen(storybench_gamestate.buf);
+		// Every code expanded turns one byte into two
+		count->codes += strlen(storybench_gamestate.buf) - size;
+		count->texts++;
+	}
+	count->reads = stats->reads;
+
+	// Then time them all, with the files now in the host page cache
+	start = bench_Now();
+	for (i = 0; i < STORYBENCH_REPEAT; i++){
+		for (id = 0; id < data_story_index.entries; id++){
+			data_LoadStory(&storybench_screen, &storybench_gamestate, &storybench_levelstate, id);
+		}
+	}
+	count->host_us = ((bench_Now() - start) * 1000000.0) / ((double) STORYBENCH_REPEAT * count->texts);
+
+	data_CloseFiles();
+	data_FreeIndexes();
+	arena_Exit();
+	chdir("..");
+	return 0;
+}
+
+double storybench_QL(StoryCount_t *count, unsigned char startup){
+	// Estimated QL time to load every text once, in milliseconds,
+	// or to load the index and dictionary at startup
+
+	double disk, cpu;
+
+	if (startup){
+		disk = (double) ((count->texts * DATA_HEADER_ENTRY_SIZE) + count->dict_bytes) / QL_DISK_BYTES;
+		disk += (double) count->startup_reads * QL_TRAP_US / 1000000.0;
+		return disk * 1000.0;
+	}
+	disk = (double) count->bytes / QL_DISK_BYTES;
+	disk += (double) count->reads * QL_TRAP_US / 1000000.0;
+	cpu = (double) ((count->chars * QL_CHAR_CYCLES) + (count->codes * QL_CODE_CYCLES)) / QL_CPU_HZ;
+	return (disk + cpu) * 1000.0;
+}
+
+void storybench_Line(char *name, StoryCount_t *count){
+	// Print the totals for one way of storing the text
+
+	printf("  %-22s %7ld %7ld %7ld %7.1f %9.1f %9.1f\n", name,
+		count->bytes,
+		count->chars,
+		count->codes,
+		count->host_us,
+		storybench_QL(count, 1),
+		storybench_QL(count, 0));
+}
+
+int main(void){
+
+	StoryCount_t plain, packed;
+	double plain_ms, packed_ms;
+
+	if (chdir("bin/bench") != 0){
+		printf("Error: run etc/story_ql.py first, to write bin/bench/plain and bin/bench/packed\n");
+		return 1;
+	}
+	if ((storybench_Load("plain", &plain) != 0) || (storybench_Load("packed", &packed) != 0)){
+		return 1;
+	}
+	if ((plain.texts == 0) || (plain.chars != packed.chars)){
+		printf("Error: plain and compressed text do not match (%ld and %ld characters)\n", plain.chars, packed.chars);
+		return 1;
+	}
+
+	printf("Sinclair QL story text load time, plain and compressed\n");
+	printf("======================================================\n");
+	printf("%d story texts, each loaded once\n\n", plain.texts);
+	printf("  %-22s %7s %7s %7s %7s %9s %9s\n", "", "bytes", "chars", "codes", "host", "QL start", "QL load");
+	printf("  %-22s %7s %7s %7s %7s %9s %9s\n", "", "", "", "", "us/text", "ms", "ms");
+	storybench_Line("Plain text", &plain);
+	storybench_Line("Byte-pair compressed", &packed);
+
+	plain_ms = storybench_QL(&plain, 0);
+	packed_ms = storybench_QL(&packed, 0);
+	printf("\nEstimated QL time per text: %.1fms plain, %.1fms compressed, %.0f%% saved.\n",
+		plain_ms / plain.texts, packed_ms / packed.texts, 100.0 * (plain_ms - packed_ms) / plain_ms);
+	printf("Disk modelled at %d bytes/s and %dus per read, 68008 at %dHz.\n", QL_DISK_BYTES, QL_TRAP_US, QL_CPU_HZ);
+
+	if (bench_errors){
+		printf("Error: %d datafile errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
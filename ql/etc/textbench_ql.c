@@ -0,0 +1,204 @@
+/* textbench_ql.c, Host benchmark of the glyphs per second drawn by draw_String(),
+ with the font masked on every character, and with pre-expanded glyphs.
+ Copyright (C) 2021  John Snowdon
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is built and run on the development machine by 'make textbench'. A
+// main window's worth of story text is drawn again and again through the real
+// draw_ql.c, first without the glyph table built by draw_ExpandFont(), which
+// is how every character used to be drawn, and then with it.
+//
+// The host is far faster than a 68008, so only the ratio between the two
+// columns says anything about the QL.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _GAME_H
+#include "../common/game.h"
+#endif
+#ifndef _DRAW_H
+#include "../common/draw.h"
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#endif
+#include "host/bench_ql.h"
+
+#define TEXTBENCH_SECONDS	0.5		// Time each test is run for
+#define TEXTBENCH_COLS		48		// As UI_MAIN_WINDOW_MAX_CHARS
+#define TEXTBENCH_ROWS		24		// As UI_MAIN_WINDOW_MAX_ROWS
+
+Screen_t textbench_screen;
+char textbench_plain[MAX_STORY_TEXT_SIZE];
+char textbench_tagged[MAX_STORY_TEXT_SIZE];
+char textbench_wrapped[MAX_STORY_TEXT_SIZE];
+
+void textbench_Words(char *c, unsigned char tags){
+	// Fill a buffer with about 700 characters of words and short paragraphs,
+	// optionally with a colour tag around every eighth word
+
+	unsigned short len = 0;
+	unsigned short words = 0;
+	unsigned char i, n;
+
+	bench_Seed(1);
+	while (len < 700){
+		if (tags && ((words % 8) == 0)){
+			c[len++] = TEXT_TAG_START;
+			c[len++] = 'g';
+			c[len++] = TEXT_TAG_END;
+		}
+		n = 2 + bench_Rand(7);
+		for (i = 0; i < n; i++){
+			c[len++] = 'a' + bench_Rand(26);
+		}
+		if (tags && ((words % 8) == 0)){
+			c[len++] = TEXT_TAG_START;
+			c[len++] = 'C';
+			c[len++] = TEXT_TAG_END;
+		}
+		words++;
+		c[len++] = ((words % 40) == 0) ? '\n' : ' ';
+	}
+	c[len] = '\0';
+}
+
+void textbench_Wrap(char *dest, char *src){
+	// Pre-wrap a text to the main window, as etc/story_ql.py
+	// and datafiles.py do, using the engine's own line breaks
+
+	unsigned short pos = 0;
+	unsigned short next, end, i;
+	unsigned short len = strlen(src);
+	unsigned short out = 0;
+	unsigned char rows = 0;
+	unsigned char prewrapped = 0;
+
+	dest[out++] = TEXT_PREWRAP_START;
+	dest[out++] = TEXTBENCH_COLS;
+	while (pos < len){
+		next = draw_TextLine(src, pos, len, TEXTBENCH_COLS, &end, NULL, PIXEL_WHITE, &prewrapped);
+		if (rows > 0){
+			dest[out++] = ((rows % TEXTBENCH_ROWS) == 0) ? TEXT_PAGE_BREAK : '\n';
+		}
+		for (i = pos; i < end; i++){
+			if ((i > pos) || (src[i] != ' ')){
+				dest[out++] = src[i];
+			}
+		}
+		rows++;
+		pos = next;
+	}
+	dest[out++] = TEXT_PREWRAP_END;
+	dest[out] = '\0';
+}
+
+unsigned long textbench_Glyphs(char *c){
+	// Number of characters that draw_String() draws for a text,
+	// leaving out colour tags, line breaks, markers and leading spaces
+
+	unsigned short pos = 0;
+	unsigned short next, end, i;
+	unsigned short len = strlen(c);
+	unsigned long glyphs = 0;
+	unsigned long line_start;
+	unsigned char prewrapped = 0;
+	unsigned char rows = 0;
+
+	while ((pos < len) && (rows < TEXTBENCH_ROWS)){
+		next = draw_TextLine(c, pos, len, TEXTBENCH_COLS, &end, NULL, PIXEL_WHITE, &prewrapped);
+		line_start = glyphs;
+		for (i = pos; i < end; i++){
+			if ((c[i] == TEXT_TAG_START) && ((i + 2) < end) && (c[i + 2] == TEXT_TAG_END)){
+				i += 2;
+			} else if (c[i] == TEXT_PREWRAP_START){
+				i++;
+			} else if ((c[i] == TEXT_PREWRAP_END) || ((c[i] == ' ') && (glyphs == line_start))){
+				// Not drawn
+			} else {
+				glyphs++;
+			}
+		}
+		rows++;
+		pos = next;
+	}
+	return glyphs;
+}
+
+double textbench_Run(char *c){
+	// Draw a text into the main window for a while, returning glyphs per second
+
+	unsigned long calls = 0;
+	double start, elapsed;
+
+	start = bench_Now();
+	do {
+		draw_String(&textbench_screen, 1, 20, TEXTBENCH_COLS, TEXTBENCH_ROWS, 0, textbench_screen.font_8x8, PIXEL_WHITE, c, MODE_PIXEL_SET);
+		calls++;
+		elapsed = bench_Now() - start;
+	} while (elapsed < TEXTBENCH_SECONDS);
+	return (calls * textbench_Glyphs(c)) / elapsed;
+}
+
+void textbench_Line(char *name, char *c, unsigned short *glyph){
+	// Time a text with and without the pre-expanded glyphs
+
+	double before, after;
+
+	textbench_screen.font_8x8->glyph = NULL;
+	before = textbench_Run(c);
+	textbench_screen.font_8x8->glyph = glyph;
+	after = textbench_Run(c);
+	printf("  %-24s %6ld %12.0f %12.0f %7.1fx\n", name, textbench_Glyphs(c), before, after, after / before);
+}
+
+int main(void){
+
+	unsigned short *glyph;
+
+	if (bench_Screen(&textbench_screen) != SCREEN_INIT_OK){
+		return 1;
+	}
+	glyph = textbench_screen.font_8x8->glyph;
+	if (glyph == NULL){
+		printf("Error: no room for the pre-expanded glyphs\n");
+		return 1;
+	}
+
+	textbench_Words(textbench_plain, 0);
+	textbench_Words(textbench_tagged, 1);
+	textbench_Wrap(textbench_wrapped, textbench_plain);
+
+	printf("Sinclair QL draw_String() glyphs per second, on the host\n");
+	printf("========================================================\n");
+	printf("Main window text, %d x %d characters, MODE_PIXEL_SET\n\n", TEXTBENCH_COLS, TEXTBENCH_ROWS);
+	printf("  %-24s %6s %12s %12s %8s\n", "", "glyphs", "masked", "expanded", "speedup");
+	textbench_Line("Story text", textbench_plain, glyph);
+	textbench_Line("Story text, colour tags", textbench_tagged, glyph);
+	textbench_Line("Pre-wrapped story text", textbench_wrapped, glyph);
+
+	bench_ScreenExit(&textbench_screen);
+	if (bench_errors){
+		printf("Error: %d errors during the benchmark\n", bench_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+/* arena_ql.c, Startup memory arena for the Sinclair QL.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _CONFIG_H
+#include "../common/config.h"
+#define _CONFIG_H
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#define _ERROR_H
+#endif
+
+Arena_t arena;
+
+int arena_Init(unsigned long size){
+	// Reserve the single block of memory that all fixed
+	// allocations, and the scratch region, are carved from
+	
+	memset(&arena, 0, sizeof(Arena_t));
+	size = ARENA_ALIGN(size + ARENA_SCRATCH_SIZE);
+	arena.base = (unsigned char *) malloc(size);
+	if (arena.base == NULL){
+		return ARENA_INIT_MEMORY;
+	}
+	arena.size = size;
+	return ARENA_INIT_OK;
+}
+
+void arena_Exit(){
+	// Give the arena back to the heap; every pointer carved from it is now invalid
+	
+	free(arena.base);
+	memset(&arena, 0, sizeof(Arena_t));
+}
+
+void * arena_Alloc(unsigned long size){
+	// Carve a zeroed block from the bottom of the arena, for the
+	// rest of the session. Returns NULL if there is no room left.
+	
+	void *p;
+	
+	size = ARENA_ALIGN(size);
+	if (size > arena_Free()){
+		arena.failed++;
+		return NULL;
+	}
+	p = arena.base + arena.used;
+	memset(p, 0, size);
+	arena.used += size;
+	if ((arena.used + arena.scratch) > arena.high){
+		arena.high = arena.used + arena.scratch;
+	}
+	return p;
+}
+
+void * arena_Scratch(unsigned long size){
+	// Carve a block from the top of the arena, which is only valid
+	// until the next arena_ScratchReset(). Not zeroed.
+	
+	size = ARENA_ALIGN(size);
+	if ((arena.scratch + size) > ARENA_SCRATCH_SIZE){
+		arena.failed++;
+		return NULL;
+	}
+	arena.scratch += size;
+	if ((arena.used + arena.scratch) > arena.high){
+		arena.high = arena.used + arena.scratch;
+	}
+	return arena.base + arena.size - arena.scratch;
+}
+
+void arena_ScratchReset(){
+	// Empty the scratch region
+	
+	arena.scratch = 0;
+}
+
+unsigned long arena_Free(){
+	// Returns the number of bytes still available for fixed allocations
+	
+	return arena.size - ARENA_SCRATCH_SIZE - arena.used;
+}
+
+Arena_t * arena_Stats(){
+	// Returns the arena usage counters, for the debug screen
+	
+	return &arena;
+}
@@ -0,0 +1,57 @@
+/* arena_ql.h, Prototypes for the Sinclair QL startup memory arena.
+ Copyright (C) 2021  John Snowdon
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ARENA_QL_H
+
+// Everything that lives for the whole session (game state, screen state,
+// sprites, the expanded font...) is carved from one block of memory which
+// is reserved at startup, so it cannot fragment the heap.
+//
+// Fixed allocations are taken from the bottom of the block, zeroed, and are
+// never given back. The top ARENA_SCRATCH_SIZE bytes are kept apart as a
+// scratch region, for buffers which are only needed while one record is
+// being loaded; it is emptied by arena_ScratchReset() and nothing may be
+// kept in it past that.
+
+// Allocations are rounded up to keep every structure word aligned on the 68008
+#define ARENA_ALIGN(x)		(((x) + 1) & ~1UL)
+
+// Everything main() carves from the arena for the whole session; the basic
+// data structures, plus whatever screen_Init() and game_Init() go on to take.
+// Only expanded where the game, level, screen and data types are all known.
+// The map and story caches are not counted; they get whatever is left over.
+#define ARENA_FIXED_BYTES	(ARENA_ALIGN(sizeof(GameState_t)) + ARENA_ALIGN(sizeof(LevelState_t)) + ARENA_ALIGN(sizeof(Screen_t)) + DRAW_ARENA_BYTES + GAME_ARENA_BYTES)
+
+typedef struct {
+	unsigned char *base;		// Start of the block reserved at startup
+	unsigned long size;			// Total size of the block, including the scratch region
+	unsigned long used;			// Bytes handed out to fixed allocations
+	unsigned long scratch;		// Bytes handed out from the scratch region since the last reset
+	unsigned long high;			// Most bytes that have ever been in use at once (fixed + scratch)
+	unsigned short failed;		// Number of allocations that did not fit
+} Arena_t;
+
+int arena_Init(unsigned long size);
+void arena_Exit();
+void * arena_Alloc(unsigned long size);
+void * arena_Scratch(unsigned long size);
+void arena_ScratchReset();
+unsigned long arena_Free();
+Arena_t * arena_Stats();
+
+#define _ARENA_QL_H
+#endif
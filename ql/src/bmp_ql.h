@@ -45,6 +45,14 @@
 #define BMP_WIDTH_MAX			512	// On the QL we support images up to the width of the screen
 #define BMP_MAX_SYMBOLS			96
 
+// Colours that each font symbol is pre-expanded into, as ready-to-store screen words
+#define BMP_FONT_WHITE			0
+#define BMP_FONT_GREEN			1
+#define BMP_FONT_RED			2
+#define BMP_FONT_YELLOW			3
+#define BMP_FONT_COLOURS		4
+#define BMP_FONT_GLYPH_BYTES	(BMP_FONT_COLOURS * BMP_MAX_SYMBOLS * BMP_FONT_MAX_HEIGHT * sizeof(unsigned short))
+
 // ============================
 //
 // BMP image data structure
@@ -92,6 +100,9 @@ typedef struct bmpstate {
 // Each character is 8px, or 1 byte wide, and up to 8px high. Therefore 8 bytes per font. 
 // Total of 768 bytes per 96 character font
 //
+// Optionally, each symbol is also held as the screen words needed to draw it
+// in each of BMP_FONT_COLOURS colours, for another 6144 bytes per font.
+//
 //=============================
 typedef struct fontdata {
 unsigned char	width;			// Width of each character, in pixels
@@ -100,6 +111,7 @@ unsigned char	ascii_start;	// ASCII number of symbol 0
 unsigned char	n_symbols;		// Total number of symbols
 unsigned char	unknown_symbol;	// Which symbol do we map to unknown/missing symbols?
 unsigned char 	symbol[BMP_MAX_SYMBOLS][BMP_FONT_MAX_HEIGHT]; 
+unsigned short	*glyph;			// Pre-expanded symbols, [BMP_FONT_COLOURS][BMP_MAX_SYMBOLS][BMP_FONT_MAX_HEIGHT], or NULL
 } fontdata_t;
 
 #endif
@@ -118,4 +130,7 @@ void bmp_Print(bmpdata_t *bmpdata);
 void bmp_PrintFont(fontdata_t *fontdata);
 void bmp_PrintState(bmpstate_t *bmpstate);
 
+// Generated from assets/font8x8.bmp, see font_ql.c
+extern fontdata_t font_8x8_data;
+
 #endif
\ No newline at end of file
@@ -37,14 +37,62 @@
 #define MAP_IDX			"world_idx"		// Map location is variable size, so read from index
 #define STORY_DAT		"story_dat"
 #define STORY_IDX		"story_idx"		// Story entry is variable size, so read from index
+#define STORY_DIC		"story_dic"		// Story text dictionary, optional - plain text if missing
 // Graphic assets
 #define SPRITE_DAT		"sprite_dat"	// Fixed size entries, see below
 #define PORTRAIT_DAT 	"portrait_dat"	// Fixed size entries, see below
 #define BOSS_DAT		"boss_dat"		// Fixed size entries, see below
+#define BACKGROUND_SCR	"bg%03d_scr"	// Location background images, by location ID, optional
 
 #define SPRITE_DAT_SIZE		256		// Size of graphics elements are specific to QL bitmap modes only
 #define PORTRAIT_DAT_SIZE	256		// Size of graphics elements are specific to QL bitmap modes only
 #define BOSS_DAT_SIZE		2304	// Size of graphics elements are specific to QL bitmap modes only
 #define MONSTER_ENTRY_SIZE	87		// Size of a single monster/npc datafile entry
 
+// The story and map index files are normally held in RAM for the whole session,
+// (approx. 4.5KB). Define this to read each index entry from disk instead, which
+// may be needed on an unexpanded 128KB machine.
+//#define DATA_INDEX_ON_DISK
+
+// Number of recently visited locations which are kept in memory, already decoded,
+// so that walking back to one of them does not need the disk. Each entry is the
+// size of a LevelState_t (approx. 220 bytes). Set to 0 to disable the cache.
+#define MAP_CACHE_SIZE		8
+// The map and story caches are given whatever memory is left once the startup
+// arena and the indexes are in place, an entry at a time, as long as at least
+// this much would still be free afterwards; on a machine without that memory
+// they get fewer entries, or none. They also give entries back, one at a time,
+// if an allocation elsewhere fails.
+#define MAP_CACHE_MIN_FREE	4096
+
+// Number of story text fragments which can be held in memory. While waiting for a
+// key press, the game loads the neighbouring locations (into the map cache) and their
+// default story text (into the story cache) so that moving is not held up by the disk.
+// Set to 0 to disable prefetching of story text.
+#define STORY_CACHE_SIZE	4
+// Largest story record, as stored on disk, which the story cache can hold. Every
+// entry is this size; longer texts are simply not prefetched. Compressed
+// location text is rarely more than 350 bytes.
+#define STORY_CACHE_TEXT_BYTES	384
+
+// Number of distinct item and weapon definitions which can be equipped at once,
+// across the whole party and every enemy. Characters wearing the same armour or
+// carrying the same weapon all point at a single shared copy of it.
+#define ITEM_DEF_CACHE_SIZE		16
+#define WEAPON_DEF_CACHE_SIZE	12
+
+// Size of the scratch region at the top of the startup memory arena, which
+// holds the record buffer while a map or story record is loaded. Must be at
+// least DATA_RECORD_BUFFER_SIZE.
+#define ARENA_SCRATCH_SIZE	1024
+
+// Memory budgets, checked when main_ql.c is compiled (and reported in detail
+// by 'make budget'). The fixed footprint is everything reserved for the
+// startup arena; on an unexpanded 128KB machine it must leave room for QDOS,
+// the program itself, the datafile indexes and the stack. The map and story
+// caches only use what is left over.
+#define MEMORY_BUDGET				(28 * 1024L)
+#define MEMORY_BUDGET_GAMESTATE		6656
+#define MEMORY_BUDGET_LEVELSTATE	256
+
 #endif
\ No newline at end of file
@@ -36,12 +36,733 @@
 #ifndef _ERROR_H
 #include "../common/error.h"
 #endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#endif
 #include "../common/conditions.h"
 
+// Datafile handle table, indexed by DATA_FILE_xxx
+char *data_file_names[DATA_FILES] = {
+	MAP_IDX,
+	MAP_DAT,
+	STORY_IDX,
+	STORY_DAT,
+	WEAPON_DAT,
+	ITEM_DAT,
+	MONSTER_DAT,
+	NPC_DAT,
+	SPRITE_DAT,
+	PORTRAIT_DAT,
+	BOSS_DAT,
+};
+int data_file_handles[DATA_FILES] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};	// Open file handle, or -1 if not (yet) open
+long data_file_pos[DATA_FILES];		// Last known position within each file
+DataStats_t data_stats;
+
+// Byte-pair dictionary for compressed story text, see data_DecodeStory()
+unsigned char data_story_dict[STORY_DICT_SIZE][2];
+unsigned char data_story_dict_size = 0;		// Entries loaded, 0 if the story text is plain ASCII
+
+#if MAP_CACHE_SIZE > 0
+// Recently decoded map locations; a slot is NULL if there was no memory for it
+MapCache_t *data_map_cache[MAP_CACHE_SIZE];
+#endif
+#if STORY_CACHE_SIZE > 0
+// Story text fragments loaded ahead of time by the prefetcher; a slot is NULL
+// if there was no memory for it
+StoryCache_t *data_story_cache[STORY_CACHE_SIZE];
+#endif
+// Item and weapon definitions currently (or recently) equipped by a character,
+// plus the empty definitions that every unused slot points at
+ItemDef_t data_item_defs[ITEM_DEF_CACHE_SIZE];
+WeaponDef_t data_weapon_defs[WEAPON_DEF_CACHE_SIZE];
+ItemState_t data_no_item;
+WeaponState_t data_no_weapon;
+unsigned short data_cache_clock = 0;		// Ticks on every cache access, used to find the least recently used entries
+Prefetch_t data_prefetch = { PREFETCH_STEPS, { 0, 0, 0, 0 } };	// Nothing to prefetch until a location is entered
+
+#ifndef DATA_INDEX_ON_DISK
+// In-memory copies of the story and map .idx files
+DataIndex_t data_story_index;
+DataIndex_t data_map_index;
+#endif
+
+int data_OpenFiles(){
+	// Open every datafile once at the start of the game.
+	// The handles are then re-used by all of the data_LoadXXX functions
+	// for the rest of the session, instead of an open/close per load.
+	
+	unsigned char i;
+	int status = DATA_LOAD_OK;
+	
+	for (i = 0; i < DATA_FILES; i++){
+		data_file_handles[i] = -1;
+		data_file_pos[i] = 0;
+		if (data_Handle(i) < 0){
+			status = DATA_LOAD_HANDLE;
+		}
+	}
+	return status;
+}
+
+void data_CloseFiles(){
+	// Close any datafiles which are still open
+	
+	unsigned char i;
+	
+	for (i = 0; i < DATA_FILES; i++){
+		if (data_file_handles[i] >= 0){
+			close(data_file_handles[i]);
+			data_file_handles[i] = -1;
+		}
+	}
+}
+
+int data_Handle(unsigned char file_id){
+	// Return the open handle for a datafile, opening it if
+	// it has not been opened yet, or has previously gone stale
+	
+	if (data_file_handles[file_id] < 0){
+		data_file_handles[file_id] = open(data_file_names[file_id], O_RDONLY);
+		data_file_pos[file_id] = 0;
+		data_stats.opens++;
+	}
+	return data_file_handles[file_id];
+}
+
+int data_Reopen(unsigned char file_id){
+	// A handle has gone stale (e.g. the medium was changed or the
+	// channel was closed underneath us). Close it, open it again and
+	// put the file position back where it was. If the position cannot be
+	// restored the handle is closed again, so that nothing reads from the
+	// wrong place.
+	
+	long pos = data_file_pos[file_id];
+	long status;
+	
+	if (data_file_handles[file_id] >= 0){
+		close(data_file_handles[file_id]);
+		data_file_handles[file_id] = -1;
+	}
+	data_stats.reopens++;
+	if (data_Handle(file_id) < 0){
+		return data_file_handles[file_id];
+	}
+	data_stats.seeks++;
+	status = lseek(data_file_handles[file_id], pos, SEEK_SET);
+	if (status < 0){
+		close(data_file_handles[file_id]);
+		data_file_handles[file_id] = -1;
+		data_file_pos[file_id] = 0;
+		return (int) status;
+	}
+	data_file_pos[file_id] = status;
+	return data_file_handles[file_id];
+}
+
+long data_Seek(unsigned char file_id, long offset, int whence){
+	// Seek within an open datafile, re-opening the handle once if it has gone stale
+	
+	long status;
+	
+	if (data_Handle(file_id) < 0){
+		return data_file_handles[file_id];
+	}
+	
+	// Records read one after another, in file order, need no seek at all
+	if ((whence == SEEK_SET) && (offset == data_file_pos[file_id])){
+		return offset;
+	}
+	data_stats.seeks++;
+	status = lseek(data_file_handles[file_id], offset, whence);
+	if (status < 0){
+		if (data_Reopen(file_id) < 0){
+			return data_file_handles[file_id];
+		}
+		data_stats.seeks++;
+		status = lseek(data_file_handles[file_id], offset, whence);
+	}
+	if (status >= 0){
+		data_file_pos[file_id] = status;
+	}
+	return status;
+}
+
+int data_Read(unsigned char file_id, void *buf, unsigned short size){
+	// Read from the current position of an open datafile, re-opening
+	// the handle once if it has gone stale
+	
+	int status;
+	
+	if (data_Handle(file_id) < 0){
+		return data_file_handles[file_id];
+	}
+	data_stats.reads++;
+	status = read(data_file_handles[file_id], buf, size);
+	if (status < 0){
+		if (data_Reopen(file_id) < 0){
+			return data_file_handles[file_id];
+		}
+		data_stats.reads++;
+		status = read(data_file_handles[file_id], buf, size);
+	}
+	if (status > 0){
+		data_file_pos[file_id] += status;
+	}
+	return status;
+}
+
+DataStats_t * data_Stats(){
+	// Return the running totals of datafile opens, seeks and reads
+	return &data_stats;
+}
+
+int data_LoadIndexes(Screen_t *screen){
+	// Load the story and map index files into memory, so that
+	// later lookups do not need to touch the .idx files at all.
+	// Does nothing if the indexes are configured to stay on disk.
+	
+#ifndef DATA_INDEX_ON_DISK
+	int status;
+	
+	status = data_LoadIndex(DATA_FILE_STORY_IDX, &data_story_index);
+	if (status == DATA_LOAD_OK){
+		status = data_LoadIndex(DATA_FILE_MAP_IDX, &data_map_index);
+	}
+	if (status == DATA_INDEX_MEMORY){
+		ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_INDEX_MEMORY_MSG, status);
+	} else if (status != DATA_LOAD_OK){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_INDEX_READ_MSG, status);
+	}
+	return status;
+#else
+	return DATA_LOAD_OK;
+#endif
+}
+
+int data_LoadIndex(unsigned char file_id, DataIndex_t *index){
+	// Read an entire index file into a newly allocated table
+	
+	long size;
+	
+	index->entries = 0;
+	index->data = NULL;
+	
+	size = data_Seek(file_id, 0, SEEK_END);
+	if (size < DATA_HEADER_ENTRY_SIZE){
+		return DATA_INDEX_READ;
+	}
+	data_Seek(file_id, 0, SEEK_SET);
+	
+	index->data = (unsigned char *) malloc(size);
+	if (index->data == NULL){
+		return DATA_INDEX_MEMORY;
+	}
+	if (data_Read(file_id, index->data, (unsigned short) size) != size){
+		free(index->data);
+		index->data = NULL;
+		return DATA_INDEX_READ;
+	}
+	index->entries = size / DATA_HEADER_ENTRY_SIZE;
+	return DATA_LOAD_OK;
+}
+
+void data_FreeIndexes(){
+	// Release the memory held by the in-memory index tables
+	
+#ifndef DATA_INDEX_ON_DISK
+	if (data_story_index.data != NULL){
+		free(data_story_index.data);
+		data_story_index.data = NULL;
+	}
+	if (data_map_index.data != NULL){
+		free(data_map_index.data);
+		data_map_index.data = NULL;
+	}
+	data_story_index.entries = 0;
+	data_map_index.entries = 0;
+#endif
+}
+
+int data_IndexLookup(unsigned char file_id, unsigned short entry, unsigned short *record_size, unsigned long *record_offset){
+	// Find the size and offset of a record in a .dat file from its index entry.
+	// Entries come from the in-memory table where possible, or from disk if
+	// the indexes are configured to stay on disk (or failed to load).
+	
+#ifndef DATA_INDEX_ON_DISK
+	DataIndex_t *index;
+	
+	if (file_id == DATA_FILE_STORY_IDX){
+		index = &data_story_index;
+	} else {
+		index = &data_map_index;
+	}
+	
+	if (index->data != NULL){
+		if (entry >= index->entries){
+			*record_size = 0;
+			*record_offset = 0;
+			return DATA_INDEX_RANGE;
+		}
+		memcpy(record_size, index->data + (entry * DATA_HEADER_ENTRY_SIZE), DATA_HEADER_RECORD_SIZE);
+		memcpy(record_offset, index->data + (entry * DATA_HEADER_ENTRY_SIZE) + DATA_HEADER_RECORD_SIZE, DATA_HEADER_OFFSET_SIZE);
+		return DATA_LOAD_OK;
+	}
+#endif
+	
+	// Seek to the right ID in the header
+	if (data_Seek(file_id, ((long) entry * DATA_HEADER_ENTRY_SIZE), SEEK_SET) < 0){
+		return DATA_INDEX_READ;
+	}
+	
+	// Read the header entry for this record
+	if (data_Read(file_id, record_size, DATA_HEADER_RECORD_SIZE) != DATA_HEADER_RECORD_SIZE){		// This is the size of the record, in bytes
+		return DATA_INDEX_READ;
+	}
+	if (data_Read(file_id, record_offset, DATA_HEADER_OFFSET_SIZE) != DATA_HEADER_OFFSET_SIZE){	// This is the offset of the record, in bytes from 0
+		return DATA_INDEX_READ;
+	}
+	return DATA_LOAD_OK;
+}
+
+
+unsigned char * data_Get(void *dest, unsigned char *src, unsigned short size){
+	// Copy a field out of a record buffer and return a cursor
+	// to the field that follows it
+	
+	memcpy(dest, src, size);
+	return src + size;
+}
+
+unsigned char * data_GetRequire(LevelState_t *levelstate, unsigned char *offset, unsigned char number, unsigned char *src, unsigned short *pool){
+	// Copy a requirement list out of a record buffer into the next free
+	// part of the requirement pool of a location, and return a cursor to
+	// the field that follows it. 'pool' is the number of pool bytes used so
+	// far, and is left above the size of the pool if the list does not fit.
+	
+	unsigned short size;
+	
+	size = number * COND_LENGTH;
+	*offset = 0;
+	if (number == 0){
+		return src;
+	}
+	if ((number > MAX_REQUIREMENTS) || ((*pool + size) > sizeof(levelstate->requires))){
+		*pool = sizeof(levelstate->requires) + 1;
+		return src + size;
+	}
+	*offset = *pool;
+	memcpy(levelstate->requires + *pool, src, size);
+	*pool += size;
+	return src + size;
+}
+
+void * data_CacheEntry(unsigned short size){
+	// Allocate a zeroed cache entry, as long as at least MAP_CACHE_MIN_FREE
+	// bytes would still be free afterwards. Returns NULL otherwise.
+	
+	void *entry;
+	void *reserve;
+	
+	entry = malloc(size);
+	if (entry == NULL){
+		return NULL;
+	}
+	reserve = malloc(MAP_CACHE_MIN_FREE);
+	if (reserve == NULL){
+		free(entry);
+		return NULL;
+	}
+	free(reserve);
+	memset(entry, 0, size);
+	return entry;
+}
+
+void data_CacheInit(){
+	// Size the map and story caches from the memory left once everything
+	// else has been allocated at startup. Each cache gets as many of its
+	// entries as will fit, which may be none at all.
+	
+	unsigned char i;
+	
+#if MAP_CACHE_SIZE > 0
+	memset(data_map_cache, 0, sizeof(data_map_cache));
+	for (i = 0; i < MAP_CACHE_SIZE; i++){
+		data_map_cache[i] = (MapCache_t *) data_CacheEntry(sizeof(MapCache_t));
+		if (data_map_cache[i] == NULL){
+			break;
+		}
+	}
+#endif
+#if STORY_CACHE_SIZE > 0
+	memset(data_story_cache, 0, sizeof(data_story_cache));
+	for (i = 0; i < STORY_CACHE_SIZE; i++){
+		data_story_cache[i] = (StoryCache_t *) data_CacheEntry(STORY_CACHE_ENTRY_BYTES);
+		if (data_story_cache[i] == NULL){
+			break;
+		}
+		data_story_cache[i]->text = (unsigned char *)(data_story_cache[i] + 1);
+	}
+#endif
+}
+
+MapCache_t * data_MapCacheFind(unsigned short id){
+	// Return the map cache entry holding a location, or NULL if it is not cached
+	
+#if MAP_CACHE_SIZE > 0
+	unsigned char i;
+	
+	if (id == 0){
+		return NULL;
+	}
+	for (i = 0; i < MAP_CACHE_SIZE; i++){
+		if ((data_map_cache[i] != NULL) && (data_map_cache[i]->id == id)){
+			data_cache_clock++;
+			data_map_cache[i]->last_used = data_cache_clock;
+			return data_map_cache[i];
+		}
+	}
+#endif
+	return NULL;
+}
+
+unsigned char data_MapCacheLRU(){
+	// Return the slot number of an unused map cache entry, or failing that
+	// the least recently used one, or MAP_CACHE_SIZE if the cache has no
+	// entries at all
+	
+	unsigned char lru = MAP_CACHE_SIZE;
+#if MAP_CACHE_SIZE > 0
+	unsigned char i;
+	unsigned short age = 0;
+	
+	for (i = 0; i < MAP_CACHE_SIZE; i++){
+		if (data_map_cache[i] != NULL){
+			if (data_map_cache[i]->id == 0){
+				return i;
+			}
+			if ((unsigned short)(data_cache_clock - data_map_cache[i]->last_used) >= age){
+				age = data_cache_clock - data_map_cache[i]->last_used;
+				lru = i;
+			}
+		}
+	}
+#endif
+	return lru;
+}
+
+MapCache_t * data_MapCacheSlot(){
+	// Return a map cache entry that a newly loaded location can be
+	// decoded into; an unused entry if there is one, otherwise the least
+	// recently used entry is recycled. Returns NULL if the cache has no
+	// entries.
+	
+#if MAP_CACHE_SIZE > 0
+	unsigned char i;
+	
+	i = data_MapCacheLRU();
+	if (i == MAP_CACHE_SIZE){
+		return NULL;
+	}
+	data_cache_clock++;
+	memset(data_map_cache[i], 0, sizeof(MapCache_t));
+	data_map_cache[i]->last_used = data_cache_clock;
+	return data_map_cache[i];
+#else
+	return NULL;
+#endif
+}
+
+unsigned char data_MapCacheCount(){
+	// Return the number of locations currently held in the map cache
+	
+	unsigned char count = 0;
+#if MAP_CACHE_SIZE > 0
+	unsigned char i;
+	
+	for (i = 0; i < MAP_CACHE_SIZE; i++){
+		if ((data_map_cache[i] != NULL) && (data_map_cache[i]->id != 0)){
+			count++;
+		}
+	}
+#endif
+	return count;
+}
+
+unsigned char data_MapCacheShrink(){
+	// Free an unused, or the least recently used, map cache entry, to give
+	// some memory back. Returns 1 if an entry was freed, or 0 if the cache
+	// had no entries left.
+	
+#if MAP_CACHE_SIZE > 0
+	unsigned char lru;
+	
+	lru = data_MapCacheLRU();
+	if (lru != MAP_CACHE_SIZE){
+		free(data_map_cache[lru]);
+		data_map_cache[lru] = NULL;
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+void data_MapCacheFree(){
+	// Empty the map cache and free all of its entries
+	
+	while(data_MapCacheShrink());
+}
+
+StoryCache_t * data_StoryCacheFind(unsigned short id){
+	// Return the story cache entry holding a text fragment, or NULL if it is not cached
+	
+#if STORY_CACHE_SIZE > 0
+	unsigned char i;
+	
+	for (i = 0; i < STORY_CACHE_SIZE; i++){
+		if ((data_story_cache[i] != NULL) && (data_story_cache[i]->size != 0) && (data_story_cache[i]->id == id)){
+			data_cache_clock++;
+			data_story_cache[i]->last_used = data_cache_clock;
+			return data_story_cache[i];
+		}
+	}
+#endif
+	return NULL;
+}
+
+unsigned char data_StoryCacheLRU(){
+	// Return the slot number of an unused story cache entry, or failing that
+	// the least recently used one, or STORY_CACHE_SIZE if the cache has no
+	// entries at all
+	
+	unsigned char lru = STORY_CACHE_SIZE;
+#if STORY_CACHE_SIZE > 0
+	unsigned char i;
+	unsigned short age = 0;
+	
+	for (i = 0; i < STORY_CACHE_SIZE; i++){
+		if (data_story_cache[i] != NULL){
+			if (data_story_cache[i]->size == 0){
+				return i;
+			}
+			if ((unsigned short)(data_cache_clock - data_story_cache[i]->last_used) >= age){
+				age = data_cache_clock - data_story_cache[i]->last_used;
+				lru = i;
+			}
+		}
+	}
+#endif
+	return lru;
+}
+
+StoryCache_t * data_StoryCacheSlot(unsigned short size){
+	// Return a story cache entry for a 'size' byte record, replacing the
+	// least recently used entry if the cache is full. The entry stays
+	// unused until its size is set. Returns NULL if the record is longer
+	// than STORY_CACHE_TEXT_BYTES, or the cache has no entries.
+	
+#if STORY_CACHE_SIZE > 0
+	unsigned char slot;
+	
+	if (size > STORY_CACHE_TEXT_BYTES){
+		return NULL;
+	}
+	slot = data_StoryCacheLRU();
+	if (slot == STORY_CACHE_SIZE){
+		return NULL;
+	}
+	data_cache_clock++;
+	data_story_cache[slot]->id = 0;
+	data_story_cache[slot]->size = 0;
+	data_story_cache[slot]->last_used = data_cache_clock;
+	return data_story_cache[slot];
+#else
+	return NULL;
+#endif
+}
+
+unsigned char data_StoryCacheShrink(){
+	// Free an unused, or the least recently used, story cache entry, to give
+	// some memory back. Returns 1 if an entry was freed, or 0 if the cache
+	// had no entries left.
+	
+#if STORY_CACHE_SIZE > 0
+	unsigned char lru;
+	
+	lru = data_StoryCacheLRU();
+	if (lru != STORY_CACHE_SIZE){
+		free(data_story_cache[lru]);
+		data_story_cache[lru] = NULL;
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+void data_StoryCacheFree(){
+	// Empty the story cache and free all of its entries
+	
+	while(data_StoryCacheShrink());
+}
+
+unsigned char data_CacheShrink(){
+	// Called when an allocation elsewhere has failed. Gives one story
+	// cache entry back (or a map cache entry once those are gone), and
+	// returns 1, or 0 if both caches are already empty.
+	
+	if (data_StoryCacheShrink()){
+		return 1;
+	}
+	return data_MapCacheShrink();
+}
+
+int data_PrefetchMap(Screen_t *screen, unsigned short id){
+	// Decode a location into the map cache ahead of time, if it is not there already
+	
+	MapCache_t *entry;
+	int status;
+	
+	if (data_MapCacheFind(id) != NULL){
+		return DATA_LOAD_OK;
+	}
+	entry = data_MapCacheSlot();
+	if (entry == NULL){
+		return DATA_LOAD_OK;
+	}
+	status = data_DecodeMap(screen, &entry->level, id);
+	if (status == DATA_LOAD_OK){
+		entry->id = id;
+		data_stats.prefetches++;
+	}
+	return status;
+}
+
+int data_PrefetchStory(unsigned short id){
+	// Read a story text record into the story cache ahead of time,
+	// without touching the text buffers in the gamestate. The record
+	// is kept compressed until data_LoadStory() needs it.
+	
+	StoryCache_t *entry;
+	unsigned short record_size = 0;
+	unsigned long record_offset = 0;
+	int status;
+	
+	if (data_StoryCacheFind(id) != NULL){
+		return DATA_LOAD_OK;
+	}
+	status = data_IndexLookup(DATA_FILE_STORY_IDX, id, &record_size, &record_offset);
+	if (status != DATA_LOAD_OK){
+		return status;
+	}
+	if (record_size > MAX_STORY_TEXT_SIZE){
+		return DATA_LOAD_STORY_DATFILE;
+	}
+	entry = data_StoryCacheSlot(record_size);
+	if (entry == NULL){
+		return DATA_LOAD_OK;
+	}
+	data_Seek(DATA_FILE_STORY_DAT, record_offset, SEEK_SET);
+	status = data_Read(DATA_FILE_STORY_DAT, entry->text, record_size);
+	if (status != record_size){
+		// Leave the entry unused
+		return DATA_LOAD_STORY_DATFILE;
+	}
+	entry->id = id;
+	entry->size = record_size;
+	data_stats.prefetches++;
+	return DATA_LOAD_OK;
+}
+
+void data_PrefetchStart(LevelState_t *levelstate){
+	// Set up the prefetcher with the exits of the newly entered location
+	
+	data_prefetch.exits[0] = levelstate->north;
+	data_prefetch.exits[1] = levelstate->south;
+	data_prefetch.exits[2] = levelstate->east;
+	data_prefetch.exits[3] = levelstate->west;
+	data_prefetch.step = 0;
+}
+
+unsigned char data_PrefetchStep(Screen_t *screen){
+	// Run the next prefetch step, loading at most one record.
+	// Called repeatedly while waiting for a key press, so it must return quickly.
+	// Returns 1 if there is still more to prefetch, or 0 when finished.
+	
+	MapCache_t *entry;
+	unsigned short id;
+	
+	while (data_prefetch.step < PREFETCH_STEPS){
+		id = data_prefetch.exits[data_prefetch.step >> 1];
+		data_prefetch.step++;
+		if (id == 0){
+			continue;
+		}
+		if (data_prefetch.step & 0x01){
+			// Map record of this exit
+			data_PrefetchMap(screen, id);
+			return 1;
+		} else {
+			// Default story text of this exit (only if the map record made it into the cache)
+			entry = data_MapCacheFind(id);
+			if (entry != NULL){
+				data_PrefetchStory(entry->level.text);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
 
 int data_LoadMap(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short id){
+	// Load a gameworld map location into the global 'levelstate' struct.
+	// Recently visited locations come from the map cache, anything
+	// else is decoded from disk and added to the cache.
+	
+	MapCache_t *entry;
+	int status;
+	
+	entry = data_MapCacheFind(id);
+	if (entry != NULL){
+		data_stats.map_hits++;
+		memcpy(levelstate, &entry->level, sizeof(LevelState_t));
+	} else {
+		data_stats.map_misses++;
+		entry = data_MapCacheSlot();
+		if (entry != NULL){
+			status = data_DecodeMap(screen, &entry->level, id);
+			if (status != DATA_LOAD_OK){
+				return status;
+			}
+			entry->id = id;
+			memcpy(levelstate, &entry->level, sizeof(LevelState_t));
+		} else {
+			// No room to cache this location, decode it directly
+			status = data_DecodeMap(screen, levelstate, id);
+			if (status != DATA_LOAD_OK){
+				return status;
+			}
+		}
+	}
+	
+	// Runtime state always starts afresh when entering a location
+	levelstate->spawned = 0;	// Monsters have not spawned yet
+	levelstate->has_npc1 = 0;	// NPC 1 ise not available until their condition requirements are evaluated
+	levelstate->has_npc2 = 0;	// NPC 2
+	levelstate->has_npc3 = 0;	// NPC 3
+	levelstate->selected_npc = 0;
+	
+	// Requirement lists now belong to this location
+	check_Changed(gamestate);
+	
+	return DATA_LOAD_OK;
+}
+
+int data_DecodeMap(Screen_t *screen, LevelState_t *levelstate, unsigned short id){
 	// Load a gameworld map from disk, parsing it and inserting
-	// the data into the global 'levelstate' struct.
+	// the data into a 'levelstate' struct.
+	//
+	// The whole record is read in one go into the record buffer,
+	// and then decoded field by field from memory.
 	
 	unsigned short record_size = 0;
 	unsigned long record_offset = 0;
@@ -49,182 +770,192 @@ int data_LoadMap(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelst
 	unsigned char total_items = 0;
 	unsigned char item_type;
 	unsigned char item_id;
+	unsigned char *buffer;
+	unsigned char *p;
+	unsigned short pool = 0;
 	int f;
 	
-	f = open(MAP_IDX, O_RDONLY);
+	// Find the size and offset of this location, map ID's start from 1
+	f = data_IndexLookup(DATA_FILE_MAP_IDX, id - 1, &record_size, &record_offset);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_INDEX_MSG, f);
 		return DATA_LOAD_MAP_INDEXFILE;	
 	}
+	if (record_size > DATA_RECORD_BUFFER_SIZE){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_SIZE_MSG, record_size);
+		return DATA_LOAD_MAP_SIZE;
+	}
 	
-	// Seek to the right ID in the header
-	lseek(f, ((id - 1) * DATA_HEADER_ENTRY_SIZE), SEEK_SET);
-	
-	// Read the header entry for this record
-	read(f, &record_size, DATA_HEADER_RECORD_SIZE);		// This is the size of the record, in bytes
-	read(f, &record_offset, DATA_HEADER_OFFSET_SIZE);		// This is the offset of the record, in bytes from 0
-	close(f);
-	
-	f = open(MAP_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_MAP_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_DAT_MSG, f);
 		return DATA_LOAD_MAP_DATFILE;	
 	}
 	
-	// Seek to the data record itself
-	lseek(f, record_offset, SEEK_SET);
+	// The record buffer is only needed until the record is decoded
+	arena_ScratchReset();
+	buffer = (unsigned char *) arena_Scratch(DATA_RECORD_BUFFER_SIZE);
+	if (buffer == NULL){
+		ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_SCRATCH_MSG, DATA_LOAD_SCRATCH);
+		return DATA_LOAD_SCRATCH;
+	}
+	
+	// Seek to the data record itself and read all of it
+	data_Seek(DATA_FILE_MAP_DAT, record_offset, SEEK_SET);
+	f = data_Read(DATA_FILE_MAP_DAT, buffer, record_size);
+	if (f != record_size){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_DAT_READ, f);
+		return DATA_LOAD_MAP_DATFILE;
+	}
+	p = buffer;
 	
 	// (2 bytes) Level ID
-	read(f, &levelstate->id, 2);
+	p = data_Get(&levelstate->id, p, 2);
 	if (levelstate->id != id){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_MISMATCH_MSG, 0);
-		close(f);
 		return DATA_LOAD_MAP_MISMATCH;	
 	}
 	
 	// (2 bytes) Primary text ID
-	read(f, &levelstate->text, 2);
+	p = data_Get(&levelstate->text, p, 2);
 
 	// (32 bytes) Level name 
-	read(f, &levelstate->name, MAX_LEVEL_NAME_SIZE);
+	p = data_Get(&levelstate->name, p, MAX_LEVEL_NAME_SIZE);
 	
 	// =====================================
 	// North exit
 	// =====================================
 	
 	// (2 bytes) North exit ID
-	read(f, &levelstate->north, 2);
+	p = data_Get(&levelstate->north, p, 2);
 	
 	// (2 bytes) North exit text label ID
-	read(f, &levelstate->north_text, 2);
+	p = data_Get(&levelstate->north_text, p, 2);
 	
 	// North condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->north_eval_type, 1);
-	read(f, &levelstate->north_require_number, 1,);
-	if (levelstate->north_require_number != 0){
-		read(f, &levelstate->north_require, (COND_LENGTH * levelstate->north_require_number));
-	}
+	levelstate->north_eval_type = *p++;
+	levelstate->north_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->north_require, levelstate->north_require_number, p, &pool);
 	
 	// =====================================
 	// South exit
 	// =====================================	
 	
 	// (2 bytes) South exit ID
-	read(f, &levelstate->south, 2);
+	p = data_Get(&levelstate->south, p, 2);
 	
 	// (2 bytes) South exit text label ID
-	read(f, &levelstate->south_text, 2);
+	p = data_Get(&levelstate->south_text, p, 2);
 	
 	// South condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->south_eval_type, 1);
-	read(f, &levelstate->south_require_number, 1);
-	if (levelstate->south_require_number != 0){
-		read(f, &levelstate->south_require, (COND_LENGTH * levelstate->south_require_number));
-	}
+	levelstate->south_eval_type = *p++;
+	levelstate->south_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->south_require, levelstate->south_require_number, p, &pool);
 
 	// =====================================
 	// East exit
 	// =====================================	
 	
 	// (2 bytes) East exit ID
-	read(f, &levelstate->east, 2);
+	p = data_Get(&levelstate->east, p, 2);
 	
 	// (2 bytes) East exit text label ID
-	read(f, &levelstate->east_text, 2);
+	p = data_Get(&levelstate->east_text, p, 2);
 	
 	// East condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->east_eval_type, 1);
-	read(f, &levelstate->east_require_number, 1);
-	if (levelstate->east_require_number != 0){
-		read(f, &levelstate->east_require, (COND_LENGTH * levelstate->east_require_number));
-	}
+	levelstate->east_eval_type = *p++;
+	levelstate->east_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->east_require, levelstate->east_require_number, p, &pool);
 
 	// =====================================
 	// West exit
 	// =====================================	
 	
 	// (2 bytes) West exit ID
-	read(f, &levelstate->west, 2);
+	p = data_Get(&levelstate->west, p, 2);
 	
 	// (2 bytes) West exit text label ID
-	read(f, &levelstate->west_text, 2);
+	p = data_Get(&levelstate->west_text, p, 2);
 	
 	// West condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->west_eval_type, 1);
-	read(f, &levelstate->west_require_number, 1);
-	if (levelstate->west_eval_type != 0){
-		read(f, &levelstate->west_require, (COND_LENGTH * levelstate->west_require_number));
-	}
+	levelstate->west_eval_type = *p++;
+	levelstate->west_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->west_require, levelstate->west_require_number, p, &pool);
 	
 	// =====================================
 	// Primary monsters
 	// =====================================
 	
 	// (1 bytes) primary monster spawn chance
-	read(f, &levelstate->spawn_chance, 1);
+	levelstate->spawn_chance = *p++;
 	
 	// (1 byte) number of monster ID's that follow
-	read(f, &levelstate->spawn_number, 1);
+	levelstate->spawn_number = *p++;
+	if (levelstate->spawn_number > MAX_MONSTER_TYPES){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_LISTS_MSG, id);
+		return DATA_LOAD_MAP_LISTS;
+	}
 	if (levelstate->spawn_number > 0){
-		read(f, &levelstate->spawn_list, levelstate->spawn_number);	
+		p = data_Get(&levelstate->spawn_list, p, levelstate->spawn_number);	
 	}
 	
 	// Spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->spawn_eval_type, 1);
-	read(f, &levelstate->spawn_require_number, 1);
-	if (levelstate->spawn_require_number != 0){
-		read(f, &levelstate->spawn_require, (COND_LENGTH * levelstate->spawn_require_number));
-	}
+	levelstate->spawn_eval_type = *p++;
+	levelstate->spawn_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->spawn_require, levelstate->spawn_require_number, p, &pool);
 	
 	// =====================================
 	// Secondary monsters
 	// =====================================
 	
 	// (1 bytes) secondary monster spawn chance
-	read(f, &levelstate->respawn_chance, 1);
+	levelstate->respawn_chance = *p++;
 	
 	// (1 byte) number of monster ID's that follow
-	read(f, &levelstate->respawn_number, 1);
+	levelstate->respawn_number = *p++;
+	if (levelstate->respawn_number > MAX_MONSTER_TYPES){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_LISTS_MSG, id);
+		return DATA_LOAD_MAP_LISTS;
+	}
 	if (levelstate->respawn_number > 0){
-		read(f, &levelstate->respawn_list, levelstate->respawn_number);	
+		p = data_Get(&levelstate->respawn_list, p, levelstate->respawn_number);	
 	}
 	
 	// Spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->respawn_eval_type, 1);
-	read(f, &levelstate->respawn_require_number, 1);
-	if (levelstate->respawn_require_number != 0){
-		read(f, &levelstate->respawn_require, (COND_LENGTH * levelstate->respawn_require_number));
-	}
+	levelstate->respawn_eval_type = *p++;
+	levelstate->respawn_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->respawn_require, levelstate->respawn_require_number, p, &pool);
 
 	// ====================================
 	// Items/Treasure
 	// ====================================
 	
 	// (1 bytes) item spawn chance
-	read(f, &levelstate->items_chance, 1);
+	levelstate->items_chance = *p++;
 	
 	// (1 byte) number of item ID's that follow
-	read(f, &total_items, 1);
+	total_items = *p++;
+	if (total_items > MAX_REWARD_ITEMS){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_LISTS_MSG, id);
+		return DATA_LOAD_MAP_LISTS;
+	}
 	
 	// Empty the list of weapons and items
-	levelstate->weapons_number = 0;
-	levelstate->items_number = 0;
-	
-	// If we set a number of items, proceed to read each pair of 
-	// bytes (item type + item id)
 	for (i = 0; i < MAX_REWARD_ITEMS; i++){
-		levelstate->weapons_list[0] = 0;
-		levelstate->items_list[0] = 0;
+		levelstate->weapons_list[i] = 0;
+		levelstate->items_list[i] = 0;
 	}
 	levelstate->weapons_number = 0;
 	levelstate->items_number = 0;
 	
+	// If we set a number of items, proceed to read each pair of 
+	// bytes (item type + item id)
 	if (total_items > 0){
 		// Extract items and weapons and put them in the correct array
 		
 		for (i = 0; i < total_items; i++){
-			read(f, &item_type, 1);
-			read(f, &item_id, 1);
+			item_type = *p++;
+			item_id = *p++;
 			
 			// Check for 'w' or 'i'
 			if (item_type == ITEM_TYPE_WEAPON){
@@ -239,137 +970,223 @@ int data_LoadMap(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelst
 	}
 	
 	// Item spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->items_eval_type, 1);
-	read(f, &levelstate->items_require_number, 1);
-	if (levelstate->items_require_number != 0){
-		read(f, &levelstate->items_require, (COND_LENGTH * levelstate->items_require_number));
-	}
+	levelstate->items_eval_type = *p++;
+	levelstate->items_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->items_require, levelstate->items_require_number, p, &pool);
 	
 	
 	// ==================================================
 	// (2 bytes) Text shown when primary monsters spawn
 	// ==================================================
-	read(f, &levelstate->text_spawn, 2);
+	p = data_Get(&levelstate->text_spawn, p, 2);
 	
 	// ==================================================
-	// (2 bytes) Text shown when primary monsters spawn
+	// (2 bytes) Text shown after primary monsters are defeated
 	// ==================================================
-	read(f, &levelstate->text_after_spawn, 2);
+	p = data_Get(&levelstate->text_after_spawn, p, 2);
 
 	// ==================================================
-	// (2 bytes) Text shown when primary monsters spawn
+	// (2 bytes) Text shown when secondary monsters spawn
 	// ==================================================
-	read(f, &levelstate->text_respawn, 2);
+	p = data_Get(&levelstate->text_respawn, p, 2);
 	
 	// ==================================================
-	// (2 bytes) Text shown when primary monsters spawn
+	// (2 bytes) Text shown after secondary monsters are defeated
 	// ==================================================
-	read(f, &levelstate->text_after_respawn, 2);
+	p = data_Get(&levelstate->text_after_respawn, p, 2);
 		
 	// ==================================================
 	// NPC 1
 	// ==================================================
 	
 	// (1 byte) NPC 1 ID
-	read(f, &levelstate->npc1, 1);
+	levelstate->npc1 = *p++;
 	
 	// NPC 1 spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->npc1_eval_type, 1);
-	read(f, &levelstate->npc1_require_number, 1);
-	if (levelstate->npc1_require_number != 0){
-		read(f, &levelstate->npc1_require, (COND_LENGTH * levelstate->npc1_require_number));
-	}
+	levelstate->npc1_eval_type = *p++;
+	levelstate->npc1_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->npc1_require, levelstate->npc1_require_number, p, &pool);
 	
 	// (1 byte) NPC 1 unique dialogue ID
-	read(f, &levelstate->npc1_text_unique_id, 1);
+	levelstate->npc1_text_unique_id = *p++;
 	
 	// (2 byte) NPC 1 text ID
-	read(f, &levelstate->npc1_text, 2);
+	p = data_Get(&levelstate->npc1_text, p, 2);
 		
 	// ==================================================
 	// NPC 2
 	// ==================================================
 	
 	// (1 byte) NPC 2 ID
-	read(f, &levelstate->npc2, 1);
+	levelstate->npc2 = *p++;
 	
 	// NPC 2 spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->npc2_eval_type, 1);
-	read(f, &levelstate->npc2_require_number, 1);
-	if (levelstate->npc2_require_number != 0){
-		read(f, &levelstate->npc2_require, (COND_LENGTH * levelstate->npc2_require_number));
-	}
+	levelstate->npc2_eval_type = *p++;
+	levelstate->npc2_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->npc2_require, levelstate->npc2_require_number, p, &pool);
 	
 	// (1 byte) NPC 2 unique dialogue ID
-	read(f, &levelstate->npc2_text_unique_id, 1);
+	levelstate->npc2_text_unique_id = *p++;
 	// (2 byte) NPC 2 text ID
-	read(f, &levelstate->npc2_text, 2);
+	p = data_Get(&levelstate->npc2_text, p, 2);
 	
 	// ==================================================
 	// NPC 3
 	// ==================================================
 	
 	// (1 byte) NPC 3 ID
-	read(f, &levelstate->npc3, 1);
+	levelstate->npc3 = *p++;
 	
 	// NPC 3 spawn condition (min 2 bytes, possibly 7+)
-	read(f, &levelstate->npc3_eval_type, 1);
-	read(f, &levelstate->npc3_require_number, 1);
-	if (levelstate->npc3_require_number != 0){
-		read(f, &levelstate->npc3_require, (COND_LENGTH * levelstate->npc3_require_number));
-	}
+	levelstate->npc3_eval_type = *p++;
+	levelstate->npc3_require_number = *p++;
+	p = data_GetRequire(levelstate, &levelstate->npc3_require, levelstate->npc3_require_number, p, &pool);
 	
 	// (1 byte) NPC 3 unique dialogue ID
-	read(f, &levelstate->npc3_text_unique_id, 1);
+	levelstate->npc3_text_unique_id = *p++;
 	// (2 byte) NPC 3 text ID
-	read(f, &levelstate->npc3_text, 2);
+	p = data_Get(&levelstate->npc3_text, p, 2);
 	
-	levelstate->spawned = 0;	// Monsters have not spawned yet
-	levelstate->has_npc1 = 0;	// NPC 1 ise not available until their condition requirements are evaluated
-	levelstate->has_npc2 = 0;	// NPC 2
-	levelstate->has_npc3 = 0;	// NPC 3
+	// (1 byte) Background image flag
+	levelstate->background = *p++;
+	
+	// Nothing may have been decoded from beyond the end of the record
+	if ((p - buffer) > record_size){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_SIZE_MSG, record_size);
+		return DATA_LOAD_MAP_SIZE;
+	}
+	
+	// Every requirement list must have fitted into the pool
+	if (pool > sizeof(levelstate->requires)){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MAP_REQUIRES_MSG, id);
+		return DATA_LOAD_MAP_REQUIRES;
+	}
+	
+	return DATA_LOAD_OK;
+}
+
+int data_LoadStoryDict(Screen_t *screen){
+	// Load the byte-pair dictionary used by compressed story text.
+	// The dictionary file is optional; without it the story text is plain ASCII.
+	
+	int f;
+	unsigned char i;
+	unsigned char entries = 0;
 	
+	data_story_dict_size = 0;
+	f = open(STORY_DIC, O_RDONLY);
+	if (f < 0){
+		return DATA_LOAD_OK;
+	}
+	if ((read(f, &entries, 1) != 1) || (entries > STORY_DICT_SIZE) || (read(f, data_story_dict, entries * 2) != (entries * 2))){
+		close(f);
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_STORY_DICT_MSG, DATA_LOAD_STORY_DICT);
+		return DATA_LOAD_STORY_DICT;
+	}
 	close(f);
+	
+	// Each entry may only refer to the entries before it, which also
+	// rules out any loops when the codes are expanded
+	for (i = 0; i < entries; i++){
+		if ((data_story_dict[i][0] >= (STORY_DICT_FIRST + i)) || (data_story_dict[i][1] >= (STORY_DICT_FIRST + i))){
+			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_STORY_DICT_MSG, DATA_LOAD_STORY_DICT);
+			return DATA_LOAD_STORY_DICT;
+		}
+	}
+	data_story_dict_size = entries;
 	return DATA_LOAD_OK;
 }
 
+unsigned short data_DecodeStory(char *dest, unsigned short pos, unsigned char *src, unsigned short size){
+	// Expand 'size' bytes of a story record onto the end of 'dest' (currently 'pos'
+	// characters long) and return the new length. Bytes below STORY_DICT_FIRST are
+	// plain characters, anything else is a dictionary code standing for a pair of
+	// bytes, either of which may itself be a code. Records can therefore be expanded
+	// a piece at a time, as they are read. The text is always terminated and never
+	// grows past MAX_STORY_TEXT_SIZE.
+	
+	unsigned char stack[STORY_DICT_DEPTH + 1];
+	unsigned char sp;
+	unsigned char c;
+	
+	while (size--){
+		stack[0] = *src++;
+		sp = 1;
+		while (sp){
+			c = stack[--sp];
+			if ((c >= STORY_DICT_FIRST) && ((c - STORY_DICT_FIRST) < data_story_dict_size) && (sp < STORY_DICT_DEPTH)){
+				// Push the second byte first, so the first is expanded next
+				stack[sp++] = data_story_dict[c - STORY_DICT_FIRST][1];
+				stack[sp++] = data_story_dict[c - STORY_DICT_FIRST][0];
+			} else if (pos < MAX_STORY_TEXT_SIZE){
+				dest[pos++] = c;
+			}
+		}
+	}
+	dest[pos] = '\0';
+	return pos;
+}
+
 int data_LoadStory(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short id){
 	// Load a story text fragment into the global ui text buffer
 	
 	unsigned short record_size = 0;
 	unsigned long record_offset = 0;
-	unsigned short i = 0;
+	unsigned short pos;
+	unsigned short chunk;
+	unsigned char *buffer;
+	StoryCache_t *entry;
 	int f;
 	
-	f = open(STORY_IDX, O_RDONLY);
+	// Use the copy loaded ahead of time, if there is one
+	entry = data_StoryCacheFind(id);
+	if (entry != NULL){
+		data_stats.story_hits++;
+		data_DecodeStory(gamestate->buf, 0, entry->text, entry->size);
+		return DATA_LOAD_OK;
+	}
+	
+	// Find the size and offset of this text fragment
+	f = data_IndexLookup(DATA_FILE_STORY_IDX, id, &record_size, &record_offset);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_STORY_INDEX_MSG, f);
 		return DATA_LOAD_STORY_INDEXFILE;	
 	}
 	
-	// Seek to the right ID in the header
-	lseek(f, (id * DATA_HEADER_ENTRY_SIZE), SEEK_SET);
-	
-	// Read the header entry for this record
-	read(f, &record_size, DATA_HEADER_RECORD_SIZE);		// This is the size of the record, in bytes
-	read(f, &record_offset, DATA_HEADER_OFFSET_SIZE);	// This is the offset of the record, in bytes from 0
-	close(f);
-	
-	
-	f = open(STORY_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_STORY_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_STORY_DAT_MSG, f);
-		close(f);
 		return DATA_LOAD_STORY_DATFILE;	
 	}
+	// The record buffer is only needed until the text is expanded
+	arena_ScratchReset();
+	buffer = (unsigned char *) arena_Scratch(DATA_RECORD_BUFFER_SIZE);
+	if (buffer == NULL){
+		ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_SCRATCH_MSG, DATA_LOAD_SCRATCH);
+		return DATA_LOAD_SCRATCH;
+	}
+	
 	// Seek to the data record itself
-	lseek(f, record_offset, SEEK_SET);
+	data_Seek(DATA_FILE_STORY_DAT, record_offset, SEEK_SET);
 		
-	// Read DATA_HEADER_RECORD_SIZE worth of bytes
-	memset(gamestate->buf, '\0', record_size + 1);
-	read(f, gamestate->buf, record_size);
+	// Read the record a buffer at a time, expanding each piece
+	// straight into the text buffer as it arrives
+	pos = 0;
+	gamestate->buf[0] = '\0';
+	while (record_size > 0){
+		chunk = record_size;
+		if (chunk > DATA_RECORD_BUFFER_SIZE){
+			chunk = DATA_RECORD_BUFFER_SIZE;
+		}
+		f = data_Read(DATA_FILE_STORY_DAT, buffer, chunk);
+		if (f != chunk){
+			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_STORY_DAT_READ, f);
+			return DATA_LOAD_STORY_DATFILE;
+		}
+		pos = data_DecodeStory(gamestate->buf, pos, buffer, chunk);
+		record_size -= chunk;
+	}
 	
-	close(f);
 	return DATA_LOAD_OK;
 }
 
@@ -380,57 +1197,63 @@ int data_LoadItem(Screen_t *screen, ItemState_t *itemstate, unsigned char id){
 	
 	int status;
 	int f;
-	char t[8];
+	unsigned char buf[ITEM_DAT_SIZE];
+	unsigned char *p;
 		
-	f = open(ITEM_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_ITEM_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_ITEM_DAT_MSG, f);
 		return DATA_LOAD_ITEM_DATFILE;	
 	}
 	
 	// The position in the file is the storage size of a item record * item id
-	status = lseek(f, ITEM_DAT_SIZE * (id - 1), SEEK_SET);
+	status = data_Seek(DATA_FILE_ITEM_DAT, ITEM_DAT_SIZE * (id - 1), SEEK_SET);
 	if (status < (ITEM_DAT_SIZE * (id - 1))){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_ITEM_DAT_SEEK, status);
-		close(f);
 		return DATA_LOAD_ITEM_DATFILE;
 	}
 	
+	// Read the whole record, then decode it from memory
+	status = data_Read(DATA_FILE_ITEM_DAT, buf, ITEM_DAT_SIZE);
+	if (status != ITEM_DAT_SIZE){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_ITEM_DAT_READ, status);
+		return DATA_LOAD_ITEM_DATFILE;
+	}
+	p = buf;
+	
 	// 1 byte for item id
-	read(f, &itemstate->item_id, 1);
+	itemstate->item_id = *p++;
 	
 	// 18 bytes for name
-	read(f, &itemstate->name, MAX_WEAPON_NAME);
+	p = data_Get(&itemstate->name, p, MAX_WEAPON_NAME);
 	
 	// 1 byte for class limit
-	read(f, &itemstate->class_limit, 1);
+	itemstate->class_limit = *p++;
 	
 	// 1 byte for race limit
-	read(f, &itemstate->race_limit, 1);
+	itemstate->race_limit = *p++;
 	
 	// 1 byte for item type
-	read(f, &itemstate->type, 1);
+	itemstate->type = *p++;
 
 	// 1 byte for item slot
-	read(f, &itemstate->slot, 1);
+	itemstate->slot = *p++;
 	
 	// 2 byte for item value
-	read(f, &itemstate->value, 2);
+	p = data_Get(&itemstate->value, p, 2);
 	
 	// 1 byte for AC value
-	read(f, &itemstate->ac, 1);
+	itemstate->ac = *p++;
 	
 	// 1 byte for AC type
-	read(f, &itemstate->ac_type, 1);
+	itemstate->ac_type = *p++;
 	
 	// 5 bytes for effect list
-	read(f, &itemstate->effectlist, 5);
+	p = data_Get(&itemstate->effectlist, p, 5);
 	
 	// 2 bytes for text ID
-	read(f, &itemstate->text_id, 2);
+	p = data_Get(&itemstate->text_id, p, 2);
 	
-	close(f);
-			
 	return DATA_LOAD_OK;
 }
 
@@ -440,108 +1263,301 @@ int data_LoadWeapon(Screen_t *screen, WeaponState_t *weaponstate, unsigned char
 	
 	int status;
 	int f;
+	unsigned char buf[WEAPON_DAT_SIZE];
+	unsigned char *p;
 	
-	f = open(WEAPON_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_WEAPON_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_WEAPON_DAT_MSG, f);
 		return DATA_LOAD_WEAPONFILE;	
 	}
 	
 	// The position in the file is the storage size of a weapon record * weapon id
-	status = lseek(f, WEAPON_DAT_SIZE * (id - 1), SEEK_SET);
+	status = data_Seek(DATA_FILE_WEAPON_DAT, WEAPON_DAT_SIZE * (id - 1), SEEK_SET);
 	if (status < (WEAPON_DAT_SIZE * (id - 1))){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_WEAPON_DAT_SEEK, status);
-		close(f);
 		return DATA_LOAD_WEAPONFILE;
 	}
 	
+	// Read the whole record, then decode it from memory
+	status = data_Read(DATA_FILE_WEAPON_DAT, buf, WEAPON_DAT_SIZE);
+	if (status != WEAPON_DAT_SIZE){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_WEAPON_DAT_READ, status);
+		return DATA_LOAD_WEAPONFILE;
+	}
+	p = buf;
+	
 	// 1 byte for weapon id
-	read(f, &weaponstate->item_id, 1);
+	weaponstate->item_id = *p++;
 	
 	// 1 byte for handedness
-	read(f, &weaponstate->weapon_type, 1);
+	weaponstate->weapon_type = *p++;
 	
 	// 1 byte for class
-	read(f, &weaponstate->weapon_class, 1);
+	weaponstate->weapon_class = *p++;
 	
 	// 1 byte for rarity
-	read(f, &weaponstate->rarity, 1);
+	weaponstate->rarity = *p++;
 	
 	// 1 byte for size
-	read(f, &weaponstate->size, 1);
+	weaponstate->size = *p++;
 	
 	// 1 byte for proficiency #1
-	read(f, &weaponstate->proficiency_1, 1);
+	weaponstate->proficiency_1 = *p++;
 	
 	// 1 byte for proficiency #2
-	read(f, &weaponstate->proficiency_2, 1);
+	weaponstate->proficiency_2 = *p++;
 	
 	// 18 bytes for name
-	read(f, &weaponstate->name, MAX_WEAPON_NAME);
+	p = data_Get(&weaponstate->name, p, MAX_WEAPON_NAME);
 	
 	// 3 bytes total
 	// 1 byte critical range min
-	read(f, &weaponstate->crit_min, 1);
+	weaponstate->crit_min = *p++;
 	// 1 byte critical range max
-	read(f, &weaponstate->crit_max, 1);
+	weaponstate->crit_max = *p++;
 	// 1 byte critical additional dice number
-	read(f, &weaponstate->crit_dice_qty, 1);
+	weaponstate->crit_dice_qty = *p++;
 	
 	// 1 byte for versatile
-	read(f, &weaponstate->versatile, 1);
+	weaponstate->versatile = *p++;
 	
 	// 1 byte for finesse
-	read(f, &weaponstate->finesse, 1);
+	weaponstate->finesse = *p++;
 	
 	// 1 byte for silvered
-	read(f, &weaponstate->silvered, 1);
+	weaponstate->silvered = *p++;
 	
 	// 1 byte for bonus (+1, +2 weapon etc)
-	read(f, &weaponstate->bonus, 1);
+	weaponstate->bonus = *p++;
 	
 	// 2 byte for cost/base value
-	read(f, &weaponstate->value, 2);
+	p = data_Get(&weaponstate->value, p, 2);
 	
 	// 9 bytes total
 	// damage type 1
-	read(f, &weaponstate->dmg1_type, 1);
-	read(f, &weaponstate->dmg1_dice_qty, 1);
-	read(f, &weaponstate->dmg1_dice_type, 1);
+	weaponstate->dmg1_type = *p++;
+	weaponstate->dmg1_dice_qty = *p++;
+	weaponstate->dmg1_dice_type = *p++;
 	
 	// damage type 2
-	read(f, &weaponstate->dmg2_type, 1);
-	read(f, &weaponstate->dmg2_dice_qty, 1);
-	read(f, &weaponstate->dmg2_dice_type, 1);
+	weaponstate->dmg2_type = *p++;
+	weaponstate->dmg2_dice_qty = *p++;
+	weaponstate->dmg2_dice_type = *p++;
 	
 	// damage type 3
-	read(f, &weaponstate->dmg3_type, 1);
-	read(f, &weaponstate->dmg3_dice_qty, 1);
-	read(f, &weaponstate->dmg3_dice_type, 1);
+	weaponstate->dmg3_type = *p++;
+	weaponstate->dmg3_dice_qty = *p++;
+	weaponstate->dmg3_dice_type = *p++;
 	
 	// 2 bytes for text ID
-	read(f, &weaponstate->text_id, 2);
-	
-	close(f);
+	p = data_Get(&weaponstate->text_id, p, 2);
 	
 	return DATA_LOAD_OK;
 }
 
+ItemDef_t * data_ItemDef(unsigned char id){
+	// Return the shared entry holding an item definition, or a free entry
+	// it can be loaded into, or NULL if every entry is in use
+	
+	unsigned char i;
+	ItemDef_t *def = NULL;
+	
+	for (i = 0; i < ITEM_DEF_CACHE_SIZE; i++){
+		if (data_item_defs[i].item.item_id == id){
+			return &data_item_defs[i];
+		}
+		if ((def == NULL) && (data_item_defs[i].refs == 0)){
+			def = &data_item_defs[i];
+		}
+	}
+	return def;
+}
+
+ItemState_t * data_ItemRef(Screen_t *screen, unsigned char id){
+	// Return the shared copy of an item definition for a character slot,
+	// loading it from disk only if it is not already held.
+	// Id 0 is the empty slot, and never needs the disk.
+	
+	ItemDef_t *def;
+	
+	if (id == 0){
+		return &data_no_item;
+	}
+	def = data_ItemDef(id);
+	if (def == NULL){
+		ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_DEF_FULL_MSG, DATA_LOAD_DEF_FULL);
+		return &data_no_item;
+	}
+	if (def->item.item_id != id){
+		if (data_LoadItem(screen, &def->item, id) != DATA_LOAD_OK){
+			def->item.item_id = 0;
+			return &data_no_item;
+		}
+	}
+	def->refs++;
+	return &def->item;
+}
+
+ItemState_t * data_ItemShare(ItemState_t *item){
+	// As data_ItemRef(), but for a definition which has already been loaded,
+	// e.g. from the inventory screen. NULL is the empty slot.
+	// Returns NULL if every entry is in use.
+	
+	ItemDef_t *def;
+	
+	if ((item == NULL) || (item->item_id == 0)){
+		return &data_no_item;
+	}
+	def = data_ItemDef(item->item_id);
+	if (def == NULL){
+		return NULL;
+	}
+	if (def->item.item_id != item->item_id){
+		memcpy(&def->item, item, sizeof(ItemState_t));
+	}
+	def->refs++;
+	return &def->item;
+}
+
+void data_ItemRelease(ItemState_t *item){
+	// A character slot no longer points at this item definition
+	
+	unsigned char i;
+	
+	for (i = 0; i < ITEM_DEF_CACHE_SIZE; i++){
+		if ((&data_item_defs[i].item == item) && (data_item_defs[i].refs > 0)){
+			data_item_defs[i].refs--;
+			return;
+		}
+	}
+}
+
+WeaponDef_t * data_WeaponDef(unsigned char id){
+	// Return the shared entry holding a weapon definition, or a free entry
+	// it can be loaded into, or NULL if every entry is in use
+	
+	unsigned char i;
+	WeaponDef_t *def = NULL;
+	
+	for (i = 0; i < WEAPON_DEF_CACHE_SIZE; i++){
+		if (data_weapon_defs[i].weapon.item_id == id){
+			return &data_weapon_defs[i];
+		}
+		if ((def == NULL) && (data_weapon_defs[i].refs == 0)){
+			def = &data_weapon_defs[i];
+		}
+	}
+	return def;
+}
+
+WeaponState_t * data_WeaponRef(Screen_t *screen, unsigned char id){
+	// Return the shared copy of a weapon definition for a character slot,
+	// loading it from disk only if it is not already held.
+	// Id 0 is the empty slot, and never needs the disk.
+	
+	WeaponDef_t *def;
+	
+	if (id == 0){
+		return &data_no_weapon;
+	}
+	def = data_WeaponDef(id);
+	if (def == NULL){
+		ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_DEF_FULL_MSG, DATA_LOAD_DEF_FULL);
+		return &data_no_weapon;
+	}
+	if (def->weapon.item_id != id){
+		if (data_LoadWeapon(screen, &def->weapon, id) != DATA_LOAD_OK){
+			def->weapon.item_id = 0;
+			return &data_no_weapon;
+		}
+	}
+	def->refs++;
+	return &def->weapon;
+}
+
+WeaponState_t * data_WeaponShare(WeaponState_t *weapon){
+	// As data_WeaponRef(), but for a definition which has already been loaded,
+	// e.g. from the inventory screen. NULL is the empty slot.
+	// Returns NULL if every entry is in use.
+	
+	WeaponDef_t *def;
+	
+	if ((weapon == NULL) || (weapon->item_id == 0)){
+		return &data_no_weapon;
+	}
+	def = data_WeaponDef(weapon->item_id);
+	if (def == NULL){
+		return NULL;
+	}
+	if (def->weapon.item_id != weapon->item_id){
+		memcpy(&def->weapon, weapon, sizeof(WeaponState_t));
+	}
+	def->refs++;
+	return &def->weapon;
+}
+
+void data_WeaponRelease(WeaponState_t *weapon){
+	// A character slot no longer points at this weapon definition
+	
+	unsigned char i;
+	
+	for (i = 0; i < WEAPON_DEF_CACHE_SIZE; i++){
+		if ((&data_weapon_defs[i].weapon == weapon) && (data_weapon_defs[i].refs > 0)){
+			data_weapon_defs[i].refs--;
+			return;
+		}
+	}
+}
+
+unsigned char pc_SlotItem(ItemState_t **slot, ItemState_t *item){
+	// Engine hook: point an equipment slot at the shared copy of an item
+	// definition, or at the empty item if NULL.
+	// Returns 0, leaving the slot as it was, if every entry is in use.
+	
+	ItemState_t *shared;
+	
+	shared = data_ItemShare(item);
+	if (shared == NULL){
+		return 0;
+	}
+	data_ItemRelease(*slot);
+	*slot = shared;
+	return 1;
+}
+
+unsigned char pc_SlotWeapon(WeaponState_t **slot, WeaponState_t *weapon){
+	// Engine hook: point an equipment slot at the shared copy of a weapon
+	// definition, or at the empty weapon if NULL.
+	// Returns 0, leaving the slot as it was, if every entry is in use.
+	
+	WeaponState_t *shared;
+	
+	shared = data_WeaponShare(weapon);
+	if (shared == NULL){
+		return 0;
+	}
+	data_WeaponRelease(*slot);
+	*slot = shared;
+	return 1;
+}
+
 int data_LoadSprite(Screen_t *screen, ssprite_t *sprite, unsigned short id){
 	// Load a single (non boss) sprite into a ssprite_t structure
 	
 	int status;
 	int f;
 	
-	f = open(SPRITE_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_SPRITE_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_SPRITE_DAT_MSG, f);
 		return DATA_LOAD_SPRITEFILE;	
 	}
 	
 	// The position in the file is the storage size of a sprite * sprite_ID
-	lseek(f, SPRITE_NORMAL_BYTES * id, SEEK_SET);
-	status = read(f, sprite->pixels, SPRITE_DAT_SIZE);
-	close(f);
+	data_Seek(DATA_FILE_SPRITE_DAT, SPRITE_NORMAL_BYTES * id, SEEK_SET);
+	draw_SpriteUncache(sprite->pixels);
+	status = data_Read(DATA_FILE_SPRITE_DAT, sprite->pixels, SPRITE_DAT_SIZE);
 	if (status < SPRITE_DAT_SIZE){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_SPRITE_DAT_READ, status);
 		return DATA_LOAD_SPRITEFILE;
@@ -562,16 +1578,16 @@ int data_LoadPortrait(Screen_t *screen, ssprite_t *sprite, unsigned short id){
 	int f;
 	int status;
 	
-	f = open(PORTRAIT_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_PORTRAIT_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_PORTRAIT_DAT_MSG, f);
 		return DATA_LOAD_PORTRAITFILE;	
 	}
 	
 	// The position in the file is the storage size of a sprite * sprite_ID
-	lseek(f, PORTRAIT_DAT_SIZE * id, SEEK_SET);
-	status = read(f, sprite->portrait, PORTRAIT_DAT_SIZE);
-	close(f);
+	data_Seek(DATA_FILE_PORTRAIT_DAT, PORTRAIT_DAT_SIZE * id, SEEK_SET);
+	draw_SpriteUncache(sprite->portrait);
+	status = data_Read(DATA_FILE_PORTRAIT_DAT, sprite->portrait, PORTRAIT_DAT_SIZE);
 	if (status < PORTRAIT_DAT_SIZE){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_PORTRAIT_DAT_READ, status);
 		return DATA_LOAD_PORTRAITFILE;
@@ -586,22 +1602,46 @@ int data_LoadPortrait(Screen_t *screen, ssprite_t *sprite, unsigned short id){
 	
 }
 
+int data_CopySprite(ssprite_t *sprite, ssprite_t *source){
+	// As data_LoadSprite(), but copying a sprite which is already loaded
+	
+	draw_SpriteUncache(sprite->pixels);
+	memcpy(sprite->pixels, source->pixels, SPRITE_DAT_SIZE);
+	sprite->width = DRAW_PC_WIDTH;
+	sprite->height = DRAW_PC_HEIGHT;
+	sprite->bpp = 0;
+	
+	return DATA_LOAD_OK;
+}
+
+int data_CopyPortrait(ssprite_t *sprite, ssprite_t *source){
+	// As data_LoadPortrait(), but copying a portrait which is already loaded
+	
+	draw_SpriteUncache(sprite->portrait);
+	memcpy(sprite->portrait, source->portrait, PORTRAIT_DAT_SIZE);
+	sprite->width = DRAW_PORTRAIT_WIDTH;
+	sprite->height = DRAW_PORTRAIT_HEIGHT;
+	sprite->bpp = 0;
+	
+	return DATA_LOAD_OK;
+}
+
 int data_LoadBoss(Screen_t *screen, lsprite_t *lsprite, unsigned short id){
 	// Load single boss sprite into a lsprite_t structure
 	
 	int f;
 	int status;
 	
-	f = open(BOSS_DAT, O_RDONLY);
+	f = data_Handle(DATA_FILE_BOSS_DAT);
 	if (f < 0){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_BOSS_DAT_MSG, f);
 		return DATA_LOAD_BOSSFILE;	
 	}
 	
 	// The position in the file is the storage size of a sprite * sprite_ID
-	lseek(f, BOSS_DAT_SIZE * id, SEEK_SET);
-	status = read(f, lsprite->pixels, BOSS_DAT_SIZE);
-	close(f);
+	data_Seek(DATA_FILE_BOSS_DAT, BOSS_DAT_SIZE * id, SEEK_SET);
+	draw_SpriteUncache(lsprite->pixels);
+	status = data_Read(DATA_FILE_BOSS_DAT, lsprite->pixels, BOSS_DAT_SIZE);
 	if (status < BOSS_DAT_SIZE){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_BOSS_DAT_READ, status);
 		return DATA_LOAD_BOSSFILE;
@@ -615,155 +1655,147 @@ int data_LoadBoss(Screen_t *screen, lsprite_t *lsprite, unsigned short id){
 	return DATA_LOAD_OK;
 }
 
-int data_CreateCharacter(Screen_t *screen, PlayerState_t *playerstate, ssprite_t *playersprite, lsprite_t *bosssprite, unsigned char character_type, short character_id){
-	// Create a new player, party or enemy character
-	// and load their sprite/portrait data
+int data_ReadCharacter(Screen_t *screen, unsigned char character_type, short character_id, unsigned char *buf){
+	// Read the raw monster/npc datafile record of a character into buf
 	
 	int f;
+	unsigned char df;
 	int status;
-	unsigned short sprite_id, portrait_id;
-	unsigned char i;
-	unsigned char w = 0;
-	unsigned char b;
 	int seek_offset = MONSTER_ENTRY_SIZE * character_id;
-		
+	
 	// character_type NPC
 	// Load from the NPC.DAT file
 	if (character_type == CHARACTER_TYPE_NPC){
-		f = open(NPC_DAT, O_RDONLY);
+		df = DATA_FILE_NPC_DAT;
+		f = data_Handle(df);
 		if (f < 0){
-			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_NPC_DAT_MSG, status);
+			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_NPC_DAT_MSG, f);
 			return DATA_LOAD_NPCFILE;	
 		}
 	} else {
 		// character_type MONSTER / BOSS
 		// Load data from the MONSTER.DAT file
-		f = open(MONSTER_DAT, O_RDONLY);
+		df = DATA_FILE_MONSTER_DAT;
+		f = data_Handle(df);
 		if (f < 0){
-			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MONSTER_DAT_MSG, status);
+			ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MONSTER_DAT_MSG, f);
 			return DATA_LOAD_MONSTERFILE;	
 		}
 	}
 	
 	// Seek to correct monster entry location
-	status = lseek(f, seek_offset, SEEK_SET);
+	status = data_Seek(df, seek_offset, SEEK_SET);
 	if (status != seek_offset){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MONSTER_DAT_SEEK, DATA_LOAD_MONSTERFILE_SEEK);
 		return DATA_LOAD_MONSTERFILE;
 	}
 	
+	// Read the whole record, then decode it from memory
+	status = data_Read(df, buf, MONSTER_ENTRY_SIZE);
+	if (status != MONSTER_ENTRY_SIZE){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MONSTER_DAT_READ, status);
+		return DATA_LOAD_MONSTERFILE;
+	}
+	
+	return DATA_LOAD_OK;
+}
+
+int data_DecodeCharacter(Screen_t *screen, PlayerState_t *playerstate, unsigned char *buf, short character_id, unsigned short *sprite_id, unsigned short *portrait_id){
+	// Fill in a character from a raw monster/npc datafile record,
+	// returning the ids of the sprite and portrait it uses
+	
+	unsigned char i;
+	unsigned char *p;
+	
+	p = buf;
+	
 	// 1. (2 bytes) character ID
-	read(f, &playerstate->id, 2);
+	p = data_Get(&playerstate->id, p, 2);
 	if (playerstate->id != character_id){
 		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_MONSTER_MISMATCH_MSG, DATA_LOAD_MONSTER_MISMATCH);
 		return DATA_LOAD_MONSTER_MISMATCH;	
 	}
 	
 	// 2. (18 bytes) character name
-	status = read(f, playerstate->name, MAX_PLAYER_NAME);
+	p = data_Get(playerstate->name, p, MAX_PLAYER_NAME);
 	strncpy(playerstate->short_name, playerstate->name, MAX_SHORT_NAME);
 	
 	// 3. (1 byte) character type (boss, enemy, npc)
-	read(f, &playerstate->type, 1);
+	playerstate->type = *p++;
 	
 	// 4. (1 byte) character sprite type (boss, normal monster)
-	read(f, &playerstate->sprite_type, 1);
+	playerstate->sprite_type = *p++;
 	
 	// 5a. (2 bytes) initial sprite ID 
-	read(f, &sprite_id, 2);
+	p = data_Get(sprite_id, p, 2);
 	
 	// 5b. (38 bytes) all other sprite IDs (not supported yet on QL)
-	lseek(f, 38, SEEK_CUR);
+	p += 38;
 	
 	// 6. (2 bytes) portrait sprite ID 
-	read(f, &portrait_id, 2);
+	p = data_Get(portrait_id, p, 2);
 	
 	// 7. (1 byte) character class	
-	read(f, &playerstate->player_class, 1);
+	playerstate->player_class = *p++;
 	//playerstate->player_class = b << 4;	// Class is the lower 4 bits
 	//playerstate->player_race = b >> 4;		// Race is the upper 4 bits
-	read(f, &playerstate->player_race, 1);
+	playerstate->player_race = *p++;
 	
 	// 8. (1 byte) character level
-	read(f, &playerstate->level, 1);
+	playerstate->level = *p++;
 	
 	// 9. (2 bytes) attack profile / aggression profile
-	read(f, &playerstate->profile, 2);
+	p = data_Get(&playerstate->profile, p, 2);
 	
 	// 10. (1 byte) str
-	read(f, &playerstate->str, 1);
+	playerstate->str = *p++;
 	
 	// 11. (1 byte) dex
-	read(f, &playerstate->dex, 1);
+	playerstate->dex = *p++;
 	
 	// 12. (1 byte) con
-	read(f, &playerstate->con, 1);
+	playerstate->con = *p++;
 	
 	// 13. (1 byte) wis
-	read(f, &playerstate->wis, 1);
+	playerstate->wis = *p++;
 	
 	// 14. (1 byte) intl
-	read(f, &playerstate->intl, 1);
+	playerstate->intl = *p++;
 	
 	// 15. (1 byte) chr
-	read(f, &playerstate->chr, 1);
+	playerstate->chr = *p++;
 	
 	// 16. (2 bytes) hp
-	read(f, &playerstate->hp, 2);
+	p = data_Get(&playerstate->hp, p, 2);
 	playerstate->hp_reset = playerstate->hp; // Copy HP to hp_reset
 	
 	// 17. (4 bytes) status effects bitfield
-	read(f, &playerstate->status, 4);
+	p = data_Get(&playerstate->status, p, 4);
 		
-	// Equipped items
-	read(f, &w, 1);	// Head
-	if (w){
-		data_LoadItem(screen, playerstate->head, w);
-	} else {
-		playerstate->head->item_id = 0;	
-	}
-	w = 0;
+	// Equipped items, shared with any other character using the same ones.
+	// Whatever the slots held before is given back first.
+	data_ItemRelease(playerstate->head);
+	playerstate->head = data_ItemRef(screen, *p++);
 	
-	read(f, &w, 1);	// Body
-	if (w){
-		data_LoadItem(screen, playerstate->body, w);
-	} else {
-		playerstate->body->item_id = 0;	
-	}
-	w = 0;
+	data_ItemRelease(playerstate->body);
+	playerstate->body = data_ItemRef(screen, *p++);
 	
-	read(f, &w, 1);	// Option item
-	if (w){
-		data_LoadItem(screen, playerstate->option, w);
-	} else {
-		playerstate->option->item_id = 0;	
-	}
-	w = 0;
+	data_ItemRelease(playerstate->option);
+	playerstate->option = data_ItemRef(screen, *p++);
 	
-	read(f, &w, 1);	// Weapon_r
-	if (w){
-		data_LoadWeapon(screen, playerstate->weapon_r, w);	
-	} else {
-		playerstate->weapon_r->item_id = 0;	
-	}
-	w = 0;
+	data_WeaponRelease(playerstate->weapon_r);
+	playerstate->weapon_r = data_WeaponRef(screen, *p++);
 	
-	read(f, &w, 1);	// Weapon_l
-	if (w){
-		data_LoadWeapon(screen, playerstate->weapon_l, w);	
-	} else {
-		playerstate->weapon_l->item_id = 0;	
-	}
+	data_WeaponRelease(playerstate->weapon_l);
+	playerstate->weapon_l = data_WeaponRef(screen, *p++);
 	
-	read(f, &playerstate->formation, 1);
+	playerstate->formation = *p++;
 		
 	playerstate->kills = 0;
 	playerstate->spells_cast = 0;
 	playerstate->hits_taken = 0;
 	playerstate->hits_caused = 0;
 	
-	close(f);
-	
 	
 	// Set initial items to empty
 	for (i = 0; i < MAX_ITEMS; i++){
@@ -813,6 +1845,26 @@ int data_CreateCharacter(Screen_t *screen, PlayerState_t *playerstate, ssprite_t
 		i++;
 	}
 	
+	return DATA_LOAD_OK;
+}
+
+int data_CreateCharacter(Screen_t *screen, PlayerState_t *playerstate, ssprite_t *playersprite, lsprite_t *bosssprite, unsigned char character_type, short character_id){
+	// Create a new player, party or enemy character
+	// and load their sprite/portrait data
+	
+	int status;
+	unsigned short sprite_id, portrait_id;
+	unsigned char buf[MONSTER_ENTRY_SIZE];
+	
+	status = data_ReadCharacter(screen, character_type, character_id, buf);
+	if (status != DATA_LOAD_OK){
+		return status;
+	}
+	status = data_DecodeCharacter(screen, playerstate, buf, character_id, &sprite_id, &portrait_id);
+	if (status != DATA_LOAD_OK){
+		return status;
+	}
+	
 	if (playerstate->type == CHARACTER_TYPE_BOSS){
 		status = data_LoadBoss(screen, bosssprite, sprite_id); 		// Load the large, 96x96 boss sprite
 	} else {
@@ -830,120 +1882,164 @@ int data_CreateCharacter(Screen_t *screen, PlayerState_t *playerstate, ssprite_t
 	return DATA_LOAD_OK;
 }
 
-char data_AddNPC(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id){
-	// Adds a record of an NPC to the game list, if it does not already exist
+void data_BatchOrder(unsigned char *order, unsigned short *keys, unsigned char count){
+	// Fill in the order in which to visit the entries of a batch so that
+	// their keys (record numbers) ascend. Equal keys keep their list order.
 	
-	struct NPCList *npc;
+	unsigned char i, j, o;
 	
-	npc = data_FindNPC(gamestate->npcs, id);
-	if (npc){
-		// Found, no need to create
-		return DATA_LOAD_OK;
+	for (i = 0; i < count; i++){
+		o = i;
+		for (j = i; (j > 0) && (keys[order[j - 1]] > keys[o]); j--){
+			order[j] = order[j - 1];
+		}
+		order[j] = o;
+	}
+}
+
+int data_CreateCharacters(Screen_t *screen, PlayerState_t **playerstates, ssprite_t **playersprites, lsprite_t *bosssprite, unsigned char character_type, unsigned char *character_ids, unsigned char count){
+	// Create a whole group of characters (an encounter, or the party) at once.
+	// Each datafile is read in a single forward pass, in record order, and a
+	// record, sprite or portrait shared by several of the group is only read
+	// once. Equipment is shared through data_ItemRef/data_WeaponRef.
+	
+	int status;
+	unsigned char i, c, prev;
+	unsigned char order[DATA_CHARACTER_BATCH];
+	unsigned short keys[DATA_CHARACTER_BATCH];
+	unsigned short sprite_ids[DATA_CHARACTER_BATCH];
+	unsigned short portrait_ids[DATA_CHARACTER_BATCH];
+	unsigned char buf[MONSTER_ENTRY_SIZE];
+	
+	if (count > DATA_CHARACTER_BATCH){
+		ui_DrawError(screen, DATA_LOAD_ERROR_MSG, DATA_LOAD_BATCH_SIZE_MSG, count);
+		return DATA_LOAD_BATCH_SIZE;
+	}
+	
+	// Character records, in file order
+	for (i = 0; i < count; i++){
+		keys[i] = character_ids[i];
+	}
+	data_BatchOrder(order, keys, count);
+	for (i = 0; i < count; i++){
+		c = order[i];
+		if ((i == 0) || (keys[c] != keys[order[i - 1]])){
+			status = data_ReadCharacter(screen, character_type, character_ids[c], buf);
+			if (status != DATA_LOAD_OK){
+				return status;
+			}
+		}
+		status = data_DecodeCharacter(screen, playerstates[c], buf, character_ids[c], &sprite_ids[c], &portrait_ids[c]);
+		if (status != DATA_LOAD_OK){
+			return status;
+		}
 	}
 	
-	// NPC does not exist
-	// Find last record
-	if (npc->id != 0){
-		npc = data_LastNPC(gamestate->npcs);
+	// Sprites, in file order. A boss has its own large sprite, in its own file.
+	data_BatchOrder(order, sprite_ids, count);
+	prev = count;
+	for (i = 0; i < count; i++){
+		c = order[i];
+		if (playerstates[c]->type == CHARACTER_TYPE_BOSS){
+			status = data_LoadBoss(screen, bosssprite, sprite_ids[c]);
+		} else if ((prev < count) && (sprite_ids[prev] == sprite_ids[c])){
+			status = data_CopySprite(playersprites[c], playersprites[prev]);
+		} else {
+			status = data_LoadSprite(screen, playersprites[c], sprite_ids[c]);
+			prev = c;
+		}
+		if (status != DATA_LOAD_OK){
+			return status;
+		}
+	}
 	
-		// Add another record for this NPC
-		npc->next = (struct NPCList *) calloc(sizeof(struct NPCList), 1);
-		if (npc->next == NULL){
-			// Error allocating memory
-			ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_NPCMEMORY_MSG, 0);
-			return DATA_LOAD_NPCMEMORY;
+	// Portraits, in file order
+	data_BatchOrder(order, portrait_ids, count);
+	for (i = 0; i < count; i++){
+		c = order[i];
+		if ((i > 0) && (portrait_ids[order[i - 1]] == portrait_ids[c])){
+			status = data_CopyPortrait(playersprites[c], playersprites[order[i - 1]]);
+		} else {
+			status = data_LoadPortrait(screen, playersprites[c], portrait_ids[c]);
 		}
+		if (status != DATA_LOAD_OK){
+			return status;
+		}
+	}
 	
-		// Add this npc into the next slot
-		npc->next->id = id;
-		npc->next->talked_count = 0;
-		npc->next->talked_time = 0;
-		npc->next->death_time = 0;
-		npc->next->next = NULL;	
-	} else {
-		
-		// This is the first npc
-		npc->id = id;
-		npc->talked_count = 0;
-		npc->talked_time = 0;
-		npc->death_time = 0;
-		npc->next = NULL;	
+	return DATA_LOAD_OK;
+}
+
+char data_AddNPC(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id){
+	// Adds a record of an NPC to the game list, if it does not already exist
+	
+	NPCState_t *npcs;
+	
+	npcs = &gamestate->npcs;
+	if (NPC_MET(npcs, id)){
+		// Already met, no need to create
+		return DATA_LOAD_OK;
 	}
+	
+	// First meeting with this NPC
+	npcs->met[id >> 3] |= (1 << (id & 0x07));
+	npcs->count++;
+	npcs->talked_count[id] = 0;
+	npcs->talked_time[id] = 0;
+	npcs->death_time[id] = 0;
+	memset(npcs->discussions[id], 0, NPC_DIALOGUE_BYTES);
+	check_Changed(gamestate);
 	return DATA_LOAD_OK;
 }
 
 char data_SetNPCDead(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id, unsigned char dead){
 	// Set the death time for this NPC to the current turn number
 	
-	struct NPCList *npc;
+	NPCState_t *npcs;
 	
-	npc = data_FindNPC(gamestate->npcs, id);
-	if (npc == NULL){
+	npcs = &gamestate->npcs;
+	if (!NPC_MET(npcs, id)){
 		// Not found
 		ui_DrawError(screen, DATA_LOAD_NPC_MISSING, DATA_LOAD_NPC_MISSING_DEATH, 0);
 		return DATA_LOAD_NO_NPC;
 	}
 	
 	if (dead){
-		npc->death_time = gamestate->counter;
+		npcs->death_time[id] = gamestate->counter;
 	} else {
-		npc->death_time = 0;	
+		npcs->death_time[id] = 0;	
 	}
+	check_Changed(gamestate);
 	return OK;
 }
 
 char data_IncrementNPCTalk(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id, unsigned char unique_dialogue_id){
-	// Increment the NPC talked_count figure and update the talked_time to current turn number
+	// Increment the NPC talked_count figure and update the talked_time to current turn number,
+	// and record that their unique dialogue (1 - 64) has taken place, if they have one
 	
-	struct NPCList *npc;
+	NPCState_t *npcs;
 	
-	npc = data_FindNPC(gamestate->npcs, id);
-	if (npc == NULL){
+	npcs = &gamestate->npcs;
+	if (!NPC_MET(npcs, id)){
 		// Not found
 		ui_DrawError(screen, DATA_LOAD_NPC_MISSING, DATA_LOAD_NPC_MISSING_TALK, 0);
 		return DATA_LOAD_NO_NPC;
 	}
 	
-	if (npc->talked_count < 255){
-		npc->talked_count++;	
-	}
-	npc->talked_time = gamestate->counter;
-	return OK;
-}
-
-struct NPCList * data_FindNPC(struct NPCList *npclist, unsigned char id){
-	// Find an NPC in the linked list of visited NPCs
-	while(npclist != NULL){
-		if (npclist->id == id){
-			return npclist;
-		}
-		npclist = npclist->next;
+	if (npcs->talked_count[id] < 255){
+		npcs->talked_count[id]++;	
 	}
-	return NULL;
-}
-
-struct NPCList * data_LastNPC(struct NPCList *npclist){
-	// Get the last NPC record
-	while(npclist->next != NULL){
-		npclist =  npclist->next;	
+	npcs->talked_time[id] = gamestate->counter;
+	if ((unique_dialogue_id > 0) && (unique_dialogue_id <= (NPC_DIALOGUE_BYTES * 8))){
+		unique_dialogue_id--;
+		npcs->discussions[id][unique_dialogue_id >> 3] |= (1 << (unique_dialogue_id & 0x07));
 	}
-	return npclist;
+	check_Changed(gamestate);
+	return OK;
 }
 
-unsigned char data_CountNPC(struct NPCList *npclist){
+unsigned short data_CountNPC(NPCState_t *npcs){
 	// Return count of encountered NPCs
-	unsigned char i = 0;
 	
-	if (npclist->id){
-		i++;
-		//printf("NPC %d\n", npclist->id);
-	}
-	while(npclist->next != NULL){
-		npclist = npclist->next;
-		//printf("NPC %d\n", npclist->id);
-		if (npclist->next != NULL){
-			i++;
-		}
-	}
-	return i;
+	return npcs->count;
 }
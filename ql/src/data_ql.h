@@ -19,6 +19,68 @@
 
 #ifndef _DATA_QL_DEFS_H
 #define _DATA_QL_DEFS_H
+
+// Datafiles which are opened once and held open for the whole session.
+// These are indexes into the data layer handle table.
+#define DATA_FILE_MAP_IDX		0
+#define DATA_FILE_MAP_DAT		1
+#define DATA_FILE_STORY_IDX		2
+#define DATA_FILE_STORY_DAT		3
+#define DATA_FILE_WEAPON_DAT	4
+#define DATA_FILE_ITEM_DAT		5
+#define DATA_FILE_MONSTER_DAT	6
+#define DATA_FILE_NPC_DAT		7
+#define DATA_FILE_SPRITE_DAT	8
+#define DATA_FILE_PORTRAIT_DAT	9
+#define DATA_FILE_BOSS_DAT		10
+#define DATA_FILES				11		// Total number of datafile handles
+
+// Size of the buffer that a variable length map record is read into before
+// it is decoded. A location with every condition list, spawn list and
+// item list full is 533 bytes.
+#define DATA_RECORD_BUFFER_SIZE	544
+
+// A .idx file held in memory. This is the raw file contents,
+// DATA_HEADER_ENTRY_SIZE bytes per entry, exactly as it is on disk.
+typedef struct {
+	unsigned short entries;		// Number of index entries held
+	unsigned char *data;		// Raw index entries
+} DataIndex_t;
+
+// Running totals of datafile activity, shown on the debug screen
+typedef struct {
+	unsigned short opens;		// Number of datafile open() calls, including re-opens
+	unsigned short reopens;		// Number of times a stale handle had to be re-opened
+	unsigned long seeks;		// Number of lseek() calls
+	unsigned long reads;		// Number of read() calls
+	unsigned short map_hits;	// Number of map loads served from the map cache
+	unsigned short map_misses;	// Number of map loads which had to be decoded from disk
+	unsigned short story_hits;	// Number of story loads served from the story cache
+	unsigned short prefetches;	// Number of records loaded ahead of time while waiting for input
+} DataStats_t;
+
+// A story text fragment loaded ahead of time. The record is held exactly
+// as it is on disk, and is only expanded when it is actually displayed.
+typedef struct {
+	unsigned short id;			// Story text ID held in this entry
+	unsigned short size;		// Length of the (compressed) record, in bytes, 0 if the entry is unused
+	unsigned short last_used;	// Cache clock value when this entry was last used
+	unsigned char *text;		// The record, held straight after the entry
+} StoryCache_t;
+
+// Idle time prefetch of the locations surrounding the current one. Each step
+// loads a single record; even steps are map records and odd steps their story text.
+#define PREFETCH_EXITS			4
+#define PREFETCH_STEPS			(PREFETCH_EXITS * 2)
+typedef struct {
+	unsigned char step;						// Next step to run, PREFETCH_STEPS once finished
+	unsigned short exits[PREFETCH_EXITS];	// Location IDs of the north, south, east and west exits
+} Prefetch_t;
+
+// Character equipment slots point at shared item/weapon definitions, so the
+// pc_SlotItem() and pc_SlotWeapon() engine hooks are provided by data_ql.c
+#define DATA_SHARED_DEFS
+
 #endif
 
 // Protos
@@ -36,23 +98,101 @@
 #include "../common/draw.h"
 #endif
 
+// A decoded map location held in the map cache. Only the static data from the
+// datafile record is meaningful here; the runtime fields of the LevelState_t
+// (spawned, has_npcN, selected_npc) are reset whenever an entry is copied out.
+typedef struct {
+	unsigned short id;			// Location ID held in this entry, 0 if unused
+	unsigned short last_used;	// Map cache clock value when this entry was last used
+	LevelState_t level;			// The decoded location
+} MapCache_t;
+
+// Map and story cache entries, allocated by data_CacheInit() from the memory
+// left after startup. Each story entry is followed by room for the longest
+// record it may hold. DATA_CACHE_BYTES is the most that the caches will take.
+#define STORY_CACHE_ENTRY_BYTES	(sizeof(StoryCache_t) + STORY_CACHE_TEXT_BYTES)
+#define DATA_CACHE_BYTES		((MAP_CACHE_SIZE * sizeof(MapCache_t)) + (STORY_CACHE_SIZE * STORY_CACHE_ENTRY_BYTES))
+
+// An item or weapon definition shared by every character slot holding it. An
+// entry with no references keeps its definition, so that it can be handed out
+// again without a load, until the entry is needed for a different one.
+typedef struct {
+	unsigned char refs;			// Number of character slots pointing at this entry
+	ItemState_t item;			// The definition, item_id 0 if the entry has never been used
+} ItemDef_t;
+typedef struct {
+	unsigned char refs;			// Number of character slots pointing at this entry
+	WeaponState_t weapon;		// The definition, item_id 0 if the entry has never been used
+} WeaponDef_t;
+
+// The most characters that data_CreateCharacters() will load in one batch;
+// a full encounter, or (being smaller) the whole party
+#define DATA_CHARACTER_BATCH	MAX_MONSTER_TYPES
+
+int data_OpenFiles();
+void data_CloseFiles();
+int data_Handle(unsigned char file_id);
+int data_Reopen(unsigned char file_id);
+long data_Seek(unsigned char file_id, long offset, int whence);
+int data_Read(unsigned char file_id, void *buf, unsigned short size);
+DataStats_t * data_Stats();
+int data_LoadIndexes(Screen_t *screen);
+int data_LoadIndex(unsigned char file_id, DataIndex_t *index);
+void data_FreeIndexes();
+int data_IndexLookup(unsigned char file_id, unsigned short entry, unsigned short *record_size, unsigned long *record_offset);
+
+unsigned char * data_Get(void *dest, unsigned char *src, unsigned short size);
+unsigned char * data_GetRequire(LevelState_t *levelstate, unsigned char *offset, unsigned char number, unsigned char *src, unsigned short *pool);
+
+int data_LoadStoryDict(Screen_t *screen);
+unsigned short data_DecodeStory(char *dest, unsigned short pos, unsigned char *src, unsigned short size);
 int data_LoadStory(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short id);
 int data_LoadMap(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short id);
+int data_DecodeMap(Screen_t *screen, LevelState_t *levelstate, unsigned short id);
+void * data_CacheEntry(unsigned short size);
+void data_CacheInit();
+MapCache_t * data_MapCacheFind(unsigned short id);
+MapCache_t * data_MapCacheSlot();
+unsigned char data_MapCacheLRU();
+unsigned char data_MapCacheCount();
+unsigned char data_MapCacheShrink();
+void data_MapCacheFree();
+StoryCache_t * data_StoryCacheFind(unsigned short id);
+StoryCache_t * data_StoryCacheSlot(unsigned short size);
+unsigned char data_StoryCacheShrink();
+void data_StoryCacheFree();
+unsigned char data_CacheShrink();
+int data_PrefetchMap(Screen_t *screen, unsigned short id);
+int data_PrefetchStory(unsigned short id);
+void data_PrefetchStart(LevelState_t *levelstate);
+unsigned char data_PrefetchStep(Screen_t *screen);
 int data_LoadSprite(Screen_t *screen, ssprite_t *sprite, unsigned short id);
 int data_LoadPortrait(Screen_t *screen, ssprite_t *sprite, unsigned short id);
 int data_LoadBoss(Screen_t *screen, lsprite_t *lsprite, unsigned short id);
+int data_CopySprite(ssprite_t *sprite, ssprite_t *source);
+int data_CopyPortrait(ssprite_t *sprite, ssprite_t *source);
 int data_LoadWeapon(Screen_t *screen, WeaponState_t *weaponstate, unsigned char id);
 int data_LoadItem(Screen_t *screen, ItemState_t *itemstate, unsigned char id);
+ItemDef_t * data_ItemDef(unsigned char id);
+ItemState_t * data_ItemRef(Screen_t *screen, unsigned char id);
+ItemState_t * data_ItemShare(ItemState_t *item);
+void data_ItemRelease(ItemState_t *item);
+WeaponDef_t * data_WeaponDef(unsigned char id);
+WeaponState_t * data_WeaponRef(Screen_t *screen, unsigned char id);
+WeaponState_t * data_WeaponShare(WeaponState_t *weapon);
+void data_WeaponRelease(WeaponState_t *weapon);
 char data_AddNPC(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id);
 char data_SetNPCDead(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id, unsigned char dead);
 char data_IncrementNPCTalk(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char id, unsigned char unique_dialogue_id);
 
-struct NPCList * data_FindNPC(struct NPCList *npclist, unsigned char id);
-struct NPCList * data_LastNPC(struct NPCList *npclist);
-unsigned char data_CountNPC(struct NPCList *npclist);
+unsigned short data_CountNPC(NPCState_t *npcs);
 
 // This is defined here and not in data.h as not all targets support bitmap sprites
 // as part of the player creation routine (e.g. text mode targets)
 int data_CreateCharacter(Screen_t *screen, PlayerState_t *playerstate, ssprite_t *playersprite, lsprite_t *bosssprite, unsigned char character_type, short character_id);
+int data_ReadCharacter(Screen_t *screen, unsigned char character_type, short character_id, unsigned char *buf);
+int data_DecodeCharacter(Screen_t *screen, PlayerState_t *playerstate, unsigned char *buf, short character_id, unsigned short *sprite_id, unsigned short *portrait_id);
+void data_BatchOrder(unsigned char *order, unsigned short *keys, unsigned char count);
+int data_CreateCharacters(Screen_t *screen, PlayerState_t **playerstates, ssprite_t **playersprites, lsprite_t *bosssprite, unsigned char character_type, unsigned char *character_ids, unsigned char count);
 
 #endif
\ No newline at end of file
@@ -41,14 +41,25 @@
 #ifndef _UI_H
 #include "../common/ui.h"
 #endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#endif
 #ifndef _ERROR_H
 #include "../common/error.h"
 #endif
+#ifndef _DATA_H
+#include "../common/data.h"
+#endif
+
+SpriteShift_t draw_sprite_shift[SPRITE_SHIFT_CACHE_SIZE];	// Pre-shifted copies of recently drawn sprites
+unsigned short draw_sprite_shift_clock;						// Incremented on every sprite drawn off an 8 pixel boundary
+unsigned char draw_unpack_buffer[LZ_BUFFER_SIZE];			// Compressed image data read from disk
+unsigned short draw_unpack_pos;								// Next byte to use in draw_unpack_buffer
+unsigned short draw_unpack_len;								// Number of bytes in draw_unpack_buffer
 
 int screen_Init(Screen_t *screen){
 	// Initialise screen and/or offscreen buffers
 	unsigned char i;
-	int f;
 	
 	// ========================================
 	//  Initialise offscreen video buffer
@@ -98,37 +109,16 @@ int screen_Init(Screen_t *screen){
 	screen->win = io_open(SCREEN_MODE, 0);
 	
 	// ==========================================
-	// Load font bitmap and initialise fonts
+	// Initialise fonts
 	// ==========================================
 	
-	// Initialise any fonts
-	screen->bmp = (bmpdata_t *) calloc(sizeof(bmpdata_t), 1);
-	if (screen->bmp == NULL){
-		// Couldn't allocate memory
-		return SCREEN_INIT_BMPMEMORY;	
-	}
-	screen->bmp->pixels = NULL;
-	
-	// Load and process the 8x8 font
-	f = open(FONT_8X8, O_RDONLY);
-	if (f < 0){
-		// Couldn't open font
-		return SCREEN_INIT_FONTFILE;
-	}
-	screen->font_8x8 = (fontdata_t *) calloc(sizeof(fontdata_t), 1);
-	if (screen->font_8x8 == NULL){
-		// Couldn't allocate memory
-		return SCREEN_INIT_FONTMEMORY;	
-	}
-	if (bmp_ReadFont(f, screen->bmp, screen->font_8x8, 1, 1, 8, 8) < 0){
-		// Couldn't process font bitmap to table
-		return SCREEN_INIT_FONTPROCESS;
-	}
-	screen->font_8x8->unknown_symbol = 37;	// Unknown characters are replaced with the symbol '%' (percent)
-	screen->font_8x8->ascii_start = 32;		// First ascii char in our 8x8 font set is the symbol ' ' (space)
+	// The 8x8 font is compiled into the binary (see font_ql.c),
+	// so there is no bitmap to load or slice up at startup.
+	screen->font_8x8 = &font_8x8_data;
 	
-	// Destroy the pixel memory which was used to load the font bitmap
-	free(screen->bmp->pixels);
+	// Build the ready-to-draw copies of each symbol in each text colour.
+	// Not fatal if there isn't the memory; text is then drawn the slow way.
+	draw_ExpandFont(screen->font_8x8);
 	
 	// At this point we have the bitmap font available, so can use graphical error messages
 	
@@ -139,7 +129,7 @@ int screen_Init(Screen_t *screen){
 	// ===========================================
 	
 	// Allocate memory for the progressive bmp loader
-	screen->bmpstate = (bmpstate_t *) calloc(sizeof(bmpstate_t), 1);
+	screen->bmpstate = (bmpstate_t *) arena_Alloc(sizeof(bmpstate_t));
 	if (screen->bmpstate == NULL){
 		// Couldn't allocate memory
 		ui_DrawError(screen, GENERIC_MEMORY_MSG, SCREEN_INIT_MEMORY_MSG, SCREEN_INIT_BMPSTATEMEMORY);
@@ -152,7 +142,7 @@ int screen_Init(Screen_t *screen){
 	// ===========================================
 	
 	for (i = 0; i < MAX_PLAYERS; i++){
-		screen->players[i] = (ssprite_t *) calloc(sizeof(ssprite_t), 1);
+		screen->players[i] = (ssprite_t *) arena_Alloc(sizeof(ssprite_t));
 		if (screen->players[i] == NULL){
 			// COuld not allocate memory for a player sprite
 			ui_DrawError(screen, GENERIC_MEMORY_MSG, SCREEN_INIT_MEMORY_MSG, SCREEN_INIT_PC_SPRITEMEMORY);
@@ -161,7 +151,7 @@ int screen_Init(Screen_t *screen){
 	}
 	
 	for (i = 0; i < MAX_MONSTER_TYPES; i++){
-		screen->enemies[i] = (ssprite_t *) calloc(sizeof(ssprite_t), 1);
+		screen->enemies[i] = (ssprite_t *) arena_Alloc(sizeof(ssprite_t));
 		if (screen->enemies[i] == NULL){
 			// COuld not allocate memory for a enemy sprite
 			ui_DrawError(screen, GENERIC_MEMORY_MSG, SCREEN_INIT_MEMORY_MSG, SCREEN_INIT_E_SPRITEMEMORY);
@@ -170,7 +160,7 @@ int screen_Init(Screen_t *screen){
 	}
 	
 	for (i = 0; i < MAX_BOSS_TYPES; i++){
-		screen->boss[i] = (lsprite_t *) calloc(sizeof(lsprite_t), 1);
+		screen->boss[i] = (lsprite_t *) arena_Alloc(sizeof(lsprite_t));
 		if (screen->boss[i] == NULL){
 			// COuld not allocate memory for boss sprite
 			ui_DrawError(screen, GENERIC_MEMORY_MSG, SCREEN_INIT_MEMORY_MSG, SCREEN_INIT_BOSS_SPRITEMEMORY);
@@ -178,9 +168,6 @@ int screen_Init(Screen_t *screen){
 		}
 	}
 	
-	// Close file handle used to load font bitmap file
-	close(f);
-	
 	return SCREEN_INIT_OK;
 }
 
@@ -203,34 +190,59 @@ void screen_Vsync(Screen_t *screen, unsigned char wait){
 void draw_Clear(Screen_t *screen){
 	// Clear screen (or offscreen buffer)
 	
-	unsigned short i;	// Loop counter
-	unsigned short *p;	// Pointer to the current 8 pixel block of screen memory (stored as a pair of bytes / single 16bit word)
-	
-	// Initialise the pointer to the start of screen memory buffer
-	p = (unsigned short*) screen->buf;
-	
-	// For every 8 pixel block / 16bit word, set those pixels to a given colour
-	for (i = 0 ; i < SCREEN_BLOCKS; i++){
-		*p = PIXEL_BLACK;
-		p++;
-	}
+	draw_Fill(screen, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, PIXEL_BLACK, 0, 0, MODE_PIXEL_SET);
+	screen->dirty = SCREEN_DIRTY_ALL;
 }
 
 void draw_Flip(Screen_t *screen){
 	// Swap offscreen buffer with video memory,
 	// if currently enabled.
+	// Only the bands of scanlines which have been drawn to since the
+	// last flip are copied, each run of adjacent bands in one go.
+	
+	unsigned char band = 0;
+	unsigned char first;
 	
 	if (screen->dirty){
 		
 		// Copy offscreen buffer
 		if (screen->indirect){
-			memcpy((unsigned char*) screen->screen, screen->buf, SCREEN_BYTES);
+			while (band < SCREEN_BANDS){
+				if (screen->dirty & (1UL << band)){
+					first = band;
+					while ((band < SCREEN_BANDS) && (screen->dirty & (1UL << band))){
+						band++;
+					}
+					memcpy((unsigned char*) screen->screen + (first * SCREEN_BAND_BYTES), (unsigned char*) screen->buf + (first * SCREEN_BAND_BYTES), (band - first) * SCREEN_BAND_BYTES);
+				} else {
+					band++;
+				}
+			}
 		}
 		
 		screen->dirty = 0;
 	}
 }
 
+void draw_Dirty(Screen_t *screen, unsigned short y, unsigned short height){
+	// Mark scanlines y to (y + height - 1) as changed, so
+	// that the next draw_Flip() copies them to video memory
+	
+	unsigned char band;
+	unsigned char last;
+	
+	if ((height == 0) || (y >= SCREEN_HEIGHT)){
+		return;
+	}
+	if ((y + height) > SCREEN_HEIGHT){
+		height = SCREEN_HEIGHT - y;
+	}
+	last = (y + height - 1) / SCREEN_BAND_ROWS;
+	for (band = y / SCREEN_BAND_ROWS; band <= last; band++){
+		screen->dirty |= (1UL << band);
+	}
+}
+
 void draw_SetMask(unsigned short fill, unsigned char vertical, unsigned char *drawing_mask_lo, unsigned char *drawing_mask_hi, unsigned char *pixel_skip, unsigned char *multi_colour){
 	// Set drawing mask based on the colour specified
 	// Returns 0 if the colour is normal
@@ -343,89 +355,127 @@ void draw_GetXY(unsigned short x, unsigned short y, unsigned short *addr, unsign
 void draw_HLine(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short fill, unsigned char pad, unsigned char mode){
 	// Draw a horizontal line of pixels
 	
-	unsigned short *p;
-	unsigned short c;
-	unsigned short start_p;  // Start position in screen buffer
-	unsigned short end_p;    // End position in screen buffer
-	unsigned char start_bits;
-	unsigned char end_bits;
-	unsigned char drawing_mask_lo = 0x00;
-	unsigned char drawing_mask_hi = 0x00;
-	unsigned short start_mask = 0x0000;
-	unsigned short drawing_mask = 0x0000;
-	unsigned short end_mask = 0x0000;
-	unsigned char pixel_skip = 0;
-	unsigned char multi_colour = 0;
-	
-	draw_GetXY(x + pad, y, &start_p, &start_bits);
-	draw_GetXY(x + length - pad, y, &end_p, &end_bits);
-	draw_SetMask(fill, 0, &drawing_mask_lo, &drawing_mask_hi, &pixel_skip, &multi_colour);
-	
-	p = (unsigned short*) screen->buf;
-	p += start_p;
-	
-	// Draw leading pixels if start_bits != 0
-	if (start_bits != 0){
-		start_mask = 0x0000;
-		if (drawing_mask_lo) start_mask = (drawing_mask_lo >> start_bits) << 8;
-		if (drawing_mask_hi) start_mask += (unsigned char) drawing_mask_hi >> start_bits;
-		if (mode == MODE_PIXEL_OR){
-			*p = *p | start_mask;
-		} else {
-			*p = start_mask;
-		}
-		p++;
-		c = start_p + 1;
-		if (start_bits % 2 != 0 ){
-			pixel_skip = 1;
-		}
-	} else {
-		c = start_p;	
-	}
+	draw_Fill(screen, x, y, length, 1, fill, pad, 0, mode);
+}
 
-	if (pad){
-		pixel_skip = 1;	
-	}
-	
-	// Draw main section of line in 8 pixel sections
-	drawing_mask = 0x0000;
-	if (drawing_mask_lo){
-		if (pad){
-			drawing_mask = (drawing_mask_lo >> 1) << 8;
-		} else {
-			drawing_mask = drawing_mask_lo << 8;
+void draw_Fill(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short height, unsigned short fill, unsigned char pad, unsigned char hatch, unsigned char mode){
+	// Fill a rectangle of length x height pixels with a solid colour
+	// or stipple pattern; the fill word is repeated every 8 pixels.
+	//
+	// A row drawn with 'pad' set starts and ends one pixel in, with
+	// the pattern moved one pixel to the right. If 'hatch' is set, pad
+	// is flipped on every row, cross-hatching any stippled pattern.
+	//
+	// The partly covered screen words at either end of a row are masked,
+	// so that the pixels beside the rectangle are left alone. Everything
+	// in between is written 16 pixels (a long word) at a time.
+	// MODE_PIXEL_OR merges the fill with what is already there, any other
+	// mode replaces it.
+	
+	unsigned short *p;				// Current word in screen buffer
+	unsigned long *l;				// Current long word in screen buffer
+	unsigned short row;				// Rows loop counter
+	unsigned short n;				// Words/long words loop counter
+	unsigned short start_p = 0;		// Address of the first word of the row
+	unsigned short end_p = 0;		// Address of the word just past the end of the row
+	unsigned char start_bits;		// Number of leading pixels in the first word which aren't filled
+	unsigned char end_bits;			// Number of pixels in the last word which are filled
+	unsigned short start_mask = 0;	// Pixels filled in the first word
+	unsigned short end_mask = 0;	// Pixels filled in the last word
+	unsigned short words = 0;		// Number of fully covered words in between
+	unsigned short pattern = fill;
+	unsigned long pattern_long;
+	unsigned char row_pad;
+	
+	row_pad = !pad;
+	for (row = 0; row < height; row++){
+		
+		// Work out the extent and pattern of the row whenever the padding changes
+		if (row_pad != pad){
+			row_pad = pad;
+			words = 0;
+			start_mask = 0;
+			end_mask = 0;
+			if (length > (2 * pad)){
+				draw_GetXY(x + pad, 0, &start_p, &start_bits);
+				draw_GetXY(x + length - pad, 0, &end_p, &end_bits);
+				start_mask = ((0xFF >> start_bits) << 8) + (0xFF >> start_bits);
+				end_mask = ~(((0xFF >> end_bits) << 8) + (0xFF >> end_bits));
+				if (start_p == end_p){
+					// Starts and ends within the same word
+					start_mask &= end_mask;
+					end_mask = 0;
+				} else if (start_bits == 0){
+					// First word is fully covered
+					start_mask = 0;
+					words = end_p - start_p;
+				} else {
+					words = end_p - start_p - 1;
+				}
+			}
+			if (pad){
+				// Rotate each byte of the pattern one pixel right
+				pattern = ((fill >> 1) & 0x7F7F) | ((fill << 7) & 0x8080);
+			} else {
+				pattern = fill;
+			}
+			pattern_long = ((unsigned long) pattern << 16) | pattern;
 		}
-	}
-	if (drawing_mask_hi){
-		if (pad){
-			drawing_mask += (drawing_mask_hi >> 1);
-		} else {
-			drawing_mask += drawing_mask_hi;
+		
+		p = (unsigned short*) screen->buf;
+		p += (y + row) * SCREEN_WORDS_PER_ROW + start_p;
+		
+		// Leading pixels
+		if (start_mask){
+			if (mode == MODE_PIXEL_OR){
+				*p |= pattern & start_mask;
+			} else {
+				*p = (*p & ~start_mask) | (pattern & start_mask);
+			}
+			p++;
 		}
-	}	
-	while (c < end_p){
-		//if (mode == MODE_PIXEL_OR){
-		//	*p = *p | drawing_mask;
-		//} else {
-			*p = drawing_mask;
-		//}
-		p++;
-		c++;
-	}
-	
-	// Draw trailing pixels if end_bits != 0
-	if (end_bits != 0){
-		end_mask = 0x0000;
-		if (drawing_mask_lo) end_mask = (drawing_mask_lo << (8 - end_bits)) << 8;
-		if (drawing_mask_hi) end_mask += (unsigned char) (drawing_mask_hi << (8 - end_bits));
+		
+		// Whole words
 		if (mode == MODE_PIXEL_OR){
-			*p = *p | end_mask;
+			for (n = words; n > 0; n--){
+				*p++ |= pattern;
+			}
 		} else {
-			*p = end_mask;
+			l = (unsigned long*) p;
+			for (n = words >> 1; n >= 8; n -= 8){
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+				*l++ = pattern_long;
+			}
+			for (; n > 0; n--){
+				*l++ = pattern_long;
+			}
+			p = (unsigned short*) l;
+			if (words & 1){
+				*p++ = pattern;
+			}
+		}
+		
+		// Trailing pixels
+		if (end_mask){
+			if (mode == MODE_PIXEL_OR){
+				*p |= pattern & end_mask;
+			} else {
+				*p = (*p & ~end_mask) | (pattern & end_mask);
+			}
+		}
+		
+		if (hatch){
+			pad = !pad;
 		}
 	}
 	
-	screen->dirty = 1;
+	draw_Dirty(screen, y, height);
 }
 
 void draw_VLine(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short fill, unsigned char mode){
@@ -525,7 +575,7 @@ void draw_VLine(Screen_t *screen, unsigned short x, unsigned short y, unsigned s
 		c++;
 	}
 	
-	screen->dirty = 1;
+	draw_Dirty(screen, y, length);
 }
 
 void draw_Box(Screen_t *screen, unsigned short x, unsigned short y, 
@@ -539,70 +589,39 @@ void draw_Box(Screen_t *screen, unsigned short x, unsigned short y,
 	// Stippled borders are also offset if > 1px in thickness.
 
 	unsigned short i;		// Loop counter
-	
-	unsigned short start_p;  // Start position in screen buffer
-	unsigned short end_p;    // End position in screen buffer
-	unsigned char start_bits;// Number of bits to skip
-	unsigned char end_bits;	  // Number of bits to skip
 	unsigned char pad = 0;
 	unsigned char enable_pad = 0;
 	
-	draw_GetXY(x, y, &start_p, &start_bits);
-	draw_GetXY(x + length, y, &end_p, &end_bits);
-	
 	// Fill
 	if (centrefill != PIXEL_CLEAR){
 		// Fill is:
 		// Horizontal: (x + borderpx) to ((x + length) - borderpx)
 		// Vertical: height - (2 * borderpx)
-		if (draw_IsStippled(centrefill)){
-			enable_pad = 1;
-		} else {
-			enable_pad = 0;
-		}
-		pad = 0;
-		for (i = 0; i < height - (2 * borderpx) + 1; i++){
-			draw_HLine(screen, x + borderpx, y + borderpx + i, length - (2 * borderpx), centrefill, pad, mode);
-			if (enable_pad){
-				if (pad == 1){
-					pad = 0;
-				} else {
-					pad = 1;
-				}
-			}
-		}
+		// The inside of the box is always painted over, whatever the mode
+		draw_Fill(screen, x + borderpx, y + borderpx, length - (2 * borderpx), height - (2 * borderpx) + 1, centrefill, 0, draw_IsStippled(centrefill), MODE_PIXEL_SET);
 	}
 	
 	// Borders
 	if (borderfill != PIXEL_CLEAR){
 		// Detect if we need to offset rows for cross-hatching effect
-		if (borderpx > 1){
-			if (draw_IsStippled(borderfill)){
-				enable_pad = 1;
-			} else {
-				enable_pad = 0;
-			}
+		if ((borderpx > 1) && draw_IsStippled(borderfill)){
+			enable_pad = 1;
 		}
-		pad = 0;
+		
+		// Top lines, then bottom lines; the bottom line of all is unpadded
+		draw_Fill(screen, x, y, length, borderpx, borderfill, 0, enable_pad, mode);
+		draw_Fill(screen, x, y + height - borderpx + 1, length, borderpx, borderfill, enable_pad ? ((borderpx - 1) & 1) : 0, enable_pad, mode);
+		
 		for (i = 0; i < borderpx; i++){
-			// Top line
-			draw_HLine(screen, x, y + i, length, borderfill, pad, mode);
+			if (enable_pad){
+				pad = i & 1;
+			}
 			// Left
 			draw_VLine(screen, x + i, y + borderpx - pad, height - (borderpx * 2) + 1 + pad, borderfill, MODE_PIXEL_OR);
 			// Right
 			draw_VLine(screen, x + (length - i) - 1, y + borderpx - pad, height - (borderpx * 2) + 1 + pad, borderfill, MODE_PIXEL_OR);
-			// Bottom
-			draw_HLine(screen, x, y + height - i, length, borderfill, pad, mode);
-			if (enable_pad){
-				if (pad == 1){
-					pad = 0;
-				} else {
-					pad = 1;
-				}
-			}
 		}
 	}
-	screen->dirty = 1;
 	return;
 }
 
@@ -681,6 +700,7 @@ void draw_StringInvert(Screen_t *screen, unsigned char col, unsigned char y, uns
 		p += start_p;
 		p += (font_row + 1) * SCREEN_WORDS_PER_ROW;;
 	}
+	draw_Dirty(screen, y - 1, fontdata->height + 1);
 }
 
 unsigned short draw_String(Screen_t *screen, unsigned char col, unsigned char y, unsigned char max_chars, unsigned char max_rows, unsigned short offset_chars, fontdata_t *fontdata, unsigned short fill, char *c, unsigned char mode){
@@ -690,6 +710,8 @@ unsigned short draw_String(Screen_t *screen, unsigned char col, unsigned char y,
 	//
 	// Embedded newlines (\n) are observed
 	// Word-wrapping is performed if the current word would run beyond the end of max_chars
+	// A TEXT_PAGE_BREAK (from text pre-wrapped by the data compiler) ends the page early,
+	// and pre-wrapped text that fits within max_chars is drawn without measuring it
 	//
 	// Returns 0 on success (all characters have been printed), or number of characters that 
 	// have been printed (and can be used as the offset into the string for the next call)
@@ -697,147 +719,305 @@ unsigned short draw_String(Screen_t *screen, unsigned char col, unsigned char y,
 	// Note: This only supports 8x8 fonts.
 	
 	unsigned short start_p;
-	unsigned short *p;
-	unsigned short mask;
-	unsigned short pos;
-	unsigned char i;
+	unsigned short pos = offset_chars;
+	unsigned short end;
+	unsigned short next;
 	unsigned short row_size = (8 * SCREEN_WORDS_PER_ROW);
 	unsigned short string_len = strlen(c);
-	
-	unsigned char current_rows = 0;
-	unsigned char current_chars = 0;
-	unsigned char skip = 0;
-	unsigned short original_fill = fill;
+	unsigned short line_fill = fill;
+	unsigned char current_rows;
+	unsigned char prewrapped;
 	
 	// Empty string
-	if (strlen(c) == 0){
+	if (string_len == 0){
 		return 0;
 	}
 	
+	// If we are resuming part way through, find out if it is within pre-wrapped text
+	prewrapped = draw_TextPrewrapped(c, pos, string_len, max_chars);
+	
 	// Calculate starting address
 	draw_GetStringXY(col, y, &start_p);
 	
-	// Reposition write position
-	p = (unsigned short*) screen->buf;
-	p += start_p;
+	// Find each line in turn and draw it, a line is only ever looked at once
+	for (current_rows = 0; (current_rows < max_rows) && (pos < string_len); current_rows++){
+		next = draw_TextLine(c, pos, string_len, max_chars, &end, NULL, fill, &prewrapped);
+		line_fill = draw_TextSpan(screen, start_p, c, pos, end, fontdata, line_fill, fill, mode);
+		start_p += row_size;
+		pos = next;
+		if ((end < string_len) && (c[end] == TEXT_PAGE_BREAK)){
+			current_rows++;
+			break;
+		}
+	}
 	
-	current_chars = 0;
-	current_rows = 1;
+	draw_Dirty(screen, y - 1, current_rows * 8);
+	if (pos < string_len){
+		// Ran out of rows, return the position to carry on from
+		return pos;
+	}
+	// All characters have been printed
+	return 0;	
+}
+
+unsigned short draw_TagFill(unsigned char tag, unsigned short fill, unsigned short original_fill){
+	// Return the colour to use after a colour tag such as <g>
+	
+	switch(tag){
+		case TEXT_TAG_GREEN:
+			return PIXEL_GREEN;
+		case TEXT_TAG_RED:
+			return PIXEL_RED;
+		case TEXT_TAG_WHITE:
+			return PIXEL_WHITE;
+		case TEXT_TAG_YELLOW:
+			// Not supported in 4 colour mode on QL
+			return fill;
+		case TEXT_TAG_BLUE:
+			// Not supported in 4 colour mode on QL
+			return fill;
+		case TEXT_TAG_COLOUR_CLEAR:
+			return original_fill;
+		default:
+			return fill;
+	}
+}
+
+unsigned char draw_TextPrewrapped(char *c, unsigned short pos, unsigned short string_len, unsigned char max_chars){
+	// Find out if position 'pos' of a string is within a block of pre-wrapped
+	// text whose lines are no wider than max_chars, by looking back for the
+	// nearest pre-wrap marker. Only needed when starting part way through.
+	
+	for (; pos > 0; pos--){
+		if (c[pos - 1] == TEXT_PREWRAP_END){
+			return 0;
+		}
+		if ((c[pos - 1] == TEXT_PREWRAP_START) && (pos < string_len)){
+			return ((unsigned char) c[pos] <= max_chars);
+		}
+	}
+	return 0;
+}
+
+unsigned short draw_TextLine(char *c, unsigned short pos, unsigned short string_len, unsigned char max_chars, unsigned short *end, unsigned short *fill, unsigned short original_fill, unsigned char *prewrapped){
+	// Find where the line of text starting at 'pos' ends, without drawing anything.
+	// This is a single pass; each character is looked at once, and words are
+	// never measured ahead of time. Instead, the last space is remembered and
+	// the line is broken there when the next character would not fit.
+	//
+	// Sets 'end' to just past the last character to be printed on this line, and
+	// returns the position that the following line starts at. Leading spaces, colour
+	// tags and pre-wrap markers take up no room. If 'fill' is given, it is updated by
+	// any colour tags, as they would be at the start of the following line.
+	//
+	// 'prewrapped' is set while inside a TEXT_PREWRAP_START/END block whose
+	// wrap width fits within max_chars. The data compiler has already broken
+	// those lines, so only a newline or page break can end one and nothing
+	// needs to be measured.
 	
-	for (pos = offset_chars; pos < string_len; pos++){
-		// If we started the loop after processing a tag, unset the skip variable
-		skip = 0;
-		// Next character
+	unsigned char i;
+	unsigned char width = 0;
+	unsigned short space = 0;
+	unsigned short space_fill = original_fill;
+	
+	for (; pos < string_len; pos++){
 		i = (unsigned char) c[pos];
-		// Is this the start of a new tag?
-		if (i == TEXT_TAG_START){
-			// Have we got at least 2 more characters before end of string?
-			if ((pos + 2) <= string_len){
-				// Is the character +2 from our current position a closing tag?
-				if (c[pos + 2] == TEXT_TAG_END){					
-					// Figure out the tag
-					switch(c[pos + 1]){
-						case TEXT_TAG_GREEN:
-							fill = PIXEL_GREEN;
-							break;
-						case TEXT_TAG_RED:
-							fill = PIXEL_RED;
-							break;
-						case TEXT_TAG_WHITE:
-							fill = PIXEL_WHITE;
-							break;
-						case TEXT_TAG_YELLOW:
-							// Not supported in 4 colour mode on QL
-							break;
-						case TEXT_TAG_BLUE:
-							// Not supported in 4 colour mode on QL
-							break;
-						case TEXT_TAG_COLOUR_CLEAR:
-							fill = original_fill;
-							break;
-						default:
-							break;
-					}
-					
-					// Increment loop pointer to skip past these 3 characters
-					pos += 2;
-					// Set skip variable, so we don't try and print anything
-					// and instead start the loop at the new character position 
-					// from above.
-					skip = 1;
+		if ((i == TEXT_TAG_START) && ((pos + 2) <= string_len) && (c[pos + 2] == TEXT_TAG_END)){
+			// Colour tag
+			if (fill != NULL){
+				*fill = draw_TagFill(c[pos + 1], *fill, original_fill);
+			}
+			pos += 2;
+		} else if (i == TEXT_PREWRAP_START){
+			// Use the text as-is if it was wrapped no wider than
+			// this line, then skip the wrap width
+			if ((pos + 1) < string_len){
+				*prewrapped = ((unsigned char) c[pos + 1] <= max_chars);
+			}
+			pos++;
+		} else if (i == TEXT_PREWRAP_END){
+			// Back to wrapping the text ourselves
+			*prewrapped = 0;
+		} else if ((i == 0x0A) || (i == 0x0D) || (i == TEXT_PAGE_BREAK)){
+			// Newline characters
+			*end = pos;
+			return pos + 1;
+		} else if (*prewrapped){
+			// Already known to fit on this line
+			width++;
+		} else if ((i == 0x20) && (width == 0)){
+			// If position 0 and a space, skip it
+		} else if (width < max_chars){
+			// Still room on this line
+			if (i == 0x20){
+				space = pos;
+				if (fill != NULL){
+					space_fill = *fill;
 				}
 			}
+			width++;
+		} else if (i == 0x20){
+			// Line is full, and conveniently ends on a space
+			*end = pos;
+			return pos + 1;
+		} else if (space){
+			// Line is full, so break it at the last space
+			*end = space;
+			if (fill != NULL){
+				*fill = space_fill;
+			}
+			return space + 1;
+		} else {
+			// A single word longer than the line, just split it
+			*end = pos;
+			return pos;
 		}
-		if (!skip){	
-			if ((current_chars == 0) && (i == 0x20)){
-				// If position 0 and a space, skip it
-				current_chars = 0;
-				
-			} else if ((i == 0x0A) || (i == 0x0D)){
-				// Newline characters
-				if (current_rows < max_rows){
-					// We have at least 1 more row of text left
-					p = (unsigned short*) screen->buf;
-					start_p += row_size; // Set a new start position to this new line
-					p += start_p;
-					current_chars = 0;
-					current_rows++;	
-				} else {
-					// We've exceeded number of allowed rows, return
-					// with the current position in the string.
-					screen->dirty = 1;
-					return pos;	
-				}
-			} else {
-			
-				if ((word_length(c, pos, string_len) + current_chars) <= max_chars){
-					// This character and the rest of word up to the next space or 
-					// newline CAN fit on current row
-					
-					// Find the bitmap for this character in the font table
-					draw_FontSymbol(i, fontdata, fill, p, mode);
-					p = (unsigned short*) screen->buf;
-					current_chars++;
-					p += start_p + current_chars;
-				} else {
-					// This character and the rest of word up to the next space or 
-					// newline CANNOT fit on current row
-					
-					if (current_rows < max_rows){
-						// We have at least 1 more row of text left
-						p = (unsigned short*) screen->buf;
-						start_p += row_size; // Set a new start position to this new line
-						p += start_p;
-						current_rows++;			
-						
-						if (i != 0x20){
-							// Find the bitmap for this character in the font table
-							draw_FontSymbol(i, fontdata, fill, p, mode);
-							p = (unsigned short*) screen->buf;
-							current_chars = 1;
-							p += start_p + current_chars;
-						} else {
-							// Don't print a leading space if it is the first
-							// character on a line. Just skip to next character.
-							// This 'left justifies' the text.
-							p = (unsigned short*) screen->buf;
-							current_chars = 0;
-							p += start_p + current_chars;
-						}
-					} else {
-						
-						// We've exceeded number of allowed rows, return
-						// with the current position in the string.
-						screen->dirty = 1;
-						return pos;	
-					}
-				}
+	}
+	*end = pos;
+	return pos;
+}
+
+unsigned short draw_TextSpan(Screen_t *screen, unsigned short start_p, char *c, unsigned short pos, unsigned short end, fontdata_t *fontdata, unsigned short fill, unsigned short original_fill, unsigned char mode){
+	// Draw a single line of text, as found by draw_TextLine(), starting at
+	// screen word 'start_p'. Returns the colour in effect at the end of the line.
+	
+	unsigned short *p;
+	unsigned char i;
+	unsigned char current_chars = 0;
+	
+	p = (unsigned short*) screen->buf;
+	p += start_p;
+	for (; pos < end; pos++){
+		i = (unsigned char) c[pos];
+		if ((i == TEXT_TAG_START) && ((pos + 2) < end) && (c[pos + 2] == TEXT_TAG_END)){
+			fill = draw_TagFill(c[pos + 1], fill, original_fill);
+			pos += 2;
+		} else if (i == TEXT_PREWRAP_START){
+			pos++;
+		} else if (i == TEXT_PREWRAP_END){
+			// Nothing to print
+		} else if ((i == 0x20) && (current_chars == 0)){
+			// Don't print a leading space, this 'left justifies' the text.
+		} else {
+			// Find the bitmap for this character in the font table
+			draw_FontSymbol(i, fontdata, fill, p, mode);
+			p++;
+			current_chars++;
+		}
+	}
+	return fill;
+}
+
+void draw_TextLayout(TextLayout_t *layout, char *c, unsigned short offset_chars, unsigned char max_chars, unsigned char max_rows, unsigned short fill){
+	// Split a block of text into lines and pages, in a single pass over the text.
+	// Any page can then be drawn by draw_TextLayoutPage(), in any order and
+	// as often as needed, without having to find the line breaks again.
+	//
+	// Text with more lines or pages than a layout can hold is laid out up to the
+	// end of the last whole page that fits, and layout->more is set to where the
+	// rest starts. Calling this again with that as 'offset_chars' lays out the
+	// next part of the text, in the colour that was in effect at that point.
+	
+	unsigned short pos = offset_chars;
+	unsigned short end;
+	unsigned short string_len = strlen(c);
+	unsigned short line_fill = fill;
+	unsigned char current_rows = 0;
+	unsigned char prewrapped;
+	
+	if (offset_chars > 0){
+		line_fill = layout->more_fill;
+	}
+	prewrapped = draw_TextPrewrapped(c, pos, string_len, max_chars);
+	
+	layout->text = c;
+	layout->lines = 0;
+	layout->pages = 0;
+	layout->more = 0;
+	
+	while (pos < string_len){
+		if (current_rows == 0){
+			// First line of a new page
+			if (layout->pages == TEXT_LAYOUT_MAX_PAGES){
+				layout->more = pos;
+				layout->more_fill = line_fill;
+				break;
+			}
+			layout->page_line[layout->pages] = layout->lines;
+			layout->page_fill[layout->pages] = line_fill;
+			layout->pages++;
+		}
+		if (layout->lines == TEXT_LAYOUT_MAX_LINES){
+			// Out of lines part way through a page, so leave
+			// that whole page for the next part of the layout
+			if (layout->pages > 1){
+				layout->pages--;
+				layout->lines = layout->page_line[layout->pages];
+				pos = layout->line_start[layout->lines];
+				line_fill = layout->page_fill[layout->pages];
+			}
+			layout->more = pos;
+			layout->more_fill = line_fill;
+			break;
+		}
+		layout->line_start[layout->lines] = pos;
+		pos = draw_TextLine(c, pos, string_len, max_chars, &end, &line_fill, fill, &prewrapped);
+		layout->line_end[layout->lines] = end;
+		layout->lines++;
+		current_rows++;
+		if ((current_rows == max_rows) || ((end < string_len) && (c[end] == TEXT_PAGE_BREAK))){
+			current_rows = 0;
+		}
+	}
+	layout->page_line[layout->pages] = layout->lines;
+}
+
+void draw_TextLayoutPage(Screen_t *screen, TextLayout_t *layout, unsigned char page, unsigned char col, unsigned char y, fontdata_t *fontdata, unsigned short fill, unsigned char mode){
+	// Draw a single page of a block of text which was split up by draw_TextLayout()
+	
+	unsigned short start_p;
+	unsigned short row_size = (8 * SCREEN_WORDS_PER_ROW);
+	unsigned short line_fill;
+	unsigned char line;
+	
+	if (page >= layout->pages){
+		return;
+	}
+	
+	draw_GetStringXY(col, y, &start_p);
+	line_fill = layout->page_fill[page];
+	for (line = layout->page_line[page]; line < layout->page_line[page + 1]; line++){
+		line_fill = draw_TextSpan(screen, start_p, layout->text, layout->line_start[line], layout->line_end[line], fontdata, line_fill, fill, mode);
+		start_p += row_size;
+	}
+	draw_Dirty(screen, y - 1, (layout->page_line[page + 1] - layout->page_line[page]) * 8);
+}
+
+void draw_ExpandFont(fontdata_t *fontdata){
+	// Turn every row of every 1bpp font symbol into the 16bit screen word
+	// which draws it in each of the text colours, so that drawing a character
+	// needs no masking at all.
+	
+	unsigned short fills[BMP_FONT_COLOURS] = { PIXEL_WHITE, PIXEL_GREEN, PIXEL_RED, PIXEL_YELLOW };
+	unsigned short *glyph;
+	unsigned char colour;
+	unsigned char font_symbol;
+	unsigned char font_row;
+	unsigned char bits;
+	
+	fontdata->glyph = (unsigned short *) arena_Alloc(BMP_FONT_GLYPH_BYTES);
+	if (fontdata->glyph == NULL){
+		return;
+	}
+	glyph = fontdata->glyph;
+	for (colour = 0; colour < BMP_FONT_COLOURS; colour++){
+		for (font_symbol = 0; font_symbol < BMP_MAX_SYMBOLS; font_symbol++){
+			for (font_row = 0; font_row < BMP_FONT_MAX_HEIGHT; font_row++){
+				bits = fontdata->symbol[font_symbol][font_row];
+				*glyph++ = ((bits << 8) + bits) & fills[colour];
 			}
 		}
 	}
-	// All characters have been printed
-	screen->dirty = 1;
-	return 0;	
 }
 
 void draw_FontSymbol(unsigned char ascii_num, fontdata_t *fontdata, unsigned short fill, unsigned short *pos, unsigned char mode){
@@ -845,13 +1025,73 @@ void draw_FontSymbol(unsigned char ascii_num, fontdata_t *fontdata, unsigned sho
 	
 	unsigned char font_row;
 	unsigned char font_symbol;
+	unsigned char colour;
 	unsigned short mask;
+	unsigned short *glyph;
 	
 	if ((ascii_num >= fontdata->ascii_start) && (ascii_num < (fontdata->ascii_start + fontdata->n_symbols))){
 		font_symbol = ascii_num - fontdata->ascii_start;
 	} else {
 		font_symbol = fontdata->unknown_symbol;
 	}
+	
+	// Use the pre-expanded copy of the symbol, if there is one in this colour
+	if (fontdata->glyph != NULL){
+		switch(fill){
+			case PIXEL_BLACK:
+				// Drawn as white, the same as below
+			case PIXEL_WHITE:
+				colour = BMP_FONT_WHITE;
+				break;
+			case PIXEL_GREEN:
+				colour = BMP_FONT_GREEN;
+				break;
+			case PIXEL_RED:
+				colour = BMP_FONT_RED;
+				break;
+			case PIXEL_YELLOW:
+				colour = BMP_FONT_YELLOW;
+				break;
+			default:
+				colour = BMP_FONT_COLOURS;
+				break;
+		}
+		if (colour < BMP_FONT_COLOURS){
+			glyph = fontdata->glyph + (((colour * BMP_MAX_SYMBOLS) + font_symbol) * BMP_FONT_MAX_HEIGHT);
+			if ((mode == MODE_PIXEL_SET) && (fontdata->height == 8)){
+				// By far the most common case, just 8 word stores
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph++; pos += SCREEN_WORDS_PER_ROW;
+				*pos = *glyph;
+				return;
+			}
+			for(font_row = 0; font_row < fontdata->height; font_row++){
+				switch(mode){
+					case MODE_PIXEL_SET:
+						*pos = *glyph;
+						break;
+					case MODE_PIXEL_XOR:
+						*pos = *pos ^ *glyph;
+						break;
+					case MODE_PIXEL_AND:
+						*pos = *pos & *glyph;
+						break;
+					default:
+						*pos = *pos | *glyph;
+						break;
+				}
+				glyph++;
+				pos += SCREEN_WORDS_PER_ROW;
+			}
+			return;
+		}
+	}
+	
 	for(font_row = 0; font_row < fontdata->height; font_row++){
 		switch(fill){
 			case PIXEL_BLACK:
@@ -866,6 +1106,10 @@ void draw_FontSymbol(unsigned char ascii_num, fontdata_t *fontdata, unsigned sho
 			case PIXEL_GREEN:
 				mask = (unsigned short) (fontdata->symbol[font_symbol][font_row] << 8);
 				break;	
+			default:
+				// Stippled colours
+				mask = ((fontdata->symbol[font_symbol][font_row] << 8) + fontdata->symbol[font_symbol][font_row]) & fill;
+				break;
 		}
 		
 		// All other font get or-ed against background
@@ -890,311 +1134,210 @@ void draw_FontSymbol(unsigned char ascii_num, fontdata_t *fontdata, unsigned sho
 	}
 }
 
-/*
-int draw_BitmapAsync(Screen_t *screen, int bmpfile){
-	// Load from file, decode and display, line by line
-	// Every time the function is called, another line is read, decoded and displayed
-	
-	int	status;					// Status returned from fread/fseek
-	unsigned int i = 0;			// Outer loop counter
-	unsigned int ii = 0;		// Inner loop counter
-	unsigned short start_addr;	// The first pixel
-	unsigned short end_addr;	// The last pixel
+int draw_Image(Screen_t *screen, unsigned short x, unsigned short y, char *filename){
+	// Display a native QL screen format image, as written by the data compiler.
+	// The pixels are already stored as screen words, so each row is read
+	// straight into the screen buffer with no decoding; x must be on an 8
+	// pixel boundary.
+	
+	int f;
+	int status;
+	unsigned short row;
+	unsigned short row_bytes;	// Bytes in each row of the image
 	unsigned short *p;
-	unsigned short mask = 0;
-	unsigned short c, row_pos = 0;
-	unsigned short i_start = 0;
-	unsigned short i_end = 0;
-	unsigned short last_word = 0;
-	unsigned char bmp_pixel = 0;
-	unsigned char pixel_left = 0;	// left byte of a 16bit QL pixel
-	unsigned char pixel_right = 0;	// right byte of a 16bit QL pixel
-	unsigned char nibble1 = 0;		// Half a byte - a single pixel in 4bpp mode
-	unsigned char nibble2 = 0;		// Half a byte - a single pixel in 4bpp mode
-	unsigned char pix_pos = 0;
-	unsigned char start_bits = 0;
-	unsigned char end_bits = 0;
-	unsigned char remain_bits = 0;	
-	
-	// Only supporting 1bpp and 4bpp (first four colours) mode BMP on the QL
-	if ((screen->bmp->bpp != BMP_1BPP) && (screen->bmp->bpp != BMP_4BPP)){
-		//printf("Async bpp error\n");
-		return BMP_ERR_BPP;
+	ScrHeader_t header;
+	
+	f = open(filename, O_RDONLY);
+	if (f < 0){
+		return DRAW_OPEN_BMPFILE;
 	}
-
-	// BMP header has not been read yet
-	if (screen->bmp->offset <= 0){
-		//printf("Async header not read error\n");
-		return BMP_ERR_READ;
+	
+	status = read(f, &header, SCR_HEADER_SIZE);
+	if ((status < SCR_HEADER_SIZE) || ((header.signature != SCR_SIGNATURE) && (header.signature != SCR_SIGNATURE_LZ)) || ((header.width % 8) != 0) || ((x % 8) != 0)){
+		close(f);
+		return DRAW_IMAGE_HEADER;
+	}
+	if (((x + header.width) > SCREEN_WIDTH) || ((y + header.height) > SCREEN_HEIGHT)){
+		close(f);
+		return BMP_ERR_SIZE;
 	}
 	
-	if (screen->bmpstate->rows_remaining == screen->bmp->height){
-		//printf("Async seek to: %u in %u\n", bmpdata->offset, bmpfile);
-		// This is a new image, or we haven't read a row yet			
-		// Seek to start of data section in file
-		status = lseek(bmpfile, screen->bmp->offset, SEEK_SET);
-		if (status != screen->bmp->offset){
-			screen->bmpstate->width_bytes = 0;	// not used in 1bpp/4bpp mode
-			screen->bmpstate->rows_remaining = 0;
-			//printf("Async error seeking data\n");
+	row_bytes = header.width / SCREEN_PIXELS_PER_BYTE * 2;
+	p = (unsigned short*) screen->buf;
+	p += (x / 8) + (y * SCREEN_WORDS_PER_ROW);
+	
+	if (header.signature == SCR_SIGNATURE_LZ){
+		status = draw_ImageUnpack(f, p, row_bytes, header.height);
+	} else if (header.width == SCREEN_WIDTH){
+		// Full width rows follow on from each other in screen memory, so read them all at once
+		status = read(f, p, row_bytes * header.height);
+		if (status < (row_bytes * header.height)){
+			status = BMP_ERR_READ;
+		}
+	} else {
+		for (row = 0; row < header.height; row++){
+			status = read(f, p, row_bytes);
+			if (status < row_bytes){
+				status = BMP_ERR_READ;
+				break;
+			}
+			p += SCREEN_WORDS_PER_ROW;
+		}
+	}
+	close(f);
+	
+	draw_Dirty(screen, y, header.height);
+	if (status == BMP_ERR_READ){
+		return BMP_ERR_READ;
+	}
+	return BMP_OK;
+}
+
+int draw_ImageUnpack(int f, unsigned short *p, unsigned short row_bytes, unsigned short rows){
+	// Unpack LZ compressed image rows from the file straight into screen
+	// memory at p. Copies refer back to bytes which have already been
+	// unpacked onto the screen, so they are read back from there.
+	// Returns BMP_OK, or BMP_ERR_READ if the data is short or corrupt.
+	
+	unsigned char *row = (unsigned char*) p;	// Start of the screen row being unpacked
+	unsigned char *from_row;					// Start of the screen row being copied from
+	unsigned short col = 0;						// Position in the row being unpacked
+	unsigned short from_col;					// Position in the row being copied from
+	unsigned short pos = 0;						// Bytes unpacked so far
+	unsigned short from;						// Position in the unpacked bytes being copied from
+	unsigned short size;						// Total number of bytes to unpack
+	unsigned short n;							// Bytes left in this literal run or copy
+	unsigned short chunk;
+	int token;
+	int hi;
+	int lo;
+	
+	size = row_bytes * rows;
+	draw_unpack_pos = 0;
+	draw_unpack_len = 0;
+	
+	while (pos < size){
+		token = draw_UnpackByte(f);
+		if (token < 0){
 			return BMP_ERR_READ;
 		}
-	}	
-	
-	// Read a row of pixels
-	if (screen->bmp->bpp == BMP_4BPP){
-		while(i < screen->bmp->row_unpadded){
-			pixel_left = 0;
-			pixel_right = 0;
-			pix_pos = 7;		// Working on bit position 0 (and 1) of the on-screen pixel
-			// Read 4 bytes from image == 8x 4bpp pixels == 1x 16bit QL screen location
-			for (ii = 0; ii < 4; ii++){
-				
-				status = read(bmpfile, &bmp_pixel, 1);
-				if (status < 1){
-					//printf("Async error reading data\n");
-					screen->bmpstate->width_bytes = 0; // not used in 1bpp/4bpp mode
-					screen->bmpstate->rows_remaining = 0;
+		if (token < 0x80){
+			// Literal bytes
+			n = token + 1;
+			if ((pos + n) > size){
+				return BMP_ERR_READ;
+			}
+			pos += n;
+			while (n > 0){
+				// Copy as much as we can in one go; up to the end of the
+				// literals, the end of the read buffer or the end of the row
+				if ((draw_unpack_pos == draw_unpack_len) && (draw_UnpackFill(f) < 0)){
 					return BMP_ERR_READ;
 				}
-				nibble1 = bmp_pixel >> 4; 		// Get pixel 1 from the byte
-				nibble2 = bmp_pixel & 0x0f;		// Get pixel 2 from the byte
-				switch(nibble1){
-					case 0:
-						// Colour 1 aka Black
-						clearbit(pixel_left, pix_pos);
-						clearbit(pixel_right, pix_pos);
-						break;
-					case 1:
-						// Colour 2 aka Green
-						setbit(pixel_left, pix_pos);
-						clearbit(pixel_right, pix_pos);
-						break;
-					case 2:
-						// Colour 3 aka Red
-						clearbit(pixel_left, pix_pos);
-						setbit(pixel_right, pix_pos);
-						break;
-					case 3:
-						// Colour 3 aka White
-						setbit(pixel_left, pix_pos);
-						setbit(pixel_right, pix_pos);
-						break;
-					default:
-						clearbit(pixel_left, pix_pos);
-						clearbit(pixel_right, pix_pos);
-						break;
+				chunk = n;
+				if (chunk > (draw_unpack_len - draw_unpack_pos)){
+					chunk = draw_unpack_len - draw_unpack_pos;
 				}
-				switch(nibble2){
-					case 0:
-						// Colour 1 aka Black
-						clearbit(pixel_left, pix_pos - 1);
-						clearbit(pixel_right, pix_pos - 1);
-						break;
-					case 1:
-						// Colour 2 aka Green
-						setbit(pixel_left, pix_pos - 1);
-						clearbit(pixel_right, pix_pos - 1);
-						break;
-					case 2:
-						// Colour 3 aka Red
-						clearbit(pixel_left, pix_pos - 1);
-						setbit(pixel_right, pix_pos - 1);
-						break;
-					case 3:
-						// Colour 3 aka White
-						setbit(pixel_left, pix_pos - 1);
-						setbit(pixel_right, pix_pos - 1);
-						break;
-					default:
-						clearbit(pixel_left, pix_pos - 1);
-						clearbit(pixel_right, pix_pos - 1);
-						break;
+				if (chunk > (row_bytes - col)){
+					chunk = row_bytes - col;
+				}
+				memcpy(row + col, draw_unpack_buffer + draw_unpack_pos, chunk);
+				draw_unpack_pos += chunk;
+				col += chunk;
+				if (col == row_bytes){
+					row += SCREEN_WORDS_PER_ROW * 2;
+					col = 0;
 				}
-				// Next time around, we work on the next two bit positions of the on-screen pixel
-				pix_pos = pix_pos - 2;
+				n -= chunk;
 			}
-			// Store this decoded word / block of 8 pixels
-			screen->bmpstate->pixels[row_pos] = (pixel_left << 8) + pixel_right;
-			row_pos++;
-			i = i + 4;
-		}
-	} else {
-		return BMP_ERR_BPP;	
-	}
-
-	if (status != screen->bmp->row_unpadded){
-		// Seek the number of bytes left in this row
-		if ((screen->bmp->row_padded - screen->bmp->row_unpadded) != 0){
-			status = lseek(bmpfile, (screen->bmp->row_padded - screen->bmp->row_unpadded), SEEK_CUR);
-			if (status != (screen->bmp->row_padded - screen->bmp->row_unpadded)){
-				screen->bmpstate->width_bytes = 0;
-				screen->bmpstate->rows_remaining = 0;
-				//printf("Async error seeking padding bytes (wanted: %u, got %u)\n", (bmpdata->row_padded - bmpdata->row_unpadded), status);
+		} else {
+			// Copy of earlier bytes
+			n = token - 0x80 + LZ_MIN_MATCH;
+			hi = draw_UnpackByte(f);
+			lo = draw_UnpackByte(f);
+			if ((hi < 0) || (lo < 0)){
 				return BMP_ERR_READ;
 			}
-		}
-	} else {
-		// Seek to end of row
-		if (screen->bmp->row_padded != screen->bmp->row_unpadded){
-			lseek(bmpfile, (screen->bmp->row_padded - screen->bmp->row_unpadded), SEEK_CUR);
+			from = (hi << 8) + lo;
+			if ((from == 0) || (from > pos) || ((pos + n) > size)){
+				return BMP_ERR_READ;
+			}
+			from = pos - from;
+			from_row = (unsigned char*) p;
+			from_row += (from / row_bytes) * (SCREEN_WORDS_PER_ROW * 2);
+			from_col = from % row_bytes;
+			pos += n;
+			while (n > 0){
+				row[col++] = from_row[from_col++];
+				if (col == row_bytes){
+					row += SCREEN_WORDS_PER_ROW * 2;
+					col = 0;
+				}
+				if (from_col == row_bytes){
+					from_row += SCREEN_WORDS_PER_ROW * 2;
+					from_col = 0;
+				}
+				n--;
+			}
 		}
 	}
+	return BMP_OK;
+}
+
+int draw_UnpackFill(int f){
+	// Read the next block of compressed data into the buffer
+	// Returns the number of bytes read, or -1 at the end of the file
 	
-	// Get coordinates
-	draw_GetXY(screen->bmpstate->x, screen->bmpstate->y + screen->bmpstate->rows_remaining - 1, &start_addr, &start_bits);
-	draw_GetXY(screen->bmpstate->x + screen->bmp->width, screen->bmpstate->y + screen->bmpstate->rows_remaining, &end_addr, &end_bits);
-	remain_bits = 8 - start_bits;
-	
-	// Reposition screen write position for current x/y position
-	p = (unsigned short*) screen->buf;
-	p += start_addr;
-	last_word = (screen->bmp->width / 8);
+	int status;
 	
-	// Write any starting pixels if not on a 8 pixel boundary
-	if (start_bits != 0){
-		
-		pixel_left = (unsigned char)((screen->bmpstate->pixels[0] & 0xff00) >> 8) >> start_bits;
-		pixel_right = (unsigned char)(screen->bmpstate->pixels[0] & 0x00ff) >> start_bits;
-		mask = (pixel_left << 8) + pixel_right;
-		
-		// OR with any existing leading bits; safest
-		*p = *p | mask;
-		
-		// Move on pointer to next screen word
-		p++;
-		
-		// Save a copy of the current 8 pixels (including those we masked off)
-		mask = screen->bmpstate->pixels[0];
-		
-		// Start 1 word into the pixel array
-		i_start = 1;
-	}
-	// Construct the mask for the last word if it doesn't end on a 8 pixel boundary
-	if (end_bits != 0){
-		i_end = 1;
-	}
-	
-	// Starting from +1 (if we are not on an 8 pixel boundary)
-	// Construct each 8 pixel block in turn, using the masked-off
-	// bits of the previous 8 pixels, if necessary.
-	// Copy to screen/buffer
-	// Increment screen/buffer word pointer
-	for(i = i_start; i < (last_word); i++){
-		
-		if (i_start){
-			// This is tricky if we are not on an 8 pixel boundary....
-			
-			// Use the last pixels we masked off from the previous word
-			pixel_left = (unsigned char)((mask & 0xff00) >> 8) << remain_bits;
-			pixel_right = (unsigned char)(mask & 0x00ff) << remain_bits;
-			
-			// Add on the first pixels from the current word
-			pixel_left += (unsigned char)((screen->bmpstate->pixels[i] & 0xff00) >> 8) >> start_bits;
-			pixel_right += (unsigned char)(screen->bmpstate->pixels[i] & 0x00ff) >> start_bits;
-			
-			*p = (unsigned short)(pixel_left << 8) + pixel_right;
-			
-			// Store the current word for the next pass
-			mask = screen->bmpstate->pixels[i];
-			
-		} else {
-			// On a 8 pixel boundary, just copy the next block of 8 pixels
-			*p = screen->bmpstate->pixels[i];
-		}
-		p++;
-		
-		
+	status = read(f, draw_unpack_buffer, LZ_BUFFER_SIZE);
+	if (status <= 0){
+		return -1;
 	}
-	
-	// If we have any end bits, set the last 8 pixels
-	if (i_end){
-		
-		// Use the last pixels we masked off from the previous word
-		pixel_left = (unsigned char)((mask & 0xff00) >> 8) << remain_bits;
-		pixel_right = (unsigned char)(mask & 0x00ff) << remain_bits;
+	draw_unpack_len = status;
+	draw_unpack_pos = 0;
+	return status;
+}
 
-		// OR with any existing trailing bits; safest
-		*p = *p | (unsigned short)(pixel_left << 8) + pixel_right;
-	}
+int draw_UnpackByte(int f){
+	// Return the next byte of compressed data, or -1 at the end of the file
 	
-	// Decrement number of rows left
-	if (screen->bmpstate->rows_remaining == 1){
-		screen->bmpstate->rows_remaining = 0;
-	} else {
-		screen->bmpstate->rows_remaining--;	
+	if ((draw_unpack_pos == draw_unpack_len) && (draw_UnpackFill(f) < 0)){
+		return -1;
 	}
-	
-	return BMP_OK;
-	
+	return draw_unpack_buffer[draw_unpack_pos++];
 }
 
-int draw_BitmapAsyncFull(Screen_t *screen, unsigned short x, unsigned short y, char *filename){
-	// Display a bitmap using the async call, in its entirety, using no-more than 1 line
-	// worth of allocated memory
-	
-	int f;
-	short status;
-	
-	f = open(filename, O_RDONLY);
-	if (f < 0){
-		ui_DrawError(screen, GENERIC_FILE_MSG, SCREEN_ASYNCBMP_FILE, 0);
-		return DRAW_OPEN_BMPFILE;
+int draw_Background(Screen_t *screen, unsigned short location_id){
+	// Display the background image of a location. Only called for locations
+	// whose map record says they have one, so a missing file is an error too.
+	// Returns BMP_OK once it is drawn.
+	
+	char filename[16];
+	int status;
+	
+	sprintf(filename, BACKGROUND_SCR, location_id);
+	status = draw_Image(screen, DRAW_BG_X, DRAW_BG_Y, filename);
+	if (status != BMP_OK){
+		ui_DrawError(screen, SCREEN_IMAGE_MSG, SCREEN_IMAGE_READ, status);
 	}
-	
-	// Read image header
-	bmp_Init(screen->bmp);
-	status = bmp_ReadImage(f, screen->bmp, 1, 0); 
-	if (status != 0){
-		ui_DrawError(screen, SCREEN_ASYNCBMP_MSG, SCREEN_ASYNCBMP_HEADER, status);
-		close(f);
-		return status;
-	} else {
-		//strncpy(screen->bmp->filename, filename, BMP_FILENAME_LEN);
-		// Set rows remaining based on height set in header
-		bmp_InitState(screen->bmpstate);
-		screen->bmpstate->rows_remaining = screen->bmp->height;
-		screen->bmpstate->x = x;
-		screen->bmpstate->y = y;
-		
-		//bmp_Print(screen->bmp);
-		//bmp_PrintState(screen->bmpstate);
-		
-		// Loop until all rows processed
-		while (screen->bmpstate->rows_remaining > 0){
-			status = draw_BitmapAsync(screen, f);
-			if (status != BMP_OK){
-				ui_DrawError(screen, SCREEN_ASYNCBMP_MSG, SCREEN_ASYNCBMP_DISPLAY, status);
-				close(f);
-				return status;	
-			}
-		}
-	}
-	close(f);
-	screen->dirty = 1;
 	return status;
 }
-*/
 
 int draw_Sprite(Screen_t *screen, unsigned short x, unsigned short y, ssprite_t *sprite, unsigned char portrait){
 	// Display a normal (non-boss) sprite on screen at the given coordinates
 	
 	unsigned short *p;				// Pointer to the current position in screen memory
 	unsigned short start_addr = 0;	// The screen address of the first (top left) pixel
-	unsigned short end_addr = 0;	// The screen address of the last (bottom right) pixel
 	unsigned short i = 0; 			// Outer (rows) loop counter
-	unsigned short ii = 0; 			// Inner (screen words) loop counter
-	unsigned short mask = 0;
-	unsigned char pixel_left = 0;	// left byte of a 16bit QL pixel
-	unsigned char pixel_right = 0;	// right byte of a 16bit QL pixel
+	unsigned char ii = 0; 			// Inner (screen words) loop counter
+	unsigned short edge = 0;		// Pixels of the first screen word which belong to the sprite
 	unsigned char start_bits = 0;	// Number of leading pixels we skip if not on an 8 pixel boundary
-	unsigned char end_bits = 0;		// Number of trailing pixels we skip if not on an 8 pixel boundary
-	unsigned char remain_bits = 0;	// Number of leading pixels we display, if not on an 8 pixel boundary
-	unsigned char last_word = 0;	// The number of screen words we write in any single row of pixels
-	unsigned char i_start = 0;
-	unsigned char i_end = 0;
-	unsigned char i_start_pos = 0;
+	unsigned char last_word = 0;	// The number of screen words in any single row of sprite pixels
 	unsigned short *pixels;			// Pointer to either the sprite->portrait or sprite->pixels data
+	unsigned short *shifted;		// Pre-shifted copy of the pixels, if not on an 8 pixel boundary
+	unsigned short *row;			// The pixels for the current row
+	unsigned short row_buffer[(BMP_WIDTH_MAX / 8) + 1];
 	
 	if (portrait){
 		pixels = (unsigned short*) sprite->portrait;
@@ -1202,114 +1345,153 @@ int draw_Sprite(Screen_t *screen, unsigned short x, unsigned short y, ssprite_t
 		pixels = (unsigned short*) sprite->pixels;	
 	}
 	
-	//printf("%d x %d @ %d,%d\n", sprite->width, sprite->height, x, y);
-	
 	// Get coordinates
 	draw_GetXY(x, y, &start_addr, &start_bits);
-	draw_GetXY(x + sprite->width, y + sprite->height, &end_addr, &end_bits);
-	
-	// How many pixels we have can display at position x (!=8 if we are not directly on an 8 pixel screen boundary)
-	remain_bits = 8 - start_bits;
 	
 	// Reposition screen write position for current x/y position
 	p = (unsigned short*) screen->buf;
 	p += start_addr;
 	
-	// The number of screen words we write in any row
+	// The number of screen words in any row of the sprite
 	last_word = sprite->width / 8;
 	
-	// For every row of pixels in the sprite....
-	for(i = 0; i < sprite->height; i++){
-				
-		// Write any starting pixels if not on a 8 pixel boundary
-		if (start_bits != 0){
-						
-			//pixel_left = (unsigned char)((sprite->pixels[i * last_word] & 0xff00) >> 8) >> start_bits;
-			//pixel_right = (unsigned char)(sprite->pixels[i * last_word] & 0x00ff) >> start_bits;
-			pixel_left = (unsigned char)((pixels[i * last_word] & 0xff00) >> 8) >> start_bits;
-			pixel_right = (unsigned char)(pixels[i * last_word] & 0x00ff) >> start_bits;
-			mask = (pixel_left << 8) + pixel_right;
-			
-			// OR with any existing leading bits; safest
-			*p = *p | mask;
-			
-			// Move on pointer to next screen location
-			p++;
-			
-			// Save a copy of the current 8 pixels (including those we masked off)
-			// So that we can use them in the main inner loop
-			//mask = sprite->pixels[i * last_word];
-			mask = pixels[i * last_word];
-			
-			// The main inner loop now needs to start 1 word into the pixel array
-			i_start = (i * last_word) + 1;
-			i_start_pos = 1;
-		} else {
-			i_start = i * last_word;
-			i_start_pos = 0;
+	if (start_bits == 0){
+		// On an 8 pixel boundary, just copy each row
+		for(i = 0; i < sprite->height; i++){
+			memcpy(p, pixels, last_word * 2);
+			pixels += last_word;
+			p += SCREEN_WORDS_PER_ROW;
 		}
+	} else {
+		// Not on an 8 pixel boundary; each row covers one extra screen word.
+		// The first and last words are shared with whatever is already on
+		// screen either side of the sprite, so only their sprite pixels are replaced.
+		edge = ((0xFF >> start_bits) << 8) + (0xFF >> start_bits);
 		
-		// Construct the mask for the last word if it doesn't end on a 8 pixel boundary
-		if (end_bits != 0){
-			i_end = 1;
-		} else {
-			i_end = 0;	
+		// Use the pre-shifted copy, or if there isn't the memory
+		// for one, shift each row as we go
+		shifted = draw_SpriteShift(pixels, sprite->width, sprite->height, start_bits);
+		row = shifted;
+		if (shifted == NULL){
+			row = row_buffer;
 		}
-				
-		// Starting from +1 (if we are not on an 8 pixel boundary)
-		// Construct each 8 pixel block in turn, using the masked-off
-		// bits of the previous 8 pixels, if necessary.
-		// Copy to screen/buffer
-		// Increment screen/buffer word pointer
 		
-		// For every screen word (8 pixels) on this row
-		
-		for(ii = i_start; ii < (i_start + last_word - 1); ii++){
-			if (i_start_pos){
-				// This is tricky if we are not on an 8 pixel boundary....
-				
-				// Use the last pixels we masked off from the previous word
-				pixel_left = (unsigned char)((mask & 0xff00) >> 8) << remain_bits;
-				pixel_right = (unsigned char)(mask & 0x00ff) << remain_bits;
-				
-				// Add on the first pixels from the current word
-				//pixel_left += (unsigned char)((sprite->pixels[ii] & 0xff00) >> 8) >> start_bits;
-				//pixel_right += (unsigned char)(sprite->pixels[ii] & 0x00ff) >> start_bits;
-				pixel_left += (unsigned char)((pixels[ii] & 0xff00) >> 8) >> start_bits;
-				pixel_right += (unsigned char)(pixels[ii] & 0x00ff) >> start_bits;
-				
-				*p = (unsigned short)(pixel_left << 8) + pixel_right;
-				
-				// Store the current word for the next pass
-				//mask = sprite->pixels[ii];
-				mask = pixels[ii];
-				
-			} else {
-				// On a 8 pixel boundary, just copy the next block of 8 pixels
-				//*p = sprite->pixels[ii];
-				*p = pixels[ii];
+		for(i = 0; i < sprite->height; i++){
+			if (shifted == NULL){
+				draw_ShiftRow(pixels, row, last_word, start_bits);
+				pixels += last_word;
 			}
-			p++;
-		}
-		
-		// If we have any end bits, set the last 8 pixels
-		if (i_end){
-			// Use the last pixels we masked off from the previous word
-			pixel_left = (unsigned char)((mask & 0xff00) >> 8) << remain_bits;
-			pixel_right = (unsigned char)(mask & 0x00ff) << remain_bits;
-	
-			// OR with any existing trailing bits; safest
-			*p = *p | (unsigned short)(pixel_left << 8) + pixel_right;
+			p[0] = (p[0] & ~edge) | row[0];
+			for(ii = 1; ii < last_word; ii++){
+				p[ii] = row[ii];
+			}
+			p[last_word] = (p[last_word] & edge) | row[last_word];
+			
+			if (shifted != NULL){
+				row += last_word + 1;
+			}
+			p += SCREEN_WORDS_PER_ROW;
 		}
-		
-		// Reposition screen memory pointer to next row
-		p = (unsigned short*) screen->buf;
-		p += start_addr + (i * SCREEN_WORDS_PER_ROW);
-		
-		// Next row, increment by an image width worth of pixels into the data
-		i_start += last_word;
 	}
 	
+	draw_Dirty(screen, y, sprite->height);
 	return BMP_OK;
 	
-}
\ No newline at end of file
+}
+
+void draw_ShiftRow(unsigned short *src, unsigned short *dest, unsigned char words, unsigned char shift){
+	// Shift a row of 'words' screen words of sprite pixels right by
+	// 'shift' (1-7) pixels, into 'words' + 1 screen words at dest.
+	// The green and red pixels are in the high and low bytes of each
+	// word, so each byte is shifted on its own and what falls off the
+	// end of it is carried into the same byte of the next word.
+	
+	unsigned short keep;			// Bits of each byte which stay in the same word
+	unsigned short carry = 0;		// Bits carried over from the previous word
+	unsigned short word;
+	unsigned char i;
+	
+	keep = ((0xFF >> shift) << 8) + (0xFF >> shift);
+	for (i = 0; i < words; i++){
+		word = src[i];
+		dest[i] = carry | ((word >> shift) & keep);
+		carry = (unsigned short)(word << (8 - shift)) & ~keep;
+	}
+	dest[words] = carry;
+}
+
+unsigned short *draw_SpriteShift(unsigned short *pixels, unsigned char width, unsigned char height, unsigned char shift){
+	// Return a copy of the sprite pixel data shifted right by 'shift' pixels,
+	// making it first if it isn't already in the cache. The least recently
+	// drawn copy is replaced when the cache is full.
+	// Returns NULL if there isn't the memory for a copy.
+	
+	SpriteShift_t *entry;
+	unsigned char i;
+	unsigned char words;
+	unsigned short size;
+	
+	words = width / 8;
+	draw_sprite_shift_clock++;
+	
+	// Already made?
+	for (i = 0; i < SPRITE_SHIFT_CACHE_SIZE; i++){
+		entry = &draw_sprite_shift[i];
+		if ((entry->source == pixels) && (entry->shift == shift) && (entry->width == width) && (entry->height == height)){
+			entry->used = draw_sprite_shift_clock;
+			return entry->pixels;
+		}
+	}
+	
+	// Pick a free slot, or the one drawn longest ago
+	entry = &draw_sprite_shift[0];
+	for (i = 0; i < SPRITE_SHIFT_CACHE_SIZE; i++){
+		if (draw_sprite_shift[i].source == NULL){
+			entry = &draw_sprite_shift[i];
+			break;
+		}
+		if ((unsigned short)(draw_sprite_shift_clock - draw_sprite_shift[i].used) > (unsigned short)(draw_sprite_shift_clock - entry->used)){
+			entry = &draw_sprite_shift[i];
+		}
+	}
+	
+	// Only reallocate if the slot is too small for this sprite
+	size = (words + 1) * height * sizeof(unsigned short);
+	if (entry->size < size){
+		free(entry->pixels);
+		entry->pixels = (unsigned short *) malloc(size);
+		while ((entry->pixels == NULL) && data_CacheShrink()){
+			// Memory is low, so the map and story caches give some back
+			entry->pixels = (unsigned short *) malloc(size);
+		}
+		if (entry->pixels == NULL){
+			entry->source = NULL;
+			entry->size = 0;
+			return NULL;
+		}
+		entry->size = size;
+	}
+	
+	for (i = 0; i < height; i++){
+		draw_ShiftRow(pixels + (i * words), entry->pixels + (i * (words + 1)), words, shift);
+	}
+	entry->source = pixels;
+	entry->width = width;
+	entry->height = height;
+	entry->shift = shift;
+	entry->used = draw_sprite_shift_clock;
+	return entry->pixels;
+}
+
+void draw_SpriteUncache(unsigned short *pixels){
+	// Forget any shifted copies of this sprite pixel data,
+	// called whenever new pixels are loaded over it.
+	
+	unsigned char i;
+	
+	for (i = 0; i < SPRITE_SHIFT_CACHE_SIZE; i++){
+		if (draw_sprite_shift[i].source == pixels){
+			draw_sprite_shift[i].source = NULL;
+		}
+	}
+}
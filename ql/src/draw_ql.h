@@ -36,6 +36,13 @@
 #define SCREEN_PIXELS_PER_BYTE 8 		// Each byte has 8 pixels
 #define SCREEN_WORDS_PER_ROW 	64 		// 64 x 8 pixels per row
 
+// The offscreen buffer is tracked in horizontal bands of scanlines, so that
+// draw_Flip only needs to copy the parts of the screen which have changed
+#define SCREEN_BAND_ROWS		8		// Scanlines per band
+#define SCREEN_BANDS			32		// SCREEN_HEIGHT / SCREEN_BAND_ROWS, one bit each
+#define SCREEN_BAND_BYTES		(SCREEN_BAND_ROWS * SCREEN_WORDS_PER_ROW * 2)
+#define SCREEN_DIRTY_ALL		0xFFFFFFFF
+
 // Bitmasks which are used to fill in a 8x1 matrix of pixels in a given colour
 #define PIXEL_CLEAR				0x1111	// Flag to indicate 'do not fill' when drawing a box
 #define PIXEL_BLACK 			0x0000
@@ -82,6 +89,23 @@
 #define DRAW_BG_X				8		// Draw background images at these x,y coords
 #define DRAW_BG_Y				16
 
+// Native screen format images, as written by the data compiler: a header,
+// then each row of the image as 16bit screen words, ready to copy.
+#define SCR_SIGNATURE			0x5153	// 'QS', rows of screen words follow
+#define SCR_SIGNATURE_LZ		0x515A	// 'QZ', LZ compressed rows of screen words follow
+#define SCR_HEADER_SIZE			6
+
+// LZ compressed images are a series of tokens: a token byte below 0x80 is followed
+// by (token + 1) literal bytes, otherwise by a 2 byte offset back into the bytes
+// already unpacked, from which (token - 0x80 + LZ_MIN_MATCH) bytes are copied.
+#define LZ_MIN_MATCH			4
+#define LZ_BUFFER_SIZE			512		// Compressed data is read from disk this many bytes at a time
+typedef struct {
+	unsigned short signature;	// Always SCR_SIGNATURE
+	unsigned short width;		// In pixels, always a multiple of 8
+	unsigned short height;		// In rows
+} ScrHeader_t;
+
 #define POPUP_STEPS				5
 
 // Small/monster/player sprite data
@@ -102,6 +126,20 @@ typedef struct lspritedata {
 	unsigned short	pixels[SPRITE_BOSS_WORDS];				// Array of QL pixels (16bits = 8 pixels)
 } lsprite_t;
 
+// Sprites drawn at an x coordinate which isn't on an 8 pixel boundary are
+// pre-shifted once into a copy one screen word wider per row, so they can
+// then be drawn with plain word copies. This keeps the most recently used copies.
+#define SPRITE_SHIFT_CACHE_SIZE	8
+typedef struct {
+	unsigned short *source;		// Sprite pixel data this copy was made from, or NULL if unused
+	unsigned short *pixels;		// Shifted pixel data, (width / 8) + 1 words per row
+	unsigned short size;		// Bytes allocated at pixels
+	unsigned short used;		// Value of the cache clock when this copy was last drawn
+	unsigned char width;		// Dimensions of the source sprite
+	unsigned char height;
+	unsigned char shift;		// Number of pixels the copy is shifted right by (1-7)
+} SpriteShift_t;
+
 // Screen definition
 typedef struct screendata {
 	chanid_t win;				// QDOS virtual screen mode
@@ -111,7 +149,7 @@ typedef struct screendata {
 	unsigned int *offscreen;	// Pointer to possible 'off-screen' video buffer
 	unsigned int screen;		// Memory address of real video memory
 	unsigned char indirect;		// Flag to indicate use of off-screen or direct video memory writes
-	unsigned char dirty;		// Flag to indicate buffer has been changed
+	unsigned long dirty;		// Bitmap of bands which have changed since the last flip
 	unsigned int vblank_timer;	// Variable used in poll routine to wait for 'x' amount of vblank interrupts
 	unsigned char popup_steps;	//
 	
@@ -135,6 +173,26 @@ typedef struct screendata {
 	lsprite_t *boss[1];			// We (currently) only support one boss per level and they have a large sprite
 } Screen_t;	
 
+// Startup arena space used by screen_Init() and draw_ExpandFont()
+#define DRAW_ARENA_BYTES	(ARENA_ALIGN(sizeof(bmpstate_t)) + ((MAX_PLAYERS + MAX_MONSTER_TYPES) * ARENA_ALIGN(sizeof(ssprite_t))) + (MAX_BOSS_TYPES * ARENA_ALIGN(sizeof(lsprite_t))) + ARENA_ALIGN(BMP_FONT_GLYPH_BYTES))
+
+// A block of text which has been split into lines and pages once,
+// so that any page of it can be drawn again without re-measuring it.
+// Longer text is laid out a part at a time, see draw_TextLayout().
+#define TEXT_LAYOUT_MAX_LINES	128
+#define TEXT_LAYOUT_MAX_PAGES	8
+typedef struct {
+	char *text;											// Text that the layout was made from
+	unsigned char lines;								// Number of lines in the layout
+	unsigned char pages;								// Number of pages in the layout
+	unsigned short line_start[TEXT_LAYOUT_MAX_LINES];	// Position in the text of the start of each line
+	unsigned short line_end[TEXT_LAYOUT_MAX_LINES];		// Position just past the last printed character of each line
+	unsigned char page_line[TEXT_LAYOUT_MAX_PAGES + 1];	// First line of each page, plus one past the last page
+	unsigned short page_fill[TEXT_LAYOUT_MAX_PAGES];	// Text colour in effect at the start of each page
+	unsigned short more;								// Position in the text of the next part to lay out, or 0 if none
+	unsigned short more_fill;							// Text colour in effect at the start of the next part
+} TextLayout_t;
+
 #endif
 
 // Prototypes
@@ -148,18 +206,33 @@ void screen_Vsync(Screen_t *screen, unsigned char wait);
 
 void draw_Clear(Screen_t *screen);
 void draw_Flip(Screen_t *screen);
+void draw_Dirty(Screen_t *screen, unsigned short y, unsigned short height);
 void draw_GetXY(unsigned short x, unsigned short y, unsigned short *addr, unsigned char *bits);
 void draw_GetStringXY(unsigned short x, unsigned short y, unsigned short *addr);
 void draw_HLine(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short fill, unsigned char pad, unsigned char mode);
+void draw_Fill(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short height, unsigned short fill, unsigned char pad, unsigned char hatch, unsigned char mode);
 void draw_VLine(Screen_t *screen, unsigned short x, unsigned short y, unsigned short length, unsigned short fill, unsigned char mode);
 void draw_Box(Screen_t *screen, unsigned short x, unsigned short y, 	unsigned short length, unsigned short height, unsigned short borderpx, unsigned short borderfill, unsigned short centrefill, unsigned char mode);
 unsigned short draw_String(Screen_t *screen, unsigned char x, unsigned char y, unsigned char max_chars, unsigned char max_rows, unsigned short offset_chars, fontdata_t *fontdata, unsigned short fill, char *c, unsigned char mode);
+unsigned short draw_TagFill(unsigned char tag, unsigned short fill, unsigned short original_fill);
+unsigned char draw_TextPrewrapped(char *c, unsigned short pos, unsigned short string_len, unsigned char max_chars);
+unsigned short draw_TextLine(char *c, unsigned short pos, unsigned short string_len, unsigned char max_chars, unsigned short *end, unsigned short *fill, unsigned short original_fill, unsigned char *prewrapped);
+unsigned short draw_TextSpan(Screen_t *screen, unsigned short start_p, char *c, unsigned short pos, unsigned short end, fontdata_t *fontdata, unsigned short fill, unsigned short original_fill, unsigned char mode);
+void draw_TextLayout(TextLayout_t *layout, char *c, unsigned short offset_chars, unsigned char max_chars, unsigned char max_rows, unsigned short fill);
+void draw_TextLayoutPage(Screen_t *screen, TextLayout_t *layout, unsigned char page, unsigned char col, unsigned char y, fontdata_t *fontdata, unsigned short fill, unsigned char mode);
+void draw_ExpandFont(fontdata_t *fontdata);
 void draw_FontSymbol(unsigned char i, fontdata_t *fontdata, unsigned short fill, unsigned short *p, unsigned char mode);
 void draw_StringInvert(Screen_t *screen, unsigned char x, unsigned char y, unsigned char max_chars, fontdata_t *fontdata);
 
-int draw_BitmapAsync(Screen_t *screen, int bmpfile);
-int draw_BitmapAsyncFull(Screen_t *screen, unsigned short x, unsigned short y, char *filename);
+int draw_Image(Screen_t *screen, unsigned short x, unsigned short y, char *filename);
+int draw_Background(Screen_t *screen, unsigned short location_id);
+int draw_ImageUnpack(int f, unsigned short *p, unsigned short row_bytes, unsigned short rows);
+int draw_UnpackFill(int f);
+int draw_UnpackByte(int f);
 int draw_Sprite(Screen_t *screen, unsigned short x, unsigned short y, ssprite_t *sprite, unsigned char portrait);
+void draw_ShiftRow(unsigned short *src, unsigned short *dest, unsigned char words, unsigned char shift);
+unsigned short *draw_SpriteShift(unsigned short *pixels, unsigned char width, unsigned char height, unsigned char shift);
+void draw_SpriteUncache(unsigned short *pixels);
 void draw_SelectedString(Screen_t *screen, unsigned char col, unsigned char y, unsigned char max_chars, unsigned short fill, char *c);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+/* font_ql.c, The 8x8 font for the Sinclair QL.
+
+ Generated by etc/font_ql.py from assets/font8x8.bmp - do not edit.
+*/
+
+#include <stdlib.h>
+
+#include "bmp_ql.h"
+
+fontdata_t font_8x8_data = {
+	8,		// Width of each character, in pixels
+	8,		// Height of each character, in pixels
+	32,		// ASCII number of symbol 0
+	96,		// Total number of symbols
+	37,		// Which symbol do we map to unknown/missing symbols?
+	{
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	//  32 ' '
+		{ 0x00, 0x0C, 0x0C, 0x0C, 0x08, 0x08, 0x00, 0x18 },	//  33 '!'
+		{ 0x00, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00 },	//  34 '"'
+		{ 0x00, 0x12, 0x3F, 0x12, 0x12, 0x3F, 0x12, 0x00 },	//  35 '#'
+		{ 0x08, 0x1C, 0x2A, 0x18, 0x0C, 0x2A, 0x1C, 0x08 },	//  36 '$'
+		{ 0x00, 0x42, 0xA4, 0x48, 0x10, 0x24, 0x4A, 0x84 },	//  37 '%'
+		{ 0x00, 0x0C, 0x12, 0x12, 0x0C, 0x15, 0x22, 0x1D },	//  38 '&'
+		{ 0x00, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 },	//  39 '''
+		{ 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x08, 0x04 },	//  40 '('
+		{ 0x10, 0x08, 0x04, 0x04, 0x04, 0x04, 0x08, 0x10 },	//  41 ')'
+		{ 0x00, 0x00, 0x08, 0x1C, 0x08, 0x14, 0x00, 0x00 },	//  42 '*'
+		{ 0x00, 0x00, 0x08, 0x08, 0x3E, 0x08, 0x08, 0x00 },	//  43 '+'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 },	//  44 ','
+		{ 0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x00 },	//  45 '-'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18 },	//  46 '.'
+		{ 0x01, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40 },	//  47 '/'
+		{ 0x00, 0x1C, 0x26, 0x63, 0x63, 0x63, 0x32, 0x1C },	//  48 '0'
+		{ 0x00, 0x18, 0x38, 0x18, 0x18, 0x18, 0x18, 0x7E },	//  49 '1'
+		{ 0x00, 0x3E, 0x63, 0x07, 0x1E, 0x3C, 0x70, 0x7F },	//  50 '2'
+		{ 0x00, 0x3F, 0x06, 0x0C, 0x1E, 0x03, 0x63, 0x3E },	//  51 '3'
+		{ 0x00, 0x0E, 0x1E, 0x36, 0x66, 0x7F, 0x06, 0x06 },	//  52 '4'
+		{ 0x00, 0x7E, 0x60, 0x7E, 0x03, 0x03, 0x63, 0x3E },	//  53 '5'
+		{ 0x00, 0x1E, 0x30, 0x60, 0x7E, 0x63, 0x63, 0x3E },	//  54 '6'
+		{ 0x00, 0x7F, 0x63, 0x06, 0x0C, 0x18, 0x18, 0x18 },	//  55 '7'
+		{ 0x00, 0x3C, 0x62, 0x72, 0x3C, 0x4F, 0x43, 0x3E },	//  56 '8'
+		{ 0x00, 0x3E, 0x63, 0x63, 0x3F, 0x03, 0x06, 0x3C },	//  57 '9'
+		{ 0x00, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x00 },	//  58 ':'
+		{ 0x00, 0x18, 0x18, 0x00, 0x00, 0x18, 0x08, 0x10 },	//  59 ';'
+		{ 0x00, 0x04, 0x08, 0x10, 0x20, 0x10, 0x08, 0x04 },	//  60 '<'
+		{ 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3E, 0x00, 0x00 },	//  61 '='
+		{ 0x00, 0x20, 0x10, 0x08, 0x04, 0x08, 0x10, 0x20 },	//  62 '>'
+		{ 0x7E, 0x62, 0x02, 0x1E, 0x18, 0x00, 0x18, 0x18 },	//  63 '?'
+		{ 0x00, 0x3E, 0x41, 0x5D, 0x5F, 0x40, 0x3E, 0x00 },	//  64 '@'
+		{ 0x00, 0x1C, 0x36, 0x63, 0x63, 0x7F, 0x63, 0x63 },	//  65 'A'
+		{ 0x00, 0x7E, 0x63, 0x63, 0x7E, 0x63, 0x63, 0x7E },	//  66 'B'
+		{ 0x00, 0x1E, 0x33, 0x60, 0x60, 0x60, 0x33, 0x1E },	//  67 'C'
+		{ 0x00, 0x7C, 0x66, 0x63, 0x63, 0x63, 0x66, 0x7C },	//  68 'D'
+		{ 0x00, 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x7E },	//  69 'E'
+		{ 0x00, 0x7F, 0x60, 0x60, 0x7E, 0x60, 0x60, 0x60 },	//  70 'F'
+		{ 0x00, 0x1F, 0x30, 0x60, 0x67, 0x63, 0x33, 0x1F },	//  71 'G'
+		{ 0x00, 0x63, 0x63, 0x63, 0x7F, 0x63, 0x63, 0x63 },	//  72 'H'
+		{ 0x00, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E },	//  73 'I'
+		{ 0x00, 0x03, 0x03, 0x03, 0x03, 0x03, 0x63, 0x3E },	//  74 'J'
+		{ 0x00, 0x63, 0x66, 0x6C, 0x78, 0x7C, 0x6E, 0x67 },	//  75 'K'
+		{ 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7E },	//  76 'L'
+		{ 0x00, 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63 },	//  77 'M'
+		{ 0x00, 0x63, 0x73, 0x7B, 0x7F, 0x6F, 0x67, 0x63 },	//  78 'N'
+		{ 0x00, 0x3E, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3E },	//  79 'O'
+		{ 0x00, 0x7E, 0x63, 0x63, 0x63, 0x7E, 0x60, 0x60 },	//  80 'P'
+		{ 0x00, 0x3E, 0x63, 0x63, 0x63, 0x6F, 0x66, 0x3D },	//  81 'Q'
+		{ 0x00, 0x7E, 0x63, 0x63, 0x67, 0x7C, 0x6E, 0x67 },	//  82 'R'
+		{ 0x00, 0x3C, 0x66, 0x60, 0x3E, 0x03, 0x63, 0x3E },	//  83 'S'
+		{ 0x00, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 },	//  84 'T'
+		{ 0x00, 0x63, 0x63, 0x63, 0x63, 0x63, 0x63, 0x3E },	//  85 'U'
+		{ 0x00, 0x63, 0x63, 0x63, 0x77, 0x3E, 0x1C, 0x08 },	//  86 'V'
+		{ 0x00, 0x63, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x22 },	//  87 'W'
+		{ 0x00, 0x63, 0x77, 0x3E, 0x1C, 0x3E, 0x77, 0x63 },	//  88 'X'
+		{ 0x00, 0x66, 0x66, 0x24, 0x3C, 0x18, 0x18, 0x18 },	//  89 'Y'
+		{ 0x00, 0x7F, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0x7F },	//  90 'Z'
+		{ 0x00, 0x1C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1C },	//  91 '['
+		{ 0x40, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01 },	//  92 backslash
+		{ 0x00, 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x1C },	//  93 ']'
+		{ 0x00, 0x08, 0x14, 0x22, 0x00, 0x00, 0x00, 0x00 },	//  94 '^'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },	//  95 '_'
+		{ 0x00, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 },	//  96 '`'
+		{ 0x00, 0x00, 0x00, 0x1E, 0x01, 0x1F, 0x23, 0x1D },	//  97 'a'
+		{ 0x00, 0x20, 0x20, 0x20, 0x3E, 0x21, 0x31, 0x2E },	//  98 'b'
+		{ 0x00, 0x00, 0x00, 0x00, 0x1E, 0x21, 0x20, 0x1E },	//  99 'c'
+		{ 0x00, 0x01, 0x01, 0x01, 0x1F, 0x21, 0x23, 0x1D },	// 100 'd'
+		{ 0x00, 0x00, 0x00, 0x1E, 0x21, 0x3F, 0x20, 0x1E },	// 101 'e'
+		{ 0x00, 0x0E, 0x11, 0x10, 0x3C, 0x10, 0x10, 0x10 },	// 102 'f'
+		{ 0x00, 0x00, 0x1E, 0x21, 0x21, 0x1F, 0x01, 0x3E },	// 103 'g'
+		{ 0x00, 0x20, 0x20, 0x20, 0x2E, 0x31, 0x21, 0x21 },	// 104 'h'
+		{ 0x00, 0x00, 0x10, 0x00, 0x10, 0x10, 0x10, 0x18 },	// 105 'i'
+		{ 0x00, 0x00, 0x02, 0x00, 0x02, 0x02, 0x22, 0x1C },	// 106 'j'
+		{ 0x00, 0x20, 0x20, 0x21, 0x26, 0x38, 0x26, 0x21 },	// 107 'k'
+		{ 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0C },	// 108 'l'
+		{ 0x00, 0x00, 0x00, 0x76, 0x49, 0x49, 0x49, 0x49 },	// 109 'm'
+		{ 0x00, 0x00, 0x00, 0x2E, 0x31, 0x21, 0x21, 0x21 },	// 110 'n'
+		{ 0x00, 0x00, 0x00, 0x1E, 0x21, 0x21, 0x21, 0x1E },	// 111 'o'
+		{ 0x00, 0x00, 0x2E, 0x31, 0x21, 0x3E, 0x20, 0x20 },	// 112 'p'
+		{ 0x00, 0x00, 0x1D, 0x23, 0x21, 0x1F, 0x01, 0x01 },	// 113 'q'
+		{ 0x00, 0x00, 0x00, 0x2E, 0x31, 0x20, 0x20, 0x20 },	// 114 'r'
+		{ 0x00, 0x00, 0x1E, 0x20, 0x1E, 0x01, 0x21, 0x1E },	// 115 's'
+		{ 0x00, 0x10, 0x10, 0x3E, 0x10, 0x10, 0x12, 0x0C },	// 116 't'
+		{ 0x00, 0x00, 0x00, 0x21, 0x21, 0x21, 0x21, 0x1E },	// 117 'u'
+		{ 0x00, 0x00, 0x00, 0x21, 0x21, 0x12, 0x14, 0x08 },	// 118 'v'
+		{ 0x00, 0x00, 0x00, 0x41, 0x41, 0x2A, 0x2A, 0x14 },	// 119 'w'
+		{ 0x00, 0x00, 0x00, 0x21, 0x12, 0x0C, 0x12, 0x21 },	// 120 'x'
+		{ 0x00, 0x00, 0x00, 0x21, 0x21, 0x1F, 0x01, 0x3E },	// 121 'y'
+		{ 0x00, 0x00, 0x00, 0x3F, 0x01, 0x1E, 0x20, 0x3F },	// 122 'z'
+		{ 0x00, 0x06, 0x08, 0x08, 0x10, 0x08, 0x08, 0x06 },	// 123 '{'
+		{ 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08 },	// 124 '|'
+		{ 0x00, 0x0C, 0x02, 0x02, 0x01, 0x02, 0x02, 0x0C },	// 125 '}'
+		{ 0x00, 0x00, 0x19, 0x26, 0x00, 0x00, 0x00, 0x00 },	// 126 '~'
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// 127
+	},
+	NULL		// Colour expanded symbols are built by draw_ExpandFont()
+};
@@ -39,24 +39,33 @@
 #ifndef _CONDITIONS_H
 #include "../common/conditions.h"
 #endif
+#ifndef _ENGINE_H
+#include "../common/engine.h"
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#endif
+#ifndef _ERROR_H
+#include "../common/error.h"
+#endif
 
-FILE *story_file;
-FILE *map_file;
-FILE *weapon_file;
-FILE *item_file;
-FILE *monster_file;
-FILE *index_file;
-
-void game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
+int game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
 	// Load initial data for the currently selected game
 	//
 	// This does such things as:
 	// - Load story text for the splash screen
 	// - Populate Player character details
 	// - Set initial map location
+	//
+	// Returns DATA_LOAD_OK, or the error from loading the starting party
 	
 	unsigned char character_screen = 0;
 	unsigned short i;
+	PlayerState_t *party[MAX_PLAYERS];
+	ssprite_t *party_sprites[MAX_PLAYERS];
+	unsigned char party_ids[MAX_PLAYERS];
+	unsigned char party_number = 0;
+	int status;
 	
 	// Initialise game state
 	gamestate->gamemode = GAME_MODE_MAP;
@@ -64,26 +73,31 @@ void game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstat
 	gamestate->level_previous = 1;
 	gamestate->gold = 0;
 	gamestate->counter = 0;
-	gamestate->npcs = (struct NPCList *) calloc(sizeof(struct NPCList), 1);
-	gamestate->players = (PartyState_t *) calloc(sizeof(PlayerState_t), 1);
+	memset(&gamestate->npcs, 0, sizeof(NPCState_t));
+	
+	// The party and enemies are carved from the startup arena, which
+	// main() sizes to fit them (see GAME_ARENA_BYTES)
+	gamestate->players = (PartyState_t *) arena_Alloc(sizeof(PartyState_t));
 	for (i = 0; i < MAX_PLAYERS; i++){
-		gamestate->players->player[i] = (PlayerState_t *) calloc(sizeof(PlayerState_t), 1);
-		gamestate->players->player[i]->weapon_r = (WeaponState_t *) calloc(sizeof(WeaponState_t), 1);
-		gamestate->players->player[i]->weapon_l = (WeaponState_t *) calloc(sizeof(WeaponState_t), 1);
-		gamestate->players->player[i]->head = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
-		gamestate->players->player[i]->body = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
-		gamestate->players->player[i]->option = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
+		gamestate->players->player[i] = game_AllocCharacter();
 	}
-	gamestate->enemies = (EnemyState_t *) calloc(sizeof(EnemyState_t), 1);
+	gamestate->enemies = (EnemyState_t *) arena_Alloc(sizeof(EnemyState_t));
 	for (i = 0; i < MAX_MONSTER_TYPES; i++){
-		gamestate->enemies->enemy[i] = (PlayerState_t *) calloc(sizeof(PlayerState_t), 1);
-		gamestate->enemies->enemy[i]->weapon_r = (WeaponState_t *) calloc(sizeof(WeaponState_t), 1);
-		gamestate->enemies->enemy[i]->weapon_l = (WeaponState_t *) calloc(sizeof(WeaponState_t), 1);
-		gamestate->players->player[i]->head = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
-		gamestate->players->player[i]->body = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
-		gamestate->players->player[i]->option = (ItemState_t *) calloc(sizeof(ItemState_t), 1);
+		gamestate->enemies->enemy[i] = game_AllocCharacter();
 	}
 	
+	// Open all of the datafiles, these stay open until game_Exit
+	data_OpenFiles();
+	
+	// Load the story and map indexes into memory
+	data_LoadIndexes(screen);
+	
+	// Load the dictionary for compressed story text, if there is one
+	data_LoadStoryDict(screen);
+	
+	// The map and story caches get whatever memory is left
+	data_CacheInit();
+	
 	// Open the story data file and load entry 0 - this has the adventure name
 	data_LoadStory(screen, gamestate, levelstate, 0);
 	strncpy((char *)gamestate->name, (char *)gamestate->buf, MAX_LEVEL_NAME_SIZE);
@@ -94,14 +108,42 @@ void game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstat
 	
 	// Open the Map data file and load entry 1 - this will be our starting location
 	data_LoadMap(screen, gamestate, levelstate, 1);
-	gamestate->level_visits[1] = 1;
+	memset(&gamestate->progress, 0, sizeof(Progress_t));
+	progress_Visit(gamestate, 1);
 	
-	// Initialise a new player character and their sprites
-	data_CreateCharacter(screen, gamestate->players->player[0], screen->players[0], NULL, CHARACTER_TYPE_MONSTER, 1);
-	data_CreateCharacter(screen, gamestate->players->player[1], screen->players[1], NULL, CHARACTER_TYPE_NPC, 1);
-	for (i = 2; i < MAX_PLAYERS; i++){
-		data_CreateCharacter(screen, gamestate->players->player[i], screen->players[i], NULL, CHARACTER_TYPE_MONSTER, 0);
+	// Initialise the starting party and their sprites. Player 2 comes from the
+	// NPC datafile; the rest are from the monster datafile, and are loaded as one batch.
+	for (i = 0; i < MAX_PLAYERS; i++){
+		if (i != 1){
+			party[party_number] = gamestate->players->player[i];
+			party_sprites[party_number] = screen->players[i];
+			party_ids[party_number] = (i == 0) ? 1 : 0;
+			party_number++;
+		}
+	}
+	status = data_CreateCharacters(screen, party, party_sprites, NULL, CHARACTER_TYPE_MONSTER, party_ids, party_number);
+	if (status != DATA_LOAD_OK){
+		return status;
+	}
+	return data_CreateCharacter(screen, gamestate->players->player[1], screen->players[1], NULL, CHARACTER_TYPE_NPC, 1);
+}
+
+PlayerState_t * game_AllocCharacter(){
+	// Carve a character from the arena. Its weapon and item slots point at
+	// shared definitions (see data_ItemRef), and start out empty.
+	
+	PlayerState_t *character;
+	
+	character = (PlayerState_t *) arena_Alloc(sizeof(PlayerState_t));
+	if (character == NULL){
+		return NULL;
 	}
+	character->weapon_r = data_WeaponShare(NULL);
+	character->weapon_l = data_WeaponShare(NULL);
+	character->head = data_ItemShare(NULL);
+	character->body = data_ItemShare(NULL);
+	character->option = data_ItemShare(NULL);
+	return character;
 }
 
 void game_Exit(Screen_t *screen){
@@ -109,6 +151,10 @@ void game_Exit(Screen_t *screen){
 	// Clear screen
 	// Return to previous screen mode
 	
+	data_StoryCacheFree();
+	data_MapCacheFree();
+	data_FreeIndexes();
+	data_CloseFiles();
 	draw_Clear(screen);
 }
 
@@ -141,12 +187,6 @@ void game_Map(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate
 	unsigned char e = 0;
 	unsigned short remain = 0;
 	
-	// Clear input
-	input_Clear();
-	input_Set(INPUT_QUIT);
-	input_Set(INPUT_QUIT_);
-	input_Set(INPUT_DEBUG);
-	
 	// Redraw the main screen
 	ui_Draw(screen, gamestate, levelstate);
 	
@@ -155,10 +195,19 @@ void game_Map(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate
 		data_LoadMap(screen, gamestate, levelstate, gamestate->level);
 		
 		// Record a visit to this location
-		if (gamestate->level_visits[gamestate->level] < 255){
-			gamestate->level_visits[gamestate->level]++;
-		}
+		progress_Visit(gamestate, gamestate->level);
+		
+		// Show the location's background image first, if it has one.
+		// Locations without one go straight to their text.
+		ui_DrawBackground(screen, gamestate, levelstate);
 	}
+	
+	// Clear input
+	input_Clear();
+	input_Set(INPUT_QUIT);
+	input_Set(INPUT_QUIT_);
+	input_Set(INPUT_DEBUG);
+	
 	ui_DrawLocationName(screen, gamestate, levelstate);
 	
 	// Load default map location text - but don't display yet, 
@@ -259,9 +308,16 @@ void game_Map(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate
 	
 	draw_Flip(screen);
 	
+	// Start loading the neighbouring locations while we wait for a key
+	data_PrefetchStart(levelstate);
+	
 	// Wait for user input
 	while(!e){
 		c = input_Get(screen);
+		if (c == 0){
+			// Nothing pressed yet, so load the next neighbouring record
+			data_PrefetchStep(screen);
+		}
 		switch(c){
 			case INPUT_DEBUG:
 				// ======================================
@@ -394,6 +450,13 @@ void game_Map(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate
 void game_Combat(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
 	// Combat mode - cannot exit this until the combat is resolved
 	
+	// Load the monsters for this fight. If they cannot all be loaded
+	// (the error has already been shown) there is no fight.
+	if (game_LoadEncounter(screen, gamestate, levelstate, game_CheckMonsterSpawn(gamestate, levelstate, 0, 0)) != DATA_LOAD_OK){
+		gamestate->gamemode = GAME_MODE_MAP;
+		return;
+	}
+	
 	// If combat is successful we exit out of game_Combat and return to game_Map
 	// Otherwise we show the game over screen
 	//gamestate->gamemode = GAME_MODE_MAP;
@@ -422,23 +485,23 @@ void game_Quit(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstat
 }
 
 unsigned char game_CheckMonsterSpawn(GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text){
-	// Returns a flag indicating if combat is going to happen
-	// Checks both primary and secondary spawning rules
+	// Returns a flag indicating if combat is going to happen, and against which
+	// spawn list. Checks both primary and secondary spawning rules
 	
-	unsigned char can_fight = 0;
+	unsigned char can_fight = GAME_SPAWN_NONE;
 	
 	// Are there any monster ID's listed as primary spawn?
 	if (levelstate->spawn_number){
-		if (check_Cond(gamestate, levelstate, levelstate->spawn_require, levelstate->spawn_require_number, levelstate->spawn_eval_type)){
-			can_fight = 1;
+		if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, spawn), levelstate->spawn_require_number, levelstate->spawn_eval_type)){
+			can_fight = GAME_SPAWN_PRIMARY;
 		}
 	}
 	
 	// Only if the primary spawn is false do we check secondary spawn
 	if (!can_fight){
 		if (levelstate->respawn_number){
-			if (check_Cond(gamestate, levelstate, levelstate->respawn_require, levelstate->respawn_require_number, levelstate->respawn_eval_type)){
-				can_fight = 2;
+			if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, respawn), levelstate->respawn_require_number, levelstate->respawn_eval_type)){
+				can_fight = GAME_SPAWN_SECONDARY;
 			}
 		}
 	}
@@ -446,6 +509,20 @@ unsigned char game_CheckMonsterSpawn(GameState_t *gamestate, LevelState_t *level
 	
 }
 
+int game_LoadEncounter(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char spawn){
+	// Load every monster of the primary or secondary spawn list of this
+	// location into the enemy slots, as a single batch.
+	// Returns DATA_LOAD_OK, or the error from loading the batch.
+	
+	if (spawn == GAME_SPAWN_PRIMARY){
+		return data_CreateCharacters(screen, gamestate->enemies->enemy, screen->enemies, screen->boss[0], CHARACTER_TYPE_MONSTER, levelstate->spawn_list, levelstate->spawn_number);
+	}
+	if (spawn == GAME_SPAWN_SECONDARY){
+		return data_CreateCharacters(screen, gamestate->enemies->enemy, screen->enemies, screen->boss[0], CHARACTER_TYPE_MONSTER, levelstate->respawn_list, levelstate->respawn_number);
+	}
+	return DATA_LOAD_OK;
+}
+
 unsigned char game_CheckTalk(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text){
 	// Returns a flag indicating if there is an NPC to talk to.
 	// Prints 'you can talk to <character_name> to the main ui if set
@@ -463,7 +540,7 @@ unsigned char game_CheckTalk(Screen_t *screen, GameState_t *gamestate, LevelStat
 	// Check conditions
 	if (levelstate->npc1 > 0){
 		add_it = 0;
-		if (check_Cond(gamestate, levelstate, levelstate->npc1_require, levelstate->npc1_require_number, levelstate->npc1_eval_type)){
+		if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, npc1), levelstate->npc1_require_number, levelstate->npc1_eval_type)){
 			// Add option
 			add_it = 1;
 			levelstate->has_npc1 = 1;
@@ -486,7 +563,7 @@ unsigned char game_CheckTalk(Screen_t *screen, GameState_t *gamestate, LevelStat
 	// Check conditions
 	if (levelstate->npc2 > 0){
 		add_it = 0;
-		if (check_Cond(gamestate, levelstate, levelstate->npc2_require, levelstate->npc2_require_number, levelstate->npc2_eval_type)){
+		if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, npc2), levelstate->npc2_require_number, levelstate->npc2_eval_type)){
 			// Add option
 			add_it = 1;
 			levelstate->has_npc2 = 1;
@@ -508,7 +585,7 @@ unsigned char game_CheckTalk(Screen_t *screen, GameState_t *gamestate, LevelStat
 	// Check conditions
 	if (levelstate->npc3 > 0){
 		add_it = 0;
-		if (check_Cond(gamestate, levelstate, levelstate->npc3_require, levelstate->npc3_require_number, levelstate->npc3_eval_type)){
+		if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, npc3), levelstate->npc3_require_number, levelstate->npc3_eval_type)){
 			// Add option
 			add_it = 1;
 			levelstate->has_npc3 = 1;
@@ -545,7 +622,7 @@ unsigned char game_CheckLoot(Screen_t *screen, GameState_t *gamestate, LevelStat
 	unsigned char can_loot = 0;
 	
 	if ((levelstate->items_number > 0) || (levelstate->weapons_number > 0)){
-		if (check_Cond(gamestate, levelstate, levelstate->items_require, levelstate->items_require_number, levelstate->items_eval_type)){
+		if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, items), levelstate->items_require_number, levelstate->items_eval_type)){
 			add_it = 1;
 		}
 		if (add_it){
@@ -587,7 +664,7 @@ unsigned char game_CheckMovement(Screen_t *screen, GameState_t *gamestate, Level
 			// Check conditions
 			if (levelstate->north_require_number > 0){
 				add_it = 0;
-				if (check_Cond(gamestate, levelstate, levelstate->north_require, levelstate->north_require_number, levelstate->north_eval_type)){
+				if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, north), levelstate->north_require_number, levelstate->north_eval_type)){
 					// Add option
 					add_it = 1;
 				}
@@ -614,7 +691,7 @@ unsigned char game_CheckMovement(Screen_t *screen, GameState_t *gamestate, Level
 			// Check conditions
 			if (levelstate->south_require_number > 0){
 				add_it = 0;
-				if (check_Cond(gamestate, levelstate, levelstate->south_require, levelstate->south_require_number, levelstate->south_eval_type)){
+				if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, south), levelstate->south_require_number, levelstate->south_eval_type)){
 					// Add option
 					add_it = 1;
 				}
@@ -641,7 +718,7 @@ unsigned char game_CheckMovement(Screen_t *screen, GameState_t *gamestate, Level
 			// Check conditions
 			if (levelstate->east_require_number > 0){
 				add_it = 0;
-				if (check_Cond(gamestate, levelstate, levelstate->east_require, levelstate->east_require_number, levelstate->east_eval_type)){
+				if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, east), levelstate->east_require_number, levelstate->east_eval_type)){
 					// Add option
 					add_it = 1;
 				}
@@ -668,7 +745,7 @@ unsigned char game_CheckMovement(Screen_t *screen, GameState_t *gamestate, Level
 			// Check conditions
 			if (levelstate->west_require_number > 0){
 				add_it = 0;
-				if (check_Cond(gamestate, levelstate, levelstate->west_require, levelstate->west_require_number, levelstate->west_eval_type)){
+				if (check_Cond(gamestate, levelstate, LEVEL_REQUIRE(levelstate, west), levelstate->west_require_number, levelstate->west_eval_type)){
 					// Add option
 					add_it = 1;
 				}
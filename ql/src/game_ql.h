@@ -24,6 +24,17 @@
 #include "../common/draw.h"
 #endif
 
+// Startup arena space used by game_Init(), for each character and for the
+// whole party and enemy list. Equipped weapons and items are not counted here,
+// they are held in the shared definition tables in data_ql.c.
+#define GAME_CHARACTER_BYTES	ARENA_ALIGN(sizeof(PlayerState_t))
+#define GAME_ARENA_BYTES		(ARENA_ALIGN(sizeof(PartyState_t)) + ARENA_ALIGN(sizeof(EnemyState_t)) + ((MAX_PLAYERS + MAX_MONSTER_TYPES) * GAME_CHARACTER_BYTES))
+
+// Which monster spawn list of a location, if any, game_CheckMonsterSpawn() found
+#define GAME_SPAWN_NONE			0
+#define GAME_SPAWN_PRIMARY		1		// The spawn_list
+#define GAME_SPAWN_SECONDARY	2		// The respawn_list
+
 #endif
 
 // Prototypes
@@ -31,8 +42,9 @@
 #ifndef _GAME_QL_PROTO_H
 #define _GAME_QL_PROTO_H
 
-void game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate); 		// Init game data
+int game_Init(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate); 		// Init game data
 void game_Exit(Screen_t *screen); 															// De-init game data
+PlayerState_t * game_AllocCharacter();														// Carve a character from the startup arena
 
 // Game modes or screens
 void game_Combat(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);		// Turn based console-style combat
@@ -44,6 +56,7 @@ void game_Quit(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstat
 unsigned char game_CheckLoot(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text);
 unsigned char game_CheckMovement(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text);
 unsigned char game_CheckMonsterSpawn(GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text);
+int game_LoadEncounter(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char spawn);
 unsigned char game_CheckTalk(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char add_inputs, unsigned char add_text);
 unsigned char game_CheckWithdraw(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
 void game_CheckAvailableParty(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
@@ -56,6 +56,10 @@
 #include "../common/error.h"
 #define _ERROR_H
 #endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#define _ARENA_H
+#endif
 
 // Options to the C68 runtime environment
 long _stack = 1 * 4024L; 		// Set size of stack, in kb. Defaults to 4kb.
@@ -65,6 +69,12 @@ long _memqdos = 10 * 1024L; 		// Minimum amount of memory that is allowed to rem
 								// ... this defaults to 20kb, so reducing it to 10kb gives us another
 								// 10kb of heap to play with - very useful for an unexpanded 128kb machine.
 
+// The fixed footprint must fit the memory budget of the target, see config_ql.h
+// and 'make budget' for a breakdown of where it goes
+BUILD_ASSERT(main_budget_arena, (ARENA_FIXED_BYTES + ARENA_SCRATCH_SIZE) <= MEMORY_BUDGET);
+BUILD_ASSERT(main_budget_gamestate, sizeof(GameState_t) <= MEMORY_BUDGET_GAMESTATE);
+BUILD_ASSERT(main_budget_levelstate, sizeof(LevelState_t) <= MEMORY_BUDGET_LEVELSTATE);
+
 int main(void){
 	
 	char c = 0;
@@ -76,15 +86,22 @@ int main(void){
 	
 	printf("%s starting...\n", ENGINE_NAME);
 	
-	// Allocate memory for basic data structures
-	gamestate = (GameState_t *) calloc(sizeof(GameState_t), 1);
-	levelstate = (LevelState_t *) calloc(sizeof(LevelState_t), 1);
-	screen = (Screen_t *) calloc(sizeof(Screen_t), 1);
-	if ((gamestate == NULL) || (levelstate == NULL) || (screen == NULL)){
+	// Reserve a single block for everything which lives for the whole session
+	if (arena_Init(ARENA_FIXED_BYTES) != ARENA_INIT_OK){
 		printf("- Error: Unable to allocate memory for essential data!");
 		printf("- Error: This Sinclair QL target requires 256KB in order");
 		printf("- Error: to run the OlderScrolls RPG engine!");
-		return(-1);
+		return(MAIN_ARENA_FAILURE);
+	}
+	
+	// Allocate memory for basic data structures
+	gamestate = (GameState_t *) arena_Alloc(sizeof(GameState_t));
+	levelstate = (LevelState_t *) arena_Alloc(sizeof(LevelState_t));
+	screen = (Screen_t *) arena_Alloc(sizeof(Screen_t));
+	if ((gamestate == NULL) || (levelstate == NULL) || (screen == NULL)){
+		printf("- Error: The memory arena is too small for the basic data structures!\n");
+		arena_Exit();
+		return(MAIN_ARENA_FAILURE);
 	}
 	
 	// Check that all game objects are present
@@ -108,7 +125,13 @@ int main(void){
 		
 	// Initialise game data and open any initial datafiles 
 	// (splash text, first level location)
-	game_Init(screen, gamestate, levelstate);
+	if (game_Init(screen, gamestate, levelstate) != DATA_LOAD_OK){
+		screen_Exit(screen);
+		game_Exit(screen);
+		arena_Exit();
+		printf("- Error: The starting party could not be loaded!\n");
+		return(MAIN_PARTY_FAILURE);
+	}
 	
 	// Show the adventure-specific splash screen
 	// ... and initialise random seed #2
@@ -141,5 +164,6 @@ int main(void){
 	
 	screen_Exit(screen);
 	game_Exit(screen);
+	arena_Exit();
 	return(OK);
 }
@@ -51,6 +51,17 @@
 #ifndef _ENGINE_H
 #include "../common/engine.h"
 #endif
+#ifndef _CONDITIONS_H
+#include "../common/conditions.h"
+#define _CONDITIONS_H
+#endif
+#ifndef _ARENA_H
+#include "../common/arena.h"
+#endif
+
+// Line and page breaks of the text currently shown in the main window
+TextLayout_t ui_main_layout;
+unsigned short ui_main_first_page;		// Page of the text that the layout starts at
 
 void ui_Draw(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
 	// Draws the main user interface - top bar with game name and turn counter
@@ -78,13 +89,11 @@ void ui_Draw(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate)
 	// Game Engine name in title bar
 	draw_String(screen, UI_TITLEBAR_TEXT_X, UI_TITLEBAR_TEXT_Y, 24, 1, 0, screen->font_8x8, PIXEL_GREEN, ENGINE_TARGET_NAME, MODE_PIXEL_OR);
 	
-	screen->dirty = 1;
 
 }
 
 void ui_DrawCombat(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
 	
-	screen->dirty = 1;
 }
 
 char ui_DrawCharacterScreen_Overview(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
@@ -570,7 +579,10 @@ char ui_DrawCharacterScreen_Inventory(Screen_t *screen, GameState_t *gamestate,
 						c = ui_DrawBooleanChoice(screen, "Equip Armour?", "No", "Yes");
 						if (c){
 							// Equip item
-							pc_Equip(gamestate->players->player[pc_id], &weapon, &item, 0);
+							if (pc_Equip(gamestate->players->player[pc_id], &weapon, &item, 0) == 0){
+								// No room left for another item/weapon definition
+								ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_DEF_FULL_MSG, DATA_LOAD_DEF_FULL);
+							}
 						}
 					}
 					if (weapon.item_id != 0){
@@ -581,11 +593,17 @@ char ui_DrawCharacterScreen_Inventory(Screen_t *screen, GameState_t *gamestate,
 							c = ui_DrawBooleanChoice(screen, "Choose Hand", "Right", "Left");
 							if (c == 0){
 								// Equip weapon
-								pc_Equip(gamestate->players->player[pc_id], &weapon, &item, RIGHT_HAND);
+								if (pc_Equip(gamestate->players->player[pc_id], &weapon, &item, RIGHT_HAND) == 0){
+									// No room left for another item/weapon definition
+									ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_DEF_FULL_MSG, DATA_LOAD_DEF_FULL);
+								}
 							}
 							if (c == 1){
 								// Equip weapon
-								pc_Equip(gamestate->players->player[pc_id], &weapon, &item, LEFT_HAND);
+								if (pc_Equip(gamestate->players->player[pc_id], &weapon, &item, LEFT_HAND) == 0){
+									// No room left for another item/weapon definition
+									ui_DrawError(screen, GENERIC_MEMORY_MSG, DATA_LOAD_DEF_FULL_MSG, DATA_LOAD_DEF_FULL);
+								}
 							}
 						}
 					}
@@ -649,7 +667,7 @@ char ui_DrawCharacterScreen_Inventory(Screen_t *screen, GameState_t *gamestate,
 					c = ui_DrawBooleanChoice(screen, "Drop Item?", "No", "Yes");
 					if (c){
 						// Remove one instance of the item
-						pc_TakeItem(gamestate->players->player[pc_id], &weapon, &item);
+						pc_TakeItem(gamestate, gamestate->players->player[pc_id], &weapon, &item);
 					}
 				}
 				// Reload the selected item, as the item slot may now be empty
@@ -674,7 +692,7 @@ char ui_DrawCharacterScreen_Inventory(Screen_t *screen, GameState_t *gamestate,
 						c = ui_DrawLootDestination(screen, gamestate, levelstate, &weapon, &item);
 						if (c){
 							// Remove one instance of the item
-							pc_TakeItem(gamestate->players->player[pc_id], &weapon, &item);
+							pc_TakeItem(gamestate, gamestate->players->player[pc_id], &weapon, &item);
 						}
 					}		
 				}
@@ -692,7 +710,6 @@ char ui_DrawCharacterScreen_Inventory(Screen_t *screen, GameState_t *gamestate,
 				if (refresh){
 					ui_DrawCharacterScreen_InventoryRedraw(screen, gamestate, levelstate, &weapon, &item, -1);
 					ui_DrawCharacterScreen_InventoryRedraw(screen, gamestate, levelstate, &weapon, &item, new_selected_id);
-					screen->dirty = 1;
 					draw_Flip(screen);
 					refresh = 0;
 				}
@@ -1312,7 +1329,6 @@ void ui_DrawSideBar(Screen_t *screen, GameState_t *gamestate, LevelState_t *leve
 		}
 	}
 	
-	screen->dirty = 1;
 }
 
 void ui_DrawStatusBar(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char buttons, unsigned char labels){
@@ -1376,7 +1392,6 @@ void ui_DrawStatusBar(Screen_t *screen, GameState_t *gamestate, LevelState_t *le
 			}	
 		}
 	}
-	screen->dirty = 1;
 }
 
 char ui_DrawLootDestinationRedraw(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, char selected_id, unsigned char selected){
@@ -1465,7 +1480,7 @@ char ui_DrawLootDestination(Screen_t *screen, GameState_t *gamestate, LevelState
 						draw_Flip(screen);
 					
 						// Copy item to character
-						pc_GiveItem(gamestate->players->player[selected_id], weapon, item);
+						pc_GiveItem(gamestate, gamestate->players->player[selected_id], weapon, item);
 						looted = 1;
 						
 						// Redraw window without any character selected
@@ -1575,7 +1590,6 @@ void ui_DrawLootChoiceRedraw(Screen_t *screen, GameState_t *gamestate, LevelStat
 		
 	}
 		
-	screen->dirty = 1;
 }
 	
 char ui_DrawLootChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char location_loot, unsigned char enemy_loot){
@@ -1604,7 +1618,6 @@ char ui_DrawLootChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *l
 	ui_DrawPopup(screen, UI_LOOT_START_X, UI_LOOT_START_Y, UI_LOOT_WIDTH, 14 + ((total_loot + 1) * 12), gamestate->buf, 1);
 	ui_DrawLootChoiceRedraw(screen, gamestate, levelstate, location_loot, enemy_loot, selected_id, 0);
 	
-	screen->dirty = 1;
 	draw_Flip(screen);
 	
 	// Add up/down cursor input to allow selection of items from inventory
@@ -1666,9 +1679,7 @@ char ui_DrawLootChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *l
 							}
 							
 							// Record this location as having been looted
-							if (gamestate->level_looted[levelstate->id] < 255){
-								gamestate->level_looted[levelstate->id]++;
-							}
+							progress_Loot(gamestate, levelstate->id);
 						}
 						if (enemy_loot){
 							// TO DO !!!!!
@@ -1685,9 +1696,7 @@ char ui_DrawLootChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *l
 				e = 1;
 				if (looted && location_loot){
 					// Mark this location as looted
-					if (gamestate->level_looted[levelstate->id] < 255){
-						gamestate->level_looted[levelstate->id]++;
-					}
+					progress_Loot(gamestate, levelstate->id);
 				}
 				break;
 			default:
@@ -1742,7 +1751,6 @@ void ui_DrawNavigationChoice(Screen_t *screen, GameState_t *gamestate, LevelStat
 		}
 	}
 		
-	screen->dirty = 1;
 	draw_Flip(screen);
 	
 	while(!e){
@@ -1876,7 +1884,6 @@ void ui_DrawTalkChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *l
 		}
 	}
 	
-	screen->dirty = 1;
 }
 
 void ui_DrawPopup(Screen_t *screen, unsigned short x, unsigned short y, unsigned short w, unsigned short h, char *title, unsigned char animate){
@@ -1906,11 +1913,32 @@ void ui_DrawPopup(Screen_t *screen, unsigned short x, unsigned short y, unsigned
 	
 }
 
+unsigned char ui_DrawBackground(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
+	// Show the background image of the current location in the main window,
+	// if it has one, and wait for a key before the location text replaces it.
+	//
+	// Returns 1 if an image was shown, or 0 if there was none to show.
+	
+	// Only look for the image file if the location record says there is one
+	if (levelstate->background == 0){
+		return 0;
+	}
+	
+	// The main window is still empty from ui_Draw()
+	if (draw_Background(screen, gamestate->level) != BMP_OK){
+		return 0;
+	}
+	ui_DrawLocationName(screen, gamestate, levelstate);
+	draw_String(screen, UI_MAIN_WINDOW_TEXT_X, UI_MAIN_WINDOW_TEXT_Y + (23 * 8), UI_MAIN_WINDOW_MAX_CHARS, 1, 0, screen->font_8x8, PIXEL_RED, "... Press return to continue", MODE_PIXEL_SET);
+	draw_Flip(screen);
+	input_Wait(screen, INPUT_CONFIRM);
+	return 1;
+}
+
 void ui_DrawLocationName(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
 	// Draws the location name in the title bar
 	
 	draw_String(screen, UI_TITLEBAR_MAX_CHARS - (strlen((char *)levelstate->name)), UI_TITLEBAR_TEXT_Y, MAX_LEVEL_NAME_SIZE, 1, 0, screen->font_8x8, PIXEL_WHITE, (char *)levelstate->name, MODE_PIXEL_SET);
-	screen->dirty = 1;
 }
 
 unsigned short ui_NPCDialogue(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short remain, unsigned char animate){
@@ -1975,23 +2003,37 @@ unsigned short ui_DrawMainWindowText(Screen_t *screen, GameState_t *gamestate, L
 	// Draws text into the main window with the correct colours,
 	// bounding box sizes and other main-window specific settings.
 	//
-	// This is ALL it does. If all the text cannot be drawn, it
-	// returns the number of characters (of the original string) it
-	// has printed, otherwise.
+	// 'remain' is the page of the text to draw. Page 0 lays out the
+	// text from scratch, any later page is drawn from that layout. Text
+	// too long for one layout has the next part laid out when needed.
 	//
-	// A subsequent call with the same string, and a non-zero 'remain'
-	// parameter will redraw the text from that offset.
+	// Returns the next page to draw, or 0 if this was the last page.
+	
+	if (remain == 0){
+		ui_main_first_page = 0;
+		draw_TextLayout(&ui_main_layout, c, 0, UI_MAIN_WINDOW_MAX_CHARS, UI_MAIN_WINDOW_MAX_ROWS, UI_MAIN_WINDOW_COLOUR);
+	} else if (((remain - ui_main_first_page) >= ui_main_layout.pages) && ui_main_layout.more){
+		ui_main_first_page = remain;
+		draw_TextLayout(&ui_main_layout, c, ui_main_layout.more, UI_MAIN_WINDOW_MAX_CHARS, UI_MAIN_WINDOW_MAX_ROWS, UI_MAIN_WINDOW_COLOUR);
+	}
+	ui_DrawMainWindowPage(screen, remain - ui_main_first_page);
+	
+	// Return the next page
+	if (((remain - ui_main_first_page + 1) < ui_main_layout.pages) || ui_main_layout.more){
+		return remain + 1;
+	}
+	return 0;
+}
+
+void ui_DrawMainWindowPage(Screen_t *screen, unsigned char page){
+	// Draws (or redraws) a page of the text last laid out by
+	// ui_DrawMainWindowText(), without looking at the text again.
 	
 	// Clear main text window
 	draw_Box(screen, UI_MAIN_WINDOW_X, UI_MAIN_WINDOW_Y, UI_MAIN_WINDOW_WIDTH, UI_MAIN_WINDOW_HEIGHT, 0, PIXEL_CLEAR, PIXEL_BLACK, MODE_PIXEL_SET);
 	
-	remain = draw_String(screen, UI_MAIN_WINDOW_TEXT_X, UI_MAIN_WINDOW_TEXT_Y, UI_MAIN_WINDOW_MAX_CHARS,	UI_MAIN_WINDOW_MAX_ROWS, remain, screen->font_8x8, UI_MAIN_WINDOW_COLOUR, c, MODE_PIXEL_SET);
-	
-	// Mark screen as dirty, ready to be repainted
-	screen->dirty = 1;
+	draw_TextLayoutPage(screen, &ui_main_layout, page, UI_MAIN_WINDOW_TEXT_X, UI_MAIN_WINDOW_TEXT_Y, screen->font_8x8, UI_MAIN_WINDOW_COLOUR, MODE_PIXEL_SET);
 	
-	// Return position in buffer
-	return remain;
 }
 
 void ui_DrawSplashText(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate){
@@ -2012,8 +2054,6 @@ void ui_DrawSplashText(Screen_t *screen, GameState_t *gamestate, LevelState_t *l
 	// Key to continue message
 	draw_String(screen, UI_MAIN_WINDOW_TEXT_X, UI_MAIN_WINDOW_TEXT_Y + (23 * 8), UI_MAIN_WINDOW_MAX_CHARS, 1, 0,	screen->font_8x8, PIXEL_RED, "... Press return to start this adventure!", MODE_PIXEL_SET);
 	
-	// Mark screen as dirty, ready to be repainted
-	screen->dirty = 1;
 }
 
 void ui_DrawError(Screen_t *screen, char *title, char *text, short errorcode){
@@ -2040,12 +2080,11 @@ void ui_DebugScreen(Screen_t *screen, GameState_t *gamestate, LevelState_t *leve
 
 	unsigned char c;
 	unsigned char e = 0;
-	unsigned short i;
 	unsigned short locations = 0;
 	unsigned short primary = 0;
 	unsigned short secondary = 0;
 	unsigned char players = 1;
-	unsigned char npcs = 0;
+	unsigned short npcs = 0;
 	unsigned char *mem;
 	unsigned char *mem2;
 	unsigned char *mem3;
@@ -2056,36 +2095,28 @@ void ui_DebugScreen(Screen_t *screen, GameState_t *gamestate, LevelState_t *leve
 	unsigned int base2 = 1024;
 	unsigned int base3 = 256;
 	unsigned int base4 = 8;
+	DataStats_t *datastats;
+	Arena_t *arena;
 	
 	draw_Clear(screen);
 	
 	// NPCs encountered
-	npcs = data_CountNPC(gamestate->npcs);
+	npcs = data_CountNPC(&gamestate->npcs);
 	
-	// Locations visited
-	for (i = 0; i < MAX_LOCATIONS; i++){
-		if (gamestate->level_visits[i] > 0){
-			locations++;
-		}
-	}
-	
-	// Primary spawns defeated
-	for (i = 0; i < MAX_LOCATIONS; i++){
-		primary += gamestate->level_defeated_primary[i];
-	}
-	
-	// Secondary spawns defeated
-	for (i = 0; i < MAX_LOCATIONS; i++){
-		secondary += gamestate->level_defeated_secondary[i];
-	}
+	// Locations visited, primary and secondary spawns defeated
+	locations = gamestate->progress.visited;
+	primary = gamestate->progress.defeated_primary_total;
+	secondary = gamestate->progress.defeated_secondary_total;
 	
 	draw_String(screen, UI_TITLEBAR_MAX_CHARS - (strlen("DEBUG SCREEN")), UI_TITLEBAR_TEXT_Y, MAX_LEVEL_NAME_SIZE, 1, 0, screen->font_8x8, PIXEL_RED, "DEBUG SCREEN", MODE_PIXEL_SET);
 	
 	// Print data structure sizes	
-	sprintf((char *)gamestate->text_buffer, "<g>Data Structures<C>\n- <r>%6d<C> BMP buffers\n- <r>%6d<C> Gamestate (inc text buffers)\n- <r>%6d<C> Levelstate\n- <r>%6d<C> per NPC state, (total: <r>%db<C>)\n- <r>%6d<C> Partystate (total: <r>%dx<C>)\n- <r>%6d<C> Enemystate (total: <r>%dx<C>)\n", (sizeof(bmpdata_t) + sizeof(bmpstate_t)), sizeof(GameState_t), sizeof(LevelState_t), sizeof(struct NPCList), (npcs * sizeof(struct NPCList)), (sizeof(PartyState_t) + (MAX_PLAYERS * sizeof(PlayerState_t))), MAX_PLAYERS, (sizeof(EnemyState_t) + (MAX_MONSTER_TYPES * sizeof(PlayerState_t))), MAX_MONSTER_TYPES);
+	sprintf((char *)gamestate->text_buffer, "<g>Data Structures<C>\n- <r>%6d<C> BMP buffers\n- <r>%6d<C> Gamestate (inc text buffers)\n- <r>%6d<C> Levelstate\n- <r>%6d<C> NPC state, (<r>%d<C> met)\n- <r>%6d<C> Partystate (total: <r>%dx<C>)\n- <r>%6d<C> Enemystate (total: <r>%dx<C>)\n", (sizeof(bmpdata_t) + sizeof(bmpstate_t)), sizeof(GameState_t), sizeof(LevelState_t), sizeof(NPCState_t), npcs, (sizeof(PartyState_t) + (MAX_PLAYERS * sizeof(PlayerState_t))), MAX_PLAYERS, (sizeof(EnemyState_t) + (MAX_MONSTER_TYPES * sizeof(PlayerState_t))), MAX_MONSTER_TYPES);
 	sprintf((char *)gamestate->text_buffer + strlen((char *)gamestate->text_buffer), "- <r>%6d<C> per Weapon\n", sizeof(WeaponState_t));
 	sprintf((char *)gamestate->text_buffer + strlen((char *)gamestate->text_buffer), "- <r>%6d<C> per Spell\n", sizeof(SpellState_t));
 	sprintf((char *)gamestate->text_buffer + strlen((char *)gamestate->text_buffer), "- <r>%6d<C> per Item\n", sizeof(ItemState_t));
+	arena = arena_Stats();
+	sprintf((char *)gamestate->text_buffer + strlen((char *)gamestate->text_buffer), "- <r>%6ld<C> Arena (<r>%ld<C> peak)\n", arena->size, arena->high);
 	draw_String(screen, 1, 15, 48, 11, 0, screen->font_8x8, PIXEL_WHITE, (char *)gamestate->text_buffer, MODE_PIXEL_SET);
 	
 	sprintf((char *)gamestate->text_buffer, "<g>Graphics Data<C>\n");
@@ -2130,9 +2161,15 @@ void ui_DebugScreen(Screen_t *screen, GameState_t *gamestate, LevelState_t *leve
 	// Game progress details
 	sprintf((char *)gamestate->text_buffer, "<g>Game Progress\n<C>\n- <r>%6d<C> PC in player party\n- <r>%6d<C> NPCs met\n- <r>%6d<C> Locations discovered\n- <r>%6d<C> Primary spawns\n- <r>%6d<C> Secondary spawns\n- %d\n- %d\n", players, npcs, locations, primary, secondary, gamestate->seed1, gamestate->seed2);
 	draw_String(screen, 1, 160, 48, 10, 0, screen->font_8x8, PIXEL_WHITE, (char *)gamestate->text_buffer, MODE_PIXEL_SET);
+	
+	// Datafile activity since startup
+	datastats = data_Stats();
+	sprintf((char *)gamestate->text_buffer, "<g>Datafile I/O<C>\n- <r>%6d<C> Opens\n- <r>%6d<C> Re-opens\n- <r>%6ld<C> Seeks\n- <r>%6ld<C> Reads\n", datastats->opens, datastats->reopens, datastats->seeks, datastats->reads);
+	sprintf((char *)gamestate->text_buffer + strlen((char *)gamestate->text_buffer), "- <r>%6d<C> Map cache hits\n- <r>%6d<C> Map cache misses\n- <r>%6d<C> Map cache entries\n- <r>%6d<C> Story cache hits\n- <r>%6d<C> Prefetched\n", datastats->map_hits, datastats->map_misses, data_MapCacheCount(), datastats->story_hits, datastats->prefetches);
+	draw_String(screen, 36, 160, 48, 10, 0, screen->font_8x8, PIXEL_WHITE, (char *)gamestate->text_buffer, MODE_PIXEL_SET);
+	
 	draw_String(screen, 1, SCREEN_HEIGHT - 10, 32, 1, 0, screen->font_8x8, PIXEL_RED, "Press [ESC] to return to game", MODE_PIXEL_SET);
 	
-	screen->dirty = 1;
 	draw_Flip(screen);
 	
 	input_Clear();
@@ -2157,7 +2194,6 @@ void ui_DrawEquipError(Screen_t *screen, char *error){
 	draw_String(screen, UI_YESNO_START_X / 8 + 1, UI_YESNO_START_Y + 12, 23, 3, 0, screen->font_8x8, PIXEL_WHITE, error, MODE_PIXEL_SET);
 	draw_String(screen, UI_YESNO_START_X / 8 + 18, UI_YESNO_START_Y + 42, 23, 1, 0, screen->font_8x8, PIXEL_WHITE, "<r>Esc<C>ape", MODE_PIXEL_SET);
 	input_WaitAndReturn(screen);
-	screen->dirty = 1;
 	draw_Flip(screen);
 }
 
@@ -2181,7 +2217,6 @@ char ui_DrawBooleanChoice(Screen_t *screen, char *title, char *choice1, char *ch
 	
 	draw_String(screen, UI_YESNO_START_X / 8 + 18, UI_YESNO_START_Y + 40, 23, 1, 0, screen->font_8x8, PIXEL_WHITE, "<r>Esc<C>ape", MODE_PIXEL_SET);
 	
-	screen->dirty = 1;
 	draw_Flip(screen);
 	
 	input_Set(INPUT_CONFIRM);
@@ -113,6 +113,7 @@ char ui_DrawCharacterScreen_Overview(Screen_t *screen, GameState_t *gamestate, L
 void ui_DrawSideBar(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
 void ui_DrawStatusBar(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned char buttons, unsigned char labels);
 void ui_DrawSplashText(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
+unsigned char ui_DrawBackground(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
 void ui_DrawLocationName(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
 void ui_DrawNavigationChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
 void ui_DrawTalkChoice(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate);
@@ -129,6 +130,7 @@ char ui_DrawBooleanChoice(Screen_t *screen, char *title, char *choice1, char *ch
 
 // Area-specific text display routines
 unsigned short ui_DrawMainWindowText(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short remain, char *c);
+void ui_DrawMainWindowPage(Screen_t *screen, unsigned char page);
 unsigned short ui_NPCDialogue(Screen_t *screen, GameState_t *gamestate, LevelState_t *levelstate, unsigned short remain, unsigned char animate);
 
 #endif
\ No newline at end of file
@@ -103,29 +103,6 @@ unsigned char check_Files(void){
 	return errors;
 }
 
-unsigned char word_length(char *c, unsigned short pos, unsigned short string_size){
-	// Count from the current position to the next space/newline/carriage return.
-	//
-	// Returns the number of characters so that a text printing routine
-	// can work out if there is enough space to print this word.
-	
-	unsigned short i;
-	unsigned short count;
-	
-	count = 0;
-	for (i = pos; i < string_size; i++){
-		if ((c[i] == 0x20) || (c[i] == 0x0A) || (c[i] == 0x0D)){
-			// Newline/space found at this position
-			// Return the number of characters that are needed to print
-			// this section of text
-			return count;	
-		}
-		count++;
-	}
-	// No more spaces found
-	return count;
-}
-
 void * get_FreeBlock(unsigned int *size, unsigned int base, unsigned short increment){
 	// Returns the biggest free block of memory than can be allocated
 	
@@ -18,7 +18,6 @@
 #ifndef _UTILS_QL_H
 
 unsigned char check_Files(void);
-unsigned char word_length(char *c, unsigned short pos, unsigned short string_size);
 void * get_FreeBlock(unsigned int *size, unsigned int base, unsigned short increment);
 
 #define _UTILS_QL_H